@@ -0,0 +1,88 @@
+﻿/**
+* @file bench.h
+* @brief 微基准用到的计时工具，各组基准在 bench_main.cpp 里登记
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef BENCH_H
+#define BENCH_H
+
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// 防止编译器把结果算不到的循环整个删掉
+template <typename T>
+inline void benchKeep(const T& value)
+{
+    asm volatile("" : : "r"(&value) : "memory");
+}
+
+// 时间戳计数器，x86 以外的平台退回纳秒数，这时 "cycle" 实际上是纳秒
+inline uint64_t benchCycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+#endif
+}
+
+struct BenchResult
+{
+    double ns_per_op = 0;
+    double cycles_per_op = 0;
+};
+
+// 先预热一轮，再重复 rounds 轮取最快的一轮，每轮调用 fn() iterations 次
+template <typename Fn>
+BenchResult benchRun(size_t iterations, Fn&& fn, int rounds = 5)
+{
+    for (size_t i = 0; i < iterations / 10 + 1; ++i)
+    {
+        fn();
+    }
+
+    BenchResult best;
+    for (int r = 0; r < rounds; ++r)
+    {
+        auto start = std::chrono::steady_clock::now();
+        uint64_t cycles_start = benchCycles();
+        for (size_t i = 0; i < iterations; ++i)
+        {
+            fn();
+        }
+        uint64_t cycles = benchCycles() - cycles_start;
+        double ns = std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now() - start).count();
+
+        BenchResult result{ ns / iterations, static_cast<double>(cycles) / iterations };
+        if (r == 0 || result.ns_per_op < best.ns_per_op)
+        {
+            best = result;
+        }
+    }
+    return best;
+}
+
+// 抓下来的几类浏览器请求，定义在 bench_parser.cpp，解析和扫描的基准共用
+struct BenchSample
+{
+    const char* name;
+    std::string text;
+};
+
+const std::vector<BenchSample>& benchSamples();
+
+// 各组基准，bench_main.cpp 按命令行上给的组名挑选
+void benchParser();
+void benchScan();
+void benchRouter();
+
+#endif // !BENCH_H
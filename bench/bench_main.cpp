@@ -0,0 +1,43 @@
+﻿/**
+* @file bench_main.cpp
+* @brief 微基准入口：bench_parser [组名 ...]，不带参数时全部运行
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "bench.h"
+#include <cstring>
+
+struct BenchGroup
+{
+    const char* name;
+    void (*run)();
+};
+
+static const BenchGroup BENCH_GROUPS[] = {
+    { "parser", benchParser },
+    { "scan", benchScan },
+    { "router", benchRouter },
+};
+
+int main(int argc, char* argv[])
+{
+#ifndef __OPTIMIZE__
+    std::printf("warning: built without optimization, configure with -DCMAKE_BUILD_TYPE=Release\n\n");
+#endif
+    for (const BenchGroup& group : BENCH_GROUPS)
+    {
+        bool selected = argc < 2;
+        for (int i = 1; i < argc; ++i)
+        {
+            selected = selected || std::strcmp(argv[i], group.name) == 0;
+        }
+        if (selected)
+        {
+            std::printf("==== %s ====\n", group.name);
+            group.run();
+            std::printf("\n");
+        }
+    }
+    return 0;
+}
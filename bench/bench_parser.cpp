@@ -0,0 +1,303 @@
+﻿/**
+* @file bench_parser.cpp
+* @brief 请求解析基准：原来基于 istringstream 的整包解析 对比 现在的增量解析器
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "bench.h"
+#include "http/http_request_parser.h"
+#include "http/http_exchange.h"
+#include <string>
+#include <sstream>
+#include <unordered_map>
+#include <vector>
+
+// ==== 原来的解析器 ====
+// 增量解析器之前的实现，原样搬过来只去掉了日志：
+// 先找 "\r\n\r\n" 和 Content-Length 判断收全没有，再把整个请求拷出来逐行 getline
+namespace legacy
+{
+    struct HttpRequest
+    {
+        std::string method;
+        std::string path;
+        std::string version;
+        std::unordered_map<std::string, std::string> headers;
+        std::string body;
+        std::unordered_map<std::string, std::string> query_params;
+        std::unordered_map<std::string, std::string> cookies;
+    };
+
+    static std::string urlDecode(const std::string& value)
+    {
+        std::string decoded;
+        for (size_t i = 0; i < value.length(); ++i)
+        {
+            if (value[i] == '+')
+            {
+                decoded += ' ';
+            }
+            else if (value[i] == '%' && i + 2 < value.length())
+            {
+                int hex = 0;
+                std::istringstream(value.substr(i + 1, 2)) >> std::hex >> hex;
+                decoded += static_cast<char>(hex);
+                i += 2;
+            }
+            else
+            {
+                decoded += value[i];
+            }
+        }
+        return decoded;
+    }
+
+    static std::string trim(const std::string& s)
+    {
+        size_t start = s.find_first_not_of(" \r\n\t");
+        size_t end = s.find_last_not_of(" \r\n\t");
+        if (start == std::string::npos || end == std::string::npos)
+        {
+            return "";
+        }
+        return s.substr(start, end - start + 1);
+    }
+
+    static size_t getContentLengthFromHeader(const std::string& header_str)
+    {
+        size_t pos = header_str.find("Content-Length:");
+        if (pos != std::string::npos)
+        {
+            pos += 15;
+            while (pos < header_str.size() && isspace(static_cast<unsigned char>(header_str[pos])))
+            {
+                ++pos;
+            }
+            size_t len = 0;
+            while (pos < header_str.size() && isdigit(static_cast<unsigned char>(header_str[pos])))
+            {
+                len = len * 10 + (header_str[pos] - '0');
+                ++pos;
+            }
+            return len;
+        }
+        return 0;
+    }
+
+    static size_t getRequestLength(const std::string& buffer)
+    {
+        auto headers_end = buffer.find("\r\n\r\n");
+        if (headers_end == std::string::npos)
+        {
+            return 0;
+        }
+        size_t content_length = getContentLengthFromHeader(buffer.substr(0, headers_end));
+        size_t total = headers_end + 4 + content_length;
+        return buffer.size() >= total ? total : 0;
+    }
+
+    static std::unordered_map<std::string, std::string> parseQueryString(const std::string& query)
+    {
+        std::unordered_map<std::string, std::string> params;
+        std::istringstream iss(query);
+        std::string item;
+        while (std::getline(iss, item, '&'))
+        {
+            size_t pos = item.find('=');
+            if (pos != std::string::npos)
+            {
+                params[item.substr(0, pos)] = item.substr(pos + 1);
+            }
+            else
+            {
+                params[item] = "";
+            }
+        }
+        return params;
+    }
+
+    static std::unordered_map<std::string, std::string> parseCookies(const std::string& cookie_header)
+    {
+        std::unordered_map<std::string, std::string> cookies;
+        std::istringstream iss(cookie_header);
+        std::string item;
+        while (std::getline(iss, item, ';'))
+        {
+            size_t pos = item.find('=');
+            if (pos != std::string::npos)
+            {
+                cookies[trim(item.substr(0, pos))] = trim(item.substr(pos + 1));
+            }
+        }
+        return cookies;
+    }
+
+    static HttpRequest parse(const std::string& raw_request)
+    {
+        HttpRequest req;
+        std::istringstream iss(raw_request);
+
+        std::string line;
+        if (!std::getline(iss, line))
+        {
+            return req;
+        }
+        line = trim(line);
+        std::istringstream line_iss(line);
+        line_iss >> req.method >> req.path >> req.version;
+        req.path = urlDecode(req.path);
+
+        size_t qpos = req.path.find('?');
+        if (qpos != std::string::npos)
+        {
+            req.query_params = parseQueryString(req.path.substr(qpos + 1));
+            req.path = req.path.substr(0, qpos);
+        }
+
+        while (std::getline(iss, line) && !trim(line).empty())
+        {
+            line = trim(line);
+            size_t pos = line.find(':');
+            if (pos != std::string::npos)
+            {
+                req.headers[trim(line.substr(0, pos))] = trim(line.substr(pos + 1));
+            }
+        }
+
+        auto it = req.headers.find("Cookie");
+        if (it != req.headers.end())
+        {
+            req.cookies = parseCookies(it->second);
+        }
+
+        it = req.headers.find("Content-Length");
+        if (it != req.headers.end())
+        {
+            int content_length = std::stoi(it->second);
+            if (content_length > 0)
+            {
+                std::string body(content_length, '\0');
+                iss.read(&body[0], content_length);
+                req.body = body;
+            }
+        }
+        return req;
+    }
+}
+
+// ==== 样本请求 ====
+// 浏览器实际发出的几类请求：首页、带查询串的翻页、静态资源、表单提交
+static const std::vector<BenchSample> SAMPLE_REQUESTS = {
+    { "index", "GET / HTTP/1.1\r\n"
+    "Host: 119.45.10.196:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "Cache-Control: max-age=0\r\n"
+    "Upgrade-Insecure-Requests: 1\r\n"
+    "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/128.0.0.0 Safari/537.36\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,image/avif,image/webp,image/apng,*/*;q=0.8,application/signed-exchange;v=b3;q=0.7\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: zh-CN,zh;q=0.9,en;q=0.8\r\n"
+    "If-None-Match: W/\"3f-1a2b3c4d\"\r\n"
+    "\r\n" },
+
+    { "paged list", "GET /diaries?from=2026-01-01&to=2026-10-17&limit=20&after=%282026-09-30%29%E6%97%A5%E8%AE%B0 HTTP/1.1\r\n"
+    "Host: 119.45.10.196:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (Macintosh; Intel Mac OS X 10_15_7) AppleWebKit/605.1.15 (KHTML, like Gecko) Version/17.5 Safari/605.1.15\r\n"
+    "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+    "Referer: http://119.45.10.196:8080/\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Accept-Language: zh-CN,zh-Hans;q=0.9\r\n"
+    "Cookie: theme=dark; last_visit=2026-10-16; _ga=GA1.1.123456789.1700000000\r\n"
+    "\r\n" },
+
+    { "asset", "GET /assets/three/three.module.js HTTP/1.1\r\n"
+    "Host: 119.45.10.196:8080\r\n"
+    "Connection: keep-alive\r\n"
+    "User-Agent: Mozilla/5.0 (X11; Linux x86_64; rv:130.0) Gecko/20100101 Firefox/130.0\r\n"
+    "Accept: */*\r\n"
+    "Accept-Language: zh-CN,zh;q=0.8,en-US;q=0.5,en;q=0.3\r\n"
+    "Accept-Encoding: gzip, deflate\r\n"
+    "Referer: http://119.45.10.196:8080/cube\r\n"
+    "Sec-Fetch-Dest: script\r\n"
+    "Sec-Fetch-Mode: cors\r\n"
+    "Sec-Fetch-Site: same-origin\r\n"
+    "If-Modified-Since: Sat, 17 Oct 2026 08:00:00 GMT\r\n"
+    "If-None-Match: \"9c41-5e2f1a\"\r\n"
+    "\r\n" },
+
+    { "form post", []()
+    {
+        std::string body = "title=%E4%BB%8A%E5%A4%A9%E5%AD%A6%E4%B9%A0C%2B%2B%E7%BD%91%E7%BB%9C&content=";
+        for (int i = 0; i < 40; ++i)
+        {
+            body += "%E6%88%91%E5%86%99%E4%BA%86%E4%B8%80%E4%B8%AA%E7%AE%80%E5%8D%95%E7%9A%84HTTP%E6%9C%8D%E5%8A%A1+";
+        }
+        return "POST /post_write HTTP/1.1\r\n"
+            "Host: 119.45.10.196:8080\r\n"
+            "Connection: keep-alive\r\n"
+            "Content-Length: " + std::to_string(body.size()) + "\r\n"
+            "Cache-Control: max-age=0\r\n"
+            "Origin: http://119.45.10.196:8080\r\n"
+            "Content-Type: application/x-www-form-urlencoded\r\n"
+            "User-Agent: Mozilla/5.0 (Windows NT 10.0; Win64; x64) AppleWebKit/537.36 (KHTML, like Gecko) Chrome/128.0.0.0 Safari/537.36\r\n"
+            "Accept: text/html,application/xhtml+xml,application/xml;q=0.9,*/*;q=0.8\r\n"
+            "Referer: http://119.45.10.196:8080/write\r\n"
+            "Accept-Encoding: gzip, deflate\r\n"
+            "Accept-Language: zh-CN,zh;q=0.9\r\n"
+            "\r\n" + body;
+    }() },
+};
+
+const std::vector<BenchSample>& benchSamples()
+{
+    return SAMPLE_REQUESTS;
+}
+
+// 两边都按服务器里的用法计时：数据先在连接的读缓冲里，判断收全后取走一个请求
+void benchParser()
+{
+    constexpr size_t ITERATIONS = 20000;
+
+    std::printf("%-12s %8s %12s %12s %8s\n", "request", "bytes", "legacy ns", "new ns", "speedup");
+    for (const BenchSample& item : SAMPLE_REQUESTS)
+    {
+        const std::string& sample = item.text;
+        std::string buffer;
+
+        BenchResult old_result = benchRun(ITERATIONS, [&]()
+        {
+            buffer.assign(sample);
+            size_t length = legacy::getRequestLength(buffer);
+            legacy::HttpRequest req = legacy::parse(buffer.substr(0, length));
+            buffer.erase(0, length);
+            benchKeep(req);
+        });
+
+        HttpRequestParser parser;
+        HttpExchange exchange;
+        buffer.assign(sample);
+        if (parser.feed(buffer) != HttpRequestParser::Result::Complete)
+        {
+            std::printf("%-12s parse failed\n", item.name);
+            continue;
+        }
+        parser.take(buffer, exchange.request());
+        exchange.reset();
+
+        BenchResult new_result = benchRun(ITERATIONS, [&]()
+        {
+            buffer.assign(sample);
+            if (parser.feed(buffer) == HttpRequestParser::Result::Complete)
+            {
+                parser.take(buffer, exchange.request());
+            }
+            benchKeep(exchange.request());
+            exchange.reset();
+        });
+
+        std::printf("%-12s %8zu %12.1f %12.1f %7.1fx\n", item.name, sample.size(),
+            old_result.ns_per_op, new_result.ns_per_op, old_result.ns_per_op / new_result.ns_per_op);
+    }
+}
@@ -0,0 +1,148 @@
+﻿/**
+* @file bench_router.cpp
+* @brief 路由基准：原来逐级去掉最后一段查哈希表 对比 现在的压缩前缀树
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "bench.h"
+#include "router/router.h"
+#include <unordered_map>
+
+// ==== 原来的路由 ====
+// 前缀树之前的实现：键是 "方法:路径"，查不到就去掉最后一段再查，最后查 "/"。
+// 没有参数，/diary/:name 这类路由当时注册成 /diary，由处理函数自己切路径
+namespace legacy
+{
+    class Router
+    {
+    public:
+        void registerRoute(const std::string& method, const std::string& path, Handler handler)
+        {
+            routes[method + ':' + path] = handler;
+        }
+
+        bool route(const HttpRequest& req, HttpResponse& res) const
+        {
+            std::string key = std::string(req.method) + ':';
+            std::string path(req.path);
+
+            for (std::string current = path; !current.empty();)
+            {
+                auto it = routes.find(key + current);
+                if (it != routes.end())
+                {
+                    it->second(req, res);
+                    return true;
+                }
+
+                auto pos = current.find_last_of('/');
+                if (pos == std::string::npos || pos == 0)
+                {
+                    break;
+                }
+                current = current.substr(0, pos);
+            }
+
+            auto it = routes.find(key + '/');
+            if (it != routes.end())
+            {
+                it->second(req, res);
+                return true;
+            }
+            return false;
+        }
+
+    private:
+        std::unordered_map<std::string, Handler> routes;
+    };
+}
+
+// 服务器实际注册的路由，前面是现在的写法，后面是原来的写法
+struct RouteSample
+{
+    const char* method;
+    const char* pattern;
+    const char* legacy_pattern;
+};
+
+static const RouteSample ROUTES[] = {
+    { "GET", "/", "/" },
+    { "GET", "/diaries", "/diaries" },
+    { "GET", "/write", "/write" },
+    { "POST", "/post_write", "/post_write" },
+    { "GET", "/diary/:name", "/diary" },
+    { "GET", "/delete/:name", "/delete" },
+    { "GET", "/assets/*path", "/assets" },
+    { "GET", "/cube", "/cube" },
+    { "GET", "/search", "/search" },
+    { "GET", "/status", "/status" },
+    { "GET", "/api/diaries", "/api/diaries" },
+    { "GET", "/api/diaries/:name", "/api/diaries" },
+    { "POST", "/api/diaries", "/api/diaries" },
+    { "DELETE", "/api/diaries/:name", "/api/diaries" },
+};
+
+// 按访问量大致的比例：页面、日记、静态资源居多
+static const std::pair<const char*, const char*> LOOKUPS[] = {
+    { "GET", "/" },
+    { "GET", "/diaries" },
+    { "GET", "/diary/(2026-10-17)%E4%BB%8A%E5%A4%A9" },
+    { "GET", "/assets/common.css" },
+    { "GET", "/assets/three/three.module.js" },
+    { "GET", "/assets/html/diary_view.html" },
+    { "POST", "/post_write" },
+    { "GET", "/api/diaries/(2026-10-17)a" },
+    { "GET", "/search" },
+    { "GET", "/favicon.ico" },
+};
+
+void benchRouter()
+{
+    constexpr size_t ITERATIONS = 20000;
+
+    size_t hits = 0;
+    auto count = [&hits](const HttpRequest&, HttpResponse&) { ++hits; };
+
+    legacy::Router old_router;
+    Router& router = Router::getInstance();
+    for (const RouteSample& route : ROUTES)
+    {
+        old_router.registerRoute(route.method, route.legacy_pattern, count);
+        router.registerRoute(route.method, route.pattern, count);
+    }
+    router.freeze();
+
+    std::vector<std::unique_ptr<HttpRequest>> requests;
+    for (const auto& [method, path] : LOOKUPS)
+    {
+        auto req = std::make_unique<HttpRequest>();
+        req->method = method;
+        req->path = path;
+        requests.push_back(std::move(req));
+    }
+    HttpResponse res;
+
+    BenchResult old_result = benchRun(ITERATIONS, [&]()
+    {
+        for (auto& req : requests)
+        {
+            old_router.route(*req, res);
+        }
+    });
+    BenchResult new_result = benchRun(ITERATIONS, [&]()
+    {
+        for (auto& req : requests)
+        {
+            router.route(*req, res);
+        }
+    });
+    benchKeep(hits);
+
+    size_t n = requests.size();
+    std::printf("%zu routes, %zu lookups per pass\n", std::size(ROUTES), n);
+    std::printf("%-14s %10s\n", "", "ns/lookup");
+    std::printf("%-14s %10.1f\n", "prefix walk", old_result.ns_per_op / n);
+    std::printf("%-14s %10.1f\n", "radix tree", new_result.ns_per_op / n);
+    std::printf("speedup %.1fx\n", old_result.ns_per_op / new_result.ns_per_op);
+}
@@ -0,0 +1,87 @@
+﻿/**
+* @file bench_scan.cpp
+* @brief 字节扫描基准：解析器的 scanChar 和直接调用 memchr 对比，以及 isToken，单位是每周期处理的字节数
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "bench.h"
+#include "http/http_scan.h"
+#include <cstring>
+#include <string_view>
+
+// 解析器实际的调用方式：逐行找 '\n'，再检查每个头部名是不是 token
+struct ScanWorkload
+{
+    std::vector<std::string_view> lines;	// 每行从行首到缓冲区末尾，找的是这一行的 '\n'
+    std::vector<std::string_view> names;	// 头部名
+    size_t line_bytes = 0;					// 找到 '\n' 之前实际扫过的字节数
+    size_t name_bytes = 0;
+};
+
+static ScanWorkload buildWorkload()
+{
+    ScanWorkload workload;
+    for (const BenchSample& sample : benchSamples())
+    {
+        std::string_view text = sample.text;
+        size_t header_end = text.find("\r\n\r\n");
+        std::string_view headers = text.substr(0, header_end + 4);
+
+        size_t begin = 0;
+        while (begin < headers.size())
+        {
+            size_t nl = headers.find('\n', begin);
+            workload.lines.push_back(headers.substr(begin));
+            workload.line_bytes += nl + 1 - begin;
+
+            size_t colon = headers.find(':', begin);
+            if (begin != 0 && colon < nl)
+            {
+                workload.names.push_back(headers.substr(begin, colon - begin));
+                workload.name_bytes += colon - begin;
+            }
+            begin = nl + 1;
+        }
+    }
+    return workload;
+}
+
+static void printRow(const char* name, size_t bytes, const BenchResult& result)
+{
+    std::printf("  %-8s %10.2f %10.1f\n", name, bytes / result.cycles_per_op, result.ns_per_op);
+}
+
+void benchScan()
+{
+    constexpr size_t ITERATIONS = 20000;
+
+    const ScanWorkload workload = buildWorkload();
+    std::printf("%zu header lines (%zu bytes), %zu header names (%zu bytes)\n\n",
+        workload.lines.size(), workload.line_bytes, workload.names.size(), workload.name_bytes);
+
+    std::printf("find '\\n'   bytes/cycle    ns/pass\n");
+    printRow("memchr", workload.line_bytes, benchRun(ITERATIONS, [&]()
+    {
+        for (std::string_view line : workload.lines)
+        {
+            benchKeep(std::memchr(line.data(), '\n', line.size()));
+        }
+    }));
+    printRow("scanChar", workload.line_bytes, benchRun(ITERATIONS, [&]()
+    {
+        for (std::string_view line : workload.lines)
+        {
+            benchKeep(scanChar(line.data(), line.data() + line.size(), '\n'));
+        }
+    }));
+
+    std::printf("\nisToken     bytes/cycle    ns/pass\n");
+    printRow("bitmap", workload.name_bytes, benchRun(ITERATIONS, [&]()
+    {
+        for (std::string_view name : workload.names)
+        {
+            benchKeep(isToken(name.data(), name.data() + name.size()));
+        }
+    }));
+}
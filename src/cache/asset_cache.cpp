@@ -0,0 +1,258 @@
+﻿/**
+* @file asset_cache.cpp
+* @brief 静态资源缓存：文件 mmap 进内存，预先算好响应头要用的值，按字节上限做 LRU 淘汰，文件变化时失效
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "asset_cache.h"
+#include "comm/log.h"
+#include "comm/gzip.h"
+#include "comm/http_date.h"
+#include <format>
+#include <charconv>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <sys/mman.h>
+#include <unistd.h>
+#endif
+
+static void appendHex(std::string& out, uint64_t value)
+{
+    char buf[16];
+    auto [ptr, ec] = std::to_chars(buf, buf + sizeof(buf), value, 16);
+    out.append(buf, ptr);
+}
+
+Asset::~Asset()
+{
+#ifndef _WIN32
+    if (m_map)
+    {
+        munmap(m_map, m_map_length);
+    }
+#endif
+}
+
+std::string_view Asset::gzipBytes() const
+{
+    std::call_once(m_gzip_once, [this]()
+        {
+            constexpr size_t MIN_SIZE = 256;
+            if (bytes.size() < MIN_SIZE || !isCompressibleMime(content_type))
+            {
+                return;
+            }
+            std::string gz;
+            if (gzipCompress(bytes, gz, 9) && gz.size() * 10 <= bytes.size() * 9)
+            {
+                m_gzip = std::move(gz);
+            }
+        });
+    return m_gzip;
+}
+
+AssetCache& AssetCache::getInstance()
+{
+    static AssetCache instance;
+    return instance;
+}
+
+bool AssetCache::start(const std::string& root, size_t budget_bytes)
+{
+    std::error_code ec;
+    m_root = std::filesystem::weakly_canonical(std::filesystem::absolute(root), ec);
+    m_budget = budget_bytes;
+    if (ec || m_budget == 0)
+    {
+        LOG_INFO("Asset cache disabled");
+        m_budget = 0;
+        return true;
+    }
+
+    // 监视根目录和现有的所有子目录，改动或删除的文件从缓存里去掉，下次访问重新加载
+    if (m_watcher.init() && m_watcher.watch(m_root.string()))
+    {
+        for (auto it = std::filesystem::recursive_directory_iterator(m_root, ec);
+            !ec && it != std::filesystem::recursive_directory_iterator(); it.increment(ec))
+        {
+            if (it->is_directory(ec))
+            {
+                m_watcher.watch(it->path().string());
+            }
+        }
+    }
+    else
+    {
+        LOG_WARN(std::format("Cannot watch {}, cached assets won't notice changes on disk", m_root.string()));
+    }
+
+    m_watcher.start([this](FileWatcher::Event event, const std::string& path)
+        {
+            if (event == FileWatcher::Event::Overflow)
+            {
+                clear();
+                return;
+            }
+            auto relative = std::filesystem::path(path).lexically_relative(m_root);
+            invalidate(relative.generic_string());
+        });
+
+    LOG_INFO(std::format("Asset cache on {} with a budget of {} bytes", m_root.string(), m_budget));
+    return true;
+}
+
+std::shared_ptr<const Asset> AssetCache::get(std::string_view relative)
+{
+    if (m_budget == 0)
+    {
+        return nullptr;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_entries.find(relative);
+        if (it != m_entries.end())
+        {
+            m_lru.splice(m_lru.begin(), m_lru, it->second.lru);
+            m_hits.fetch_add(1, std::memory_order_relaxed);
+            return it->second.asset;
+        }
+    }
+    m_misses.fetch_add(1, std::memory_order_relaxed);
+
+    // 只缓存规范写法的路径，"a/../b" 之类的不进缓存，免得同一个文件占好几份
+    std::string key = std::filesystem::path(relative).lexically_normal().generic_string();
+    if (key != relative || key.empty() || key.starts_with("..") || key.starts_with('/'))
+    {
+        return nullptr;
+    }
+
+    std::shared_ptr<Asset> asset = load(key);
+    if (!asset)
+    {
+        return nullptr;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key);
+    if (it != m_entries.end())
+    {
+        return it->second.asset;    // 别的线程先加载好了
+    }
+    m_lru.push_front(key);
+    m_entries.emplace(key, Slot{ asset, m_lru.begin() });
+    m_bytes += asset->bytes.size();
+    evictLocked();
+    return asset;
+}
+
+std::shared_ptr<Asset> AssetCache::load(const std::string& key) const
+{
+    std::error_code ec;
+    std::filesystem::path path = std::filesystem::weakly_canonical(m_root / key, ec);
+    std::string root = m_root.string();
+    if (ec || path.string().compare(0, root.size(), root) != 0 || !std::filesystem::is_regular_file(path, ec))
+    {
+        return nullptr;
+    }
+
+#ifdef _WIN32
+    int fd = ::_open(path.string().c_str(), _O_RDONLY | _O_BINARY);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd < 0)
+    {
+        return nullptr;
+    }
+
+    auto asset = std::make_shared<Asset>();
+    struct stat st {};
+    bool ok = ::fstat(fd, &st) == 0 && S_ISREG(st.st_mode) && static_cast<size_t>(st.st_size) <= m_budget;
+    if (ok && st.st_size > 0)
+    {
+        size_t length = static_cast<size_t>(st.st_size);
+#ifdef _WIN32
+        asset->m_heap.resize(length);
+        ok = ::_read(fd, asset->m_heap.data(), static_cast<unsigned>(length)) == static_cast<int>(length);
+        asset->bytes = asset->m_heap;
+#else
+        void* map = mmap(nullptr, length, PROT_READ, MAP_PRIVATE, fd, 0);
+        ok = map != MAP_FAILED;
+        if (ok)
+        {
+            asset->m_map = map;
+            asset->m_map_length = length;
+            asset->bytes = std::string_view(static_cast<const char*>(map), length);
+        }
+#endif
+    }
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+    if (!ok)
+    {
+        return nullptr;
+    }
+
+    asset->key = key;
+    asset->content_type = guessMimeType(path.extension().string());
+    asset->mtime = st.st_mtime;
+    asset->last_modified = formatHttpDate(st.st_mtime);
+    asset->etag = "\"";
+    appendHex(asset->etag, static_cast<uint64_t>(st.st_size));
+    asset->etag += '-';
+    appendHex(asset->etag, static_cast<uint64_t>(st.st_mtime));
+    asset->gzip_etag = asset->etag + "-gz\"";
+    asset->etag += '"';
+    return asset;
+}
+
+// 调用方持有 m_mutex
+void AssetCache::evictLocked()
+{
+    while (m_bytes > m_budget && !m_lru.empty())
+    {
+        auto it = m_entries.find(m_lru.back());
+        m_bytes -= it->second.asset->bytes.size();
+        m_entries.erase(it);
+        m_lru.pop_back();
+        m_evictions.fetch_add(1, std::memory_order_relaxed);
+    }
+}
+
+void AssetCache::invalidate(const std::string& key)
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_entries.find(key);
+    if (it == m_entries.end())
+    {
+        return;
+    }
+    LOG_INFO(std::format("Asset {} changed on disk, dropped from cache", key));
+    m_bytes -= it->second.asset->bytes.size();
+    m_lru.erase(it->second.lru);
+    m_entries.erase(it);
+}
+
+void AssetCache::clear()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_entries.clear();
+    m_lru.clear();
+    m_bytes = 0;
+}
+
+std::string AssetCache::statusText() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::format("asset cache: {} files, {}/{} bytes, hits {}, misses {}, evictions {}\n",
+        m_entries.size(), m_bytes, m_budget, m_hits.load(), m_misses.load(), m_evictions.load());
+}
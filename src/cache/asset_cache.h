@@ -0,0 +1,105 @@
+﻿/**
+* @file asset_cache.h
+* @brief 静态资源缓存：文件 mmap 进内存，预先算好响应头要用的值，按字节上限做 LRU 淘汰，文件变化时失效
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef ASSET_CACHE_H
+#define ASSET_CACHE_H
+
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <filesystem>
+#include <cstdint>
+#include <ctime>
+#include "comm/file_watcher.h"
+#include "comm/mime_types.h"
+
+// 一个缓存的文件，内容和头部值都不可变，析构时解除映射
+struct Asset
+{
+    std::string key;            // 相对资源根目录的规范路径，如 "three/three.js"
+    std::string_view bytes;     // 文件内容
+    std::string content_type;
+    std::string etag;           // "大小-修改时间"
+    std::string gzip_etag;      // 压缩版本的 ETag，"大小-修改时间-gz"
+    std::string last_modified;  // HTTP 日期格式
+    time_t mtime = 0;
+
+    Asset() = default;
+    ~Asset();
+    Asset(const Asset&) = delete;
+    Asset& operator=(const Asset&) = delete;
+
+    // gzip 版本，第一次有客户端要的时候才压缩，之后跟着缓存项一起留着（不计入字节上限）。
+    // 类型不适合压缩或者压不下去时返回空
+    std::string_view gzipBytes() const;
+
+private:
+    friend class AssetCache;
+    mutable std::once_flag m_gzip_once;
+    mutable std::string m_gzip;
+    void* m_map = nullptr;      // mmap 的地址，不支持 mmap 的平台上内容放在 m_heap
+    size_t m_map_length = 0;
+    std::string m_heap;
+};
+
+class AssetCache
+{
+public:
+    static AssetCache& getInstance();
+
+    // 资源根目录和缓存字节上限（0 表示不缓存），启动时调用一次
+    bool start(const std::string& root, size_t budget_bytes);
+
+    // relative 是 URL 里 /assets/ 后面的部分。命中时只查一次表，不做系统调用；
+    // 文件不存在、跳出了根目录、超过上限或者缓存关闭时返回空，由调用方走不缓存的路径
+    std::shared_ptr<const Asset> get(std::string_view relative);
+
+    std::string statusText() const;
+
+private:
+    AssetCache() = default;
+    ~AssetCache() = default;
+    AssetCache(const AssetCache&) = delete;
+    AssetCache& operator=(const AssetCache&) = delete;
+
+    std::shared_ptr<Asset> load(const std::string& key) const;
+    void invalidate(const std::string& key);
+    void clear();
+    void evictLocked();
+
+    struct StringHash
+    {
+        using is_transparent = void;
+        size_t operator()(std::string_view s) const { return std::hash<std::string_view>()(s); }
+    };
+
+    struct Slot
+    {
+        std::shared_ptr<const Asset> asset;
+        std::list<std::string>::iterator lru;   // 在 m_lru 中的位置
+    };
+
+    std::filesystem::path m_root;
+    size_t m_budget = 0;
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Slot, StringHash, std::equal_to<>> m_entries;
+    std::list<std::string> m_lru;               // 前面是最近用过的
+    size_t m_bytes = 0;
+
+    std::atomic<uint64_t> m_hits{ 0 };
+    std::atomic<uint64_t> m_misses{ 0 };
+    std::atomic<uint64_t> m_evictions{ 0 };
+
+    FileWatcher m_watcher;
+};
+
+#endif // !ASSET_CACHE_H
@@ -0,0 +1,109 @@
+﻿/**
+* @file config.cpp
+* @brief 运行参数，单例，启动时从命令行解析
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "config.h"
+#include "log.h"
+#include <format>
+#include <charconv>
+#include <cstring>
+#include <algorithm>
+
+Config& Config::getInstance()
+{
+    static Config instance;
+    return instance;
+}
+
+// 解析非负整数参数
+static bool parseNumber(const char* text, size_t& out)
+{
+    size_t value = 0;
+    auto [ptr, ec] = std::from_chars(text, text + strlen(text), value);
+    if (ec != std::errc() || *ptr != '\0') return false;
+    out = value;
+    return true;
+}
+
+bool Config::parseArgs(int argc, char* argv[])
+{
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string name = argv[i];
+        if (i + 1 >= argc)
+        {
+            LOG_ERROR(std::format("Missing value for argument {}", name));
+            return false;
+        }
+
+        const char* value = argv[++i];
+        if (name == "--io-backend")
+        {
+            io_backend = value;
+            if (io_backend != "uring" && io_backend != "epoll")
+            {
+                LOG_ERROR(std::format("Invalid value for argument {}: {}", name, value));
+                return false;
+            }
+            continue;
+        }
+        if (name == "--store")
+        {
+            store = value;
+            if (store != "files" && store != "log")
+            {
+                LOG_ERROR(std::format("Invalid value for argument {}: {}", name, value));
+                return false;
+            }
+#ifdef _WIN32
+            if (store == "log")
+            {
+                LOG_ERROR("The log store is not available on Windows, use --store files");
+                return false;
+            }
+#endif
+            continue;
+        }
+        if (name == "--assets-dir")
+        {
+            assets_dir = value;
+            continue;
+        }
+
+        size_t number = 0;
+        if (!parseNumber(value, number))
+        {
+            LOG_ERROR(std::format("Invalid value for argument {}: {}", name, value));
+            return false;
+        }
+
+        if (name == "--port") port = static_cast<int>(number);
+        else if (name == "--reactors") reactors = std::max<size_t>(number, 1);
+        else if (name == "--pin-cpu") pin_cpu = number != 0;
+        else if (name == "--workers") worker_threads = number;
+        else if (name == "--queue") queue_capacity = number;
+        else if (name == "--keepalive-timeout") keepalive_timeout = number;
+        else if (name == "--asset-cache-mb") asset_cache_mb = number;
+        else if (name == "--max-upload-mb") max_upload_mb = number;
+        else if (name == "--import-diaries") import_diaries = number != 0;
+        else if (name == "--commit-window-us") commit_window_us = number;
+        else
+        {
+            LOG_ERROR(std::format("Unknown argument {}", name));
+            return false;
+        }
+    }
+
+    LOG_INFO(std::format("Config: port={} reactors={} pin_cpu={} io_backend={} workers={} queue={} keepalive_timeout={}s asset_cache={}MB max_upload={}MB store={} commit_window={}us assets={}",
+        port, reactors, pin_cpu, io_backend, worker_threads, queue_capacity, keepalive_timeout, asset_cache_mb, max_upload_mb, store, commit_window_us,
+        assets_dir.empty() ? std::string("embedded") : assets_dir));
+    return true;
+}
+
+std::string Config::usage() const
+{
+    return "usage: footprints [--port N] [--reactors N] [--pin-cpu 0|1] [--io-backend uring|epoll] [--workers N] [--queue N] [--keepalive-timeout SECONDS] [--asset-cache-mb N] [--max-upload-mb N] [--store files|log] [--import-diaries 0|1] [--commit-window-us N] [--assets-dir DIR]";
+}
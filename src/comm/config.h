@@ -0,0 +1,45 @@
+﻿/**
+* @file config.h
+* @brief 运行参数，单例，启动时从命令行解析
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef CONFIG_H
+#define CONFIG_H
+
+#include <string>
+#include <cstddef>
+
+class Config
+{
+public:
+    static Config& getInstance();
+
+    // 解析 --name value 形式的参数，出错返回 false
+    bool parseArgs(int argc, char* argv[]);
+    std::string usage() const;
+
+public:
+    int port = 8080;                    // 监听端口
+    size_t reactors = 1;                // 事件循环线程数，大于 1 时每个线程用 SO_REUSEPORT 独立监听
+    bool pin_cpu = false;               // 事件循环线程绑定到 CPU
+    std::string io_backend = "uring";   // uring 或 epoll，内核不支持 io_uring 时自动退回 epoll
+    size_t worker_threads = 4;          // 工作线程数，0 表示在 IO 线程里直接处理
+    size_t queue_capacity = 1024;       // 工作队列上限，满了直接回 503
+    size_t keepalive_timeout = 15;      // 长连接空闲多少秒后关闭
+    size_t asset_cache_mb = 64;         // 开发模式下静态资源缓存上限（MB），0 表示不缓存
+    size_t max_upload_mb = 32;          // 请求正文上限（MB），只有流式接收的路由（比如写日记）能用到这么大
+    std::string store = "files";        // 日记存储：files 一篇一个文件，log 追加写的日志存储
+    bool import_diaries = false;        // 用 log 存储时，启动时把目录里一篇一个文件的日记导入进来（原文件移到 .imported/）
+    size_t commit_window_us = 0;        // 写日记的组提交窗口（微秒）：批里第一个请求到了再等这么久凑齐一批才落盘，0 表示不额外等
+    std::string assets_dir;             // 开发模式：非空时页面和静态资源从这个目录读，改了立即生效；为空时用编进程序的资源
+
+private:
+    Config() = default;
+    ~Config() = default;
+    Config(const Config&) = delete;
+    Config& operator=(const Config&) = delete;
+};
+
+#endif // CONFIG_H
@@ -0,0 +1,17 @@
+﻿/**
+* @file crc32.h
+* @brief CRC-32（和 zlib、gzip 相同的多项式），存储层校验记录用，不依赖 zlib
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <cstdint>
+#include <string_view>
+
+// 可以分段计算：crc32(b, crc32(a)) == crc32(a + b)
+uint32_t crc32(std::string_view data, uint32_t crc = 0);
+
+#endif // !CRC32_H
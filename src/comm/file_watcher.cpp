@@ -0,0 +1,160 @@
+﻿/**
+* @file file_watcher.cpp
+* @brief 用 inotify 监视若干目录里文件的变化，在独立线程里回调
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "file_watcher.h"
+#include "comm/log.h"
+#include <format>
+
+#ifndef _WIN32
+#include <sys/inotify.h>
+#include <sys/eventfd.h>
+#include <poll.h>
+#include <unistd.h>
+#include <cerrno>
+#include <cstring>
+#endif
+
+FileWatcher::~FileWatcher()
+{
+    stop();
+}
+
+bool FileWatcher::init()
+{
+#ifndef _WIN32
+    m_inotify_fd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+    m_stop_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_inotify_fd >= 0 && m_stop_fd >= 0)
+    {
+        return true;
+    }
+    LOG_WARN(std::format("inotify unavailable: {}", strerror(errno)));
+    stop();
+#endif
+    return false;
+}
+
+bool FileWatcher::watch(const std::string& directory)
+{
+#ifndef _WIN32
+    if (m_inotify_fd < 0)
+    {
+        return false;
+    }
+    int wd = inotify_add_watch(m_inotify_fd, directory.c_str(),
+        IN_CLOSE_WRITE | IN_MOVED_TO | IN_MOVED_FROM | IN_DELETE | IN_DELETE_SELF);
+    if (wd < 0)
+    {
+        LOG_WARN(std::format("Failed to watch {}: {}", directory, strerror(errno)));
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_directories[wd] = directory;
+    return true;
+#else
+    return false;
+#endif
+}
+
+void FileWatcher::start(Callback callback)
+{
+    if (m_inotify_fd < 0 || m_thread.joinable())
+    {
+        return;
+    }
+    m_callback = std::move(callback);
+    m_thread = std::thread([this]() { loop(); });
+}
+
+void FileWatcher::stop()
+{
+#ifndef _WIN32
+    if (m_thread.joinable())
+    {
+        uint64_t one = 1;
+        ssize_t n = write(m_stop_fd, &one, sizeof(one));
+        (void)n;
+        m_thread.join();
+    }
+    if (m_inotify_fd >= 0) close(m_inotify_fd);
+    if (m_stop_fd >= 0) close(m_stop_fd);
+    m_inotify_fd = m_stop_fd = -1;
+#endif
+}
+
+void FileWatcher::loop()
+{
+#ifndef _WIN32
+    alignas(inotify_event) char buffer[16 * 1024];
+    pollfd fds[2] = { { m_inotify_fd, POLLIN, 0 }, { m_stop_fd, POLLIN, 0 } };
+
+    while (true)
+    {
+        if (poll(fds, 2, -1) < 0)
+        {
+            if (errno == EINTR) continue;
+            LOG_ERROR(std::format("File watcher poll failed: {}", strerror(errno)));
+            return;
+        }
+        if (fds[1].revents)
+        {
+            return;
+        }
+
+        ssize_t n;
+        while ((n = read(m_inotify_fd, buffer, sizeof(buffer))) > 0)
+        {
+            for (char* p = buffer; p < buffer + n;)
+            {
+                auto* event = reinterpret_cast<inotify_event*>(p);
+                p += sizeof(inotify_event) + event->len;
+
+                if (event->mask & IN_Q_OVERFLOW)
+                {
+                    LOG_WARN("File watcher queue overflowed");
+                    m_callback(Event::Overflow, std::string());
+                    continue;
+                }
+
+                std::string directory;
+                {
+                    std::lock_guard<std::mutex> lock(m_mutex);
+                    auto it = m_directories.find(event->wd);
+                    if (it == m_directories.end()) continue;
+                    directory = it->second;
+                    if (event->mask & IN_IGNORED)
+                    {
+                        m_directories.erase(it);
+                    }
+                }
+                if (event->mask & IN_DELETE_SELF)
+                {
+                    LOG_WARN(std::format("Watched directory {} is gone", directory));
+                    continue;
+                }
+                if (event->len == 0)
+                {
+                    continue;
+                }
+
+                std::string path = directory;
+                if (!path.empty() && path.back() != '/') path += '/';
+                path += event->name;
+
+                if (event->mask & (IN_CLOSE_WRITE | IN_MOVED_TO))
+                {
+                    m_callback(Event::Changed, path);
+                }
+                else if (event->mask & (IN_DELETE | IN_MOVED_FROM))
+                {
+                    m_callback(Event::Removed, path);
+                }
+            }
+        }
+    }
+#endif
+}
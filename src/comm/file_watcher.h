@@ -0,0 +1,53 @@
+﻿/**
+* @file file_watcher.h
+* @brief 用 inotify 监视若干目录里文件的变化，在独立线程里回调
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef FILE_WATCHER_H
+#define FILE_WATCHER_H
+
+#include <string>
+#include <functional>
+#include <unordered_map>
+#include <mutex>
+#include <thread>
+
+class FileWatcher
+{
+public:
+    enum class Event
+    {
+        Changed,    // 写完关闭，或者移进目录
+        Removed,    // 删除，或者移出目录
+        Overflow    // 事件队列溢出，有变化丢了，path 为空，调用方应当全部重新检查
+    };
+
+    // path 是 目录/文件名
+    using Callback = std::function<void(Event event, const std::string& path)>;
+
+    FileWatcher() = default;
+    ~FileWatcher();
+    FileWatcher(const FileWatcher&) = delete;
+    FileWatcher& operator=(const FileWatcher&) = delete;
+
+    // 开始监视前准备好 inotify，失败（或者不支持的平台）返回 false，之后的 watch 都是空操作
+    bool init();
+    // 监视一个目录（不递归），init 之后、start 前后都可以调用
+    bool watch(const std::string& directory);
+    void start(Callback callback);
+    void stop();
+
+private:
+    void loop();
+
+    int m_inotify_fd = -1;
+    int m_stop_fd = -1;
+    std::mutex m_mutex;
+    std::unordered_map<int, std::string> m_directories;  // watch 描述符 -> 目录
+    Callback m_callback;
+    std::thread m_thread;
+};
+
+#endif // !FILE_WATCHER_H
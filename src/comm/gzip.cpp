@@ -0,0 +1,104 @@
+﻿/**
+* @file gzip.cpp
+* @brief gzip 压缩，服务端动态压缩和构建期的资源嵌入工具共用；没有 zlib 时不压缩
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "gzip.h"
+#include <algorithm>
+
+#ifdef HAVE_ZLIB
+#include <zlib.h>
+
+namespace
+{
+    // deflate 的状态有几百 KB，每次压缩都初始化一遍很浪费，线程内用 deflateReset 复用
+    struct Deflater
+    {
+        z_stream stream{};
+        int level = 0;
+        bool ready = false;
+
+        ~Deflater()
+        {
+            if (ready) deflateEnd(&stream);
+        }
+
+        bool prepare(int wanted)
+        {
+            if (ready && level == wanted)
+            {
+                return deflateReset(&stream) == Z_OK;
+            }
+            if (ready) deflateEnd(&stream);
+            stream = z_stream{};
+            level = wanted;
+            // windowBits 加 16 输出 gzip 格式
+            ready = deflateInit2(&stream, level, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) == Z_OK;
+            return ready;
+        }
+    };
+}
+#endif
+
+bool gzipAvailable()
+{
+#ifdef HAVE_ZLIB
+    return true;
+#else
+    return false;
+#endif
+}
+
+bool gzipCompress(std::string_view input, std::string& out, int level)
+{
+#ifdef HAVE_ZLIB
+    thread_local Deflater deflater;
+    if (!deflater.prepare(level))
+    {
+        return false;
+    }
+    z_stream& zs = deflater.stream;
+
+    constexpr size_t CHUNK = 64 * 1024;
+    const size_t start = out.size();
+    out.reserve(start + deflateBound(&zs, static_cast<uLong>(input.size())));
+
+    size_t offset = 0;
+    int flush = Z_NO_FLUSH;
+    int ret = Z_OK;
+    do
+    {
+        size_t take = std::min(CHUNK, input.size() - offset);
+        zs.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(input.data() + offset));
+        zs.avail_in = static_cast<uInt>(take);
+        offset += take;
+        flush = offset == input.size() ? Z_FINISH : Z_NO_FLUSH;
+
+        // 输出区满了就扩一段继续，预留过上界，一般不会真的重新分配
+        do
+        {
+            size_t used = out.size();
+            size_t room = std::max(out.capacity() - used, CHUNK);
+            out.resize(used + room);
+            zs.next_out = reinterpret_cast<Bytef*>(out.data() + used);
+            zs.avail_out = static_cast<uInt>(room);
+            ret = deflate(&zs, flush);
+            out.resize(used + room - zs.avail_out);
+        } while (zs.avail_out == 0 && ret == Z_OK);
+    } while (flush != Z_FINISH && ret == Z_OK);
+
+    if (ret != Z_STREAM_END)
+    {
+        out.resize(start);
+        return false;
+    }
+    return true;
+#else
+    (void)input;
+    (void)out;
+    (void)level;
+    return false;
+#endif
+}
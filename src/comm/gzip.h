@@ -0,0 +1,22 @@
+﻿/**
+* @file gzip.h
+* @brief gzip 压缩，服务端动态压缩和构建期的资源嵌入工具共用；没有 zlib 时不压缩
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef GZIP_H
+#define GZIP_H
+
+#include <string>
+#include <string_view>
+
+// 编译时有没有 zlib
+bool gzipAvailable();
+
+// 把 input 压缩成 gzip 格式追加到 out 后面，失败或没有 zlib 时返回 false，out 不变。
+// 每个线程复用一个压缩流，只在第一次或换压缩等级时初始化；
+// 输入按固定大小分段送进去，输出按上界一次预留，整个过程最多分配一次
+bool gzipCompress(std::string_view input, std::string& out, int level = 6);
+
+#endif // !GZIP_H
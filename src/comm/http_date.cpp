@@ -0,0 +1,73 @@
+﻿/**
+* @file http_date.cpp
+* @brief HTTP 日期（IMF-fixdate，如 "Sun, 06 Nov 1994 08:49:37 GMT"）和 time_t 之间的转换
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "http_date.h"
+#include <cstdint>
+
+std::string formatHttpDate(time_t t)
+{
+    tm tm_utc{};
+#ifdef _WIN32
+    gmtime_s(&tm_utc, &t);
+#else
+    gmtime_r(&t, &tm_utc);
+#endif
+    char buf[64];
+    size_t n = strftime(buf, sizeof(buf), "%a, %d %b %Y %H:%M:%S GMT", &tm_utc);
+    return std::string(buf, n);
+}
+
+// 公历日期到 1970-01-01 的天数，不依赖 timegm（Windows 上没有）
+static int64_t daysFromCivil(int64_t y, unsigned m, unsigned d)
+{
+    y -= m <= 2;
+    const int64_t era = (y >= 0 ? y : y - 399) / 400;
+    const unsigned yoe = static_cast<unsigned>(y - era * 400);
+    const unsigned doy = (153 * (m > 2 ? m - 3 : m + 9) + 2) / 5 + d - 1;
+    const unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+    return era * 146097 + static_cast<int64_t>(doe) - 719468;
+}
+
+static bool parseDigits(std::string_view text, size_t pos, size_t count, int& out)
+{
+    out = 0;
+    for (size_t i = pos; i < pos + count; ++i)
+    {
+        if (text[i] < '0' || text[i] > '9') return false;
+        out = out * 10 + (text[i] - '0');
+    }
+    return true;
+}
+
+bool parseHttpDate(std::string_view text, time_t& out)
+{
+    // "Sun, 06 Nov 1994 08:49:37 GMT"，定长 29 个字符
+    if (text.size() != 29 || text[3] != ',' || text[4] != ' ' || text[7] != ' ' || text[11] != ' ' ||
+        text[16] != ' ' || text[19] != ':' || text[22] != ':' || text.substr(25) != " GMT")
+    {
+        return false;
+    }
+
+    static constexpr std::string_view MONTHS = "JanFebMarAprMayJunJulAugSepOctNovDec";
+    size_t month = MONTHS.find(text.substr(8, 3));
+    if (month == std::string_view::npos || month % 3 != 0)
+    {
+        return false;
+    }
+
+    int day, year, hour, minute, second;
+    if (!parseDigits(text, 5, 2, day) || !parseDigits(text, 12, 4, year) ||
+        !parseDigits(text, 17, 2, hour) || !parseDigits(text, 20, 2, minute) || !parseDigits(text, 23, 2, second) ||
+        day < 1 || day > 31 || hour > 23 || minute > 59 || second > 60)
+    {
+        return false;
+    }
+
+    int64_t days = daysFromCivil(year, static_cast<unsigned>(month / 3 + 1), static_cast<unsigned>(day));
+    out = static_cast<time_t>(days * 86400 + hour * 3600 + minute * 60 + second);
+    return true;
+}
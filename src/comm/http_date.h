@@ -0,0 +1,21 @@
+﻿/**
+* @file http_date.h
+* @brief HTTP 日期（IMF-fixdate，如 "Sun, 06 Nov 1994 08:49:37 GMT"）和 time_t 之间的转换
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef HTTP_DATE_H
+#define HTTP_DATE_H
+
+#include <string>
+#include <string_view>
+#include <ctime>
+
+std::string formatHttpDate(time_t t);
+
+// 只认 IMF-fixdate。RFC 850 和 asctime 两种旧格式现在的客户端已经不发了，
+// 解析失败时调用方当作没带这个头，最多是多回一次完整响应
+bool parseHttpDate(std::string_view text, time_t& out);
+
+#endif // !HTTP_DATE_H
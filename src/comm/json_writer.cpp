@@ -0,0 +1,275 @@
+﻿/**
+* @file json_writer.cpp
+* @brief 流式 JSON 输出，直接追加到调用方的缓冲区，字符串转义按 CPU 支持的指令集选 AVX2 / SSE2 / 标量实现
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "json_writer.h"
+#include "simd_dispatch.h"
+#include <array>
+#include <charconv>
+
+#ifdef SIMD_X86
+#include <immintrin.h>
+#endif
+
+// 扫描要停下来的字节：引号、反斜杠、0x00-0x1f 要转义，>= 0x80 的是多字节字符，要校验是不是合法的 UTF-8
+static constexpr std::array<bool, 256> STOP_SCAN = []()
+{
+    std::array<bool, 256> table{};
+    for (unsigned c = 0; c < 0x20; ++c)
+    {
+        table[c] = true;
+    }
+    for (unsigned c = 0x80; c < 0x100; ++c)
+    {
+        table[c] = true;
+    }
+    table['"'] = true;
+    table['\\'] = true;
+    return table;
+}();
+
+// 在 [begin, end) 中找第一个要停下来的字节，找不到返回 end
+static const char* scanEscapeScalar(const char* begin, const char* end)
+{
+    while (begin != end && !STOP_SCAN[static_cast<unsigned char>(*begin)])
+    {
+        ++begin;
+    }
+    return begin;
+}
+
+#ifdef SIMD_X86
+
+// 一次看 16 个字节：等于引号、等于反斜杠、无符号不大于 0x1f（min(v, 0x1f) == v），三个掩码或起来，
+// 最高位为 1 的字节 movemask 直接就能取到
+__attribute__((target("sse2")))
+static const char* scanEscapeSse2(const char* begin, const char* end)
+{
+    const __m128i quote = _mm_set1_epi8('"');
+    const __m128i backslash = _mm_set1_epi8('\\');
+    const __m128i control = _mm_set1_epi8(0x1f);
+    while (end - begin >= 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(begin));
+        __m128i hit = _mm_or_si128(_mm_or_si128(_mm_cmpeq_epi8(v, quote), _mm_cmpeq_epi8(v, backslash)),
+            _mm_cmpeq_epi8(_mm_min_epu8(v, control), v));
+        unsigned mask = static_cast<unsigned>(_mm_movemask_epi8(_mm_or_si128(hit, v)));
+        if (mask)
+        {
+            return begin + __builtin_ctz(mask);
+        }
+        begin += 16;
+    }
+    return scanEscapeScalar(begin, end);
+}
+
+__attribute__((target("avx2")))
+static const char* scanEscapeAvx2(const char* begin, const char* end)
+{
+    const __m256i quote = _mm256_set1_epi8('"');
+    const __m256i backslash = _mm256_set1_epi8('\\');
+    const __m256i control = _mm256_set1_epi8(0x1f);
+    while (end - begin >= 32)
+    {
+        __m256i v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(begin));
+        __m256i hit = _mm256_or_si256(_mm256_or_si256(_mm256_cmpeq_epi8(v, quote), _mm256_cmpeq_epi8(v, backslash)),
+            _mm256_cmpeq_epi8(_mm256_min_epu8(v, control), v));
+        unsigned mask = static_cast<unsigned>(_mm256_movemask_epi8(_mm256_or_si256(hit, v)));
+        if (mask)
+        {
+            return begin + __builtin_ctz(mask);
+        }
+        begin += 32;
+    }
+    return scanEscapeSse2(begin, end);
+}
+
+#endif // SIMD_X86
+
+using ScanEscape = const char* (*)(const char*, const char*);
+
+static constexpr SimdKernels<ScanEscape> SCAN_ESCAPE_KERNELS = {
+    .scalar = scanEscapeScalar,
+#ifdef SIMD_X86
+    .sse2 = scanEscapeSse2,
+    .avx2 = scanEscapeAvx2,
+#endif
+};
+
+static const ScanEscape g_scan_escape = SCAN_ESCAPE_KERNELS.pick();
+
+// p 开头是一个完整、合法的 UTF-8 多字节字符时返回它的长度，否则返回 0。
+// 过长编码、代理区（U+D800-U+DFFF）和超过 U+10FFFF 的都不合法（Unicode 标准表 3-7）
+static size_t utf8Length(const unsigned char* p, const unsigned char* end)
+{
+    unsigned char lo = 0x80;
+    unsigned char hi = 0xbf;
+    size_t n = 0;
+    if (p[0] >= 0xc2 && p[0] <= 0xdf) n = 2;
+    else if (p[0] == 0xe0) { n = 3; lo = 0xa0; }
+    else if (p[0] == 0xed) { n = 3; hi = 0x9f; }
+    else if (p[0] >= 0xe1 && p[0] <= 0xef) n = 3;
+    else if (p[0] == 0xf0) { n = 4; lo = 0x90; }
+    else if (p[0] >= 0xf1 && p[0] <= 0xf3) n = 4;
+    else if (p[0] == 0xf4) { n = 4; hi = 0x8f; }
+    else return 0;
+
+    if (static_cast<size_t>(end - p) < n || p[1] < lo || p[1] > hi)
+    {
+        return 0;
+    }
+    for (size_t i = 2; i < n; ++i)
+    {
+        if ((p[i] & 0xc0) != 0x80)
+        {
+            return 0;
+        }
+    }
+    return n;
+}
+
+void appendJsonString(std::string& out, std::string_view text)
+{
+    static constexpr char HEX[] = "0123456789abcdef";
+
+    out += '"';
+    const char* begin = text.data();
+    const char* end = begin + text.size();
+    while (true)
+    {
+        // 不用转义的一整段一次拷贝，正文里转义字符很少（主要是换行），大部分时间在向量扫描里；
+        // 扫描停在多字节字符上时校验一个字符接着扫，合法的字符和前后的 ASCII 一起拷贝
+        const char* p = g_scan_escape(begin, end);
+        size_t n = 0;
+        while (p != end && static_cast<unsigned char>(*p) >= 0x80 &&
+            (n = utf8Length(reinterpret_cast<const unsigned char*>(p), reinterpret_cast<const unsigned char*>(end))) != 0)
+        {
+            p = g_scan_escape(p + n, end);
+        }
+        out.append(begin, p);
+        if (p == end)
+        {
+            break;
+        }
+
+        unsigned char c = static_cast<unsigned char>(*p);
+        switch (c)
+        {
+        case '"': out += "\\\""; break;
+        case '\\': out += "\\\\"; break;
+        case '\n': out += "\\n"; break;
+        case '\r': out += "\\r"; break;
+        case '\t': out += "\\t"; break;
+        case '\b': out += "\\b"; break;
+        case '\f': out += "\\f"; break;
+        default:
+            if (c >= 0x80)
+            {
+                // 不是合法 UTF-8 的字节（文件是别的编码、截断在字符中间）输出成替换字符，一个字节一个，
+                // 否则整个响应都不是合法的 JSON，客户端解析直接失败
+                out += "\\ufffd";
+                break;
+            }
+            out += "\\u00";
+            out += HEX[c >> 4];
+            out += HEX[c & 15];
+            break;
+        }
+        begin = p + 1;
+    }
+    out += '"';
+}
+
+void JsonWriter::separate()
+{
+    if (m_need_comma)
+    {
+        m_out += ',';
+    }
+}
+
+JsonWriter& JsonWriter::beginObject()
+{
+    separate();
+    m_out += '{';
+    m_need_comma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::endObject()
+{
+    m_out += '}';
+    m_need_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::beginArray()
+{
+    separate();
+    m_out += '[';
+    m_need_comma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::endArray()
+{
+    m_out += ']';
+    m_need_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::key(std::string_view name)
+{
+    separate();
+    appendJsonString(m_out, name);
+    m_out += ':';
+    m_need_comma = false;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(std::string_view text)
+{
+    separate();
+    appendJsonString(m_out, text);
+    m_need_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(int64_t number)
+{
+    char buffer[24];
+    auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), number);
+    separate();
+    m_out.append(buffer, ptr);
+    m_need_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(uint64_t number)
+{
+    char buffer[24];
+    auto [ptr, ec] = std::to_chars(buffer, buffer + sizeof(buffer), number);
+    separate();
+    m_out.append(buffer, ptr);
+    m_need_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::value(bool flag)
+{
+    separate();
+    m_out += flag ? "true" : "false";
+    m_need_comma = true;
+    return *this;
+}
+
+JsonWriter& JsonWriter::null()
+{
+    separate();
+    m_out += "null";
+    m_need_comma = true;
+    return *this;
+}
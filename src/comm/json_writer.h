@@ -0,0 +1,47 @@
+﻿/**
+* @file json_writer.h
+* @brief 流式 JSON 输出，直接追加到调用方的缓冲区，字符串转义按 CPU 支持的指令集选 AVX2 / SSE2 / 标量实现
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef JSON_WRITER_H
+#define JSON_WRITER_H
+
+#include <string>
+#include <string_view>
+#include <cstdint>
+
+// 把 text 作为 JSON 字符串（带引号）追加到 out。合法的 UTF-8 原样输出，转义引号、反斜杠和控制字符，
+// 不是合法 UTF-8 的字节换成 \ufffd，保证输出总是合法的 JSON
+void appendJsonString(std::string& out, std::string_view text);
+
+// 边写边输出，不建中间的对象树。逗号和冒号自动加，begin/end 的配对、对象里 key 和值交替由调用方保证。
+// 写进的是调用方的字符串，一般就是之后移动进响应的正文，不再拷贝
+class JsonWriter
+{
+public:
+    explicit JsonWriter(std::string& out) : m_out(out) {}
+
+    JsonWriter& beginObject();
+    JsonWriter& endObject();
+    JsonWriter& beginArray();
+    JsonWriter& endArray();
+    JsonWriter& key(std::string_view name);
+
+    JsonWriter& value(std::string_view text);
+    JsonWriter& value(const char* text) { return value(std::string_view(text)); }
+    JsonWriter& value(int64_t number);
+    JsonWriter& value(uint64_t number);
+    JsonWriter& value(bool flag);
+    JsonWriter& null();
+
+private:
+    void separate();
+
+private:
+    std::string& m_out;
+    bool m_need_comma = false;  // 同一层上已经写过值，下一个值或 key 之前要加逗号
+};
+
+#endif // !JSON_WRITER_H
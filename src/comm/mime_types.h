@@ -0,0 +1,42 @@
+﻿/**
+* @file mime_types.h
+* @brief 按扩展名查 Content-Type，资源缓存和构建期的资源嵌入工具共用
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef MIME_TYPES_H
+#define MIME_TYPES_H
+
+#include <string_view>
+#include <utility>
+
+// 按扩展名（含点，如 ".js"）猜 Content-Type
+constexpr std::string_view guessMimeType(std::string_view extension)
+{
+    constexpr std::pair<std::string_view, std::string_view> mime[] =
+    {
+        {".html", "text/html"},
+        {".htm", "text/html"},
+        {".css", "text/css"},
+        {".js", "application/javascript"},
+        {".png", "image/png" },
+        {".jpg", "image/jpeg"},
+        {".gif", "image/gif"},
+        {".svg", "image/svg+xml"},
+        {".ico", "image/x-icon"}
+    };
+    for (const auto& kv : mime)
+    {
+        if (kv.first == extension) return kv.second;
+    }
+    return "application/octet-stream";
+}
+
+// 文本类型压缩效果好，图片这类本身已经压缩过的不值得再压
+constexpr bool isCompressibleMime(std::string_view type)
+{
+    return type.starts_with("text/") || type == "application/javascript" || type == "image/svg+xml";
+}
+
+#endif // !MIME_TYPES_H
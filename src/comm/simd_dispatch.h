@@ -0,0 +1,75 @@
+﻿/**
+* @file simd_dispatch.h
+* @brief 运行时按 CPU 支持的指令集挑选实现（JSON 转义在用）
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef SIMD_DISPATCH_H
+#define SIMD_DISPATCH_H
+
+// 只有 x86 上的 GCC / Clang 才编译向量实现，其他平台只有标量版本。
+// 定义了 SIMD_X86 时由写向量实现的 .cpp 自己包含 <immintrin.h>
+#if (defined(__x86_64__) || defined(__i386__)) && defined(__GNUC__)
+#define SIMD_X86 1
+#endif
+
+// 从低到高排列，高的级别包含低的
+enum class SimdLevel
+{
+    Scalar = 0,
+    Sse2,
+    Sse42,
+    Avx2
+};
+
+inline const char* simdLevelName(SimdLevel level)
+{
+    switch (level)
+    {
+    case SimdLevel::Sse2: return "sse2";
+    case SimdLevel::Sse42: return "sse4.2";
+    case SimdLevel::Avx2: return "avx2";
+    default: return "scalar";
+    }
+}
+
+// 本机支持的最高级别，只检测一次
+inline SimdLevel simdLevel()
+{
+    static const SimdLevel level = []()
+    {
+#ifdef SIMD_X86
+        __builtin_cpu_init();
+        if (__builtin_cpu_supports("avx2")) return SimdLevel::Avx2;
+        if (__builtin_cpu_supports("sse4.2")) return SimdLevel::Sse42;
+        if (__builtin_cpu_supports("sse2")) return SimdLevel::Sse2;
+#endif
+        return SimdLevel::Scalar;
+    }();
+    return level;
+}
+
+// 一个函数各级别的实现，没有写的级别留空，scalar 必须有
+template <typename Fn>
+struct SimdKernels
+{
+    Fn scalar = nullptr;
+    Fn sse2 = nullptr;
+    Fn sse42 = nullptr;
+    Fn avx2 = nullptr;
+
+    // 不高于 level 的实现里最快的一个
+    Fn pick(SimdLevel level) const
+    {
+        if (level >= SimdLevel::Avx2 && avx2) return avx2;
+        if (level >= SimdLevel::Sse42 && sse42) return sse42;
+        if (level >= SimdLevel::Sse2 && sse2) return sse2;
+        return scalar;
+    }
+
+    // 本机能用的最快实现，一般在静态初始化时调用一次存下来
+    Fn pick() const { return pick(simdLevel()); }
+};
+
+#endif // !SIMD_DISPATCH_H
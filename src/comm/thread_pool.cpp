@@ -0,0 +1,104 @@
+﻿/**
+* @file thread_pool.cpp
+* @brief 固定大小的工作线程池，任务队列有上限，满了拒绝而不是排队
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "thread_pool.h"
+#include "log.h"
+#include <format>
+
+ThreadPool::ThreadPool(size_t thread_count, size_t queue_capacity)
+    : m_capacity(queue_capacity),
+    m_exit(false),
+    m_completed(0),
+    m_rejected(0)
+{
+    for (size_t i = 0; i < thread_count; ++i)
+    {
+        m_workers.emplace_back([this]() { this->workerLoop(); });
+    }
+    LOG_INFO(std::format("Thread pool started: {} threads, queue capacity {}", thread_count, queue_capacity));
+}
+
+ThreadPool::~ThreadPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        m_exit = true;
+    }
+    m_cv.notify_all();
+    for (auto& worker : m_workers)
+    {
+        if (worker.joinable())
+            worker.join();
+    }
+}
+
+bool ThreadPool::trySubmit(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_queueMutex);
+        if (m_queue.size() >= m_capacity)
+        {
+            ++m_rejected;
+            return false;
+        }
+        m_queue.push(std::move(task));
+    }
+    m_cv.notify_one();
+    return true;
+}
+
+size_t ThreadPool::threadCount() const
+{
+    return m_workers.size();
+}
+
+size_t ThreadPool::queueCapacity() const
+{
+    return m_capacity;
+}
+
+size_t ThreadPool::queueSize()
+{
+    std::lock_guard<std::mutex> lock(m_queueMutex);
+    return m_queue.size();
+}
+
+uint64_t ThreadPool::completedCount() const
+{
+    return m_completed;
+}
+
+uint64_t ThreadPool::rejectedCount() const
+{
+    return m_rejected;
+}
+
+void ThreadPool::workerLoop()
+{
+    while (true)
+    {
+        std::function<void()> task;
+        {
+            std::unique_lock<std::mutex> lock(m_queueMutex);
+            m_cv.wait(lock, [this]() { return !m_queue.empty() || m_exit; });
+            if (m_queue.empty()) return; // m_exit 且队列已清空
+
+            task = std::move(m_queue.front());
+            m_queue.pop();
+        }
+
+        try
+        {
+            task();
+        }
+        catch (const std::exception& e)
+        {
+            LOG_ERROR(std::format("Worker task threw: {}", e.what()));
+        }
+        ++m_completed;
+    }
+}
@@ -0,0 +1,53 @@
+﻿/**
+* @file thread_pool.h
+* @brief 固定大小的工作线程池，任务队列有上限，满了拒绝而不是排队
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <functional>
+#include <queue>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <cstdint>
+
+class ThreadPool
+{
+public:
+    ThreadPool(size_t thread_count, size_t queue_capacity);
+    ~ThreadPool();
+    ThreadPool(const ThreadPool&) = delete;
+    ThreadPool& operator=(const ThreadPool&) = delete;
+
+    // 队列已满返回 false，调用方负责降级处理
+    bool trySubmit(std::function<void()> task);
+
+    size_t threadCount() const;
+    size_t queueCapacity() const;
+    size_t queueSize();
+    uint64_t completedCount() const;
+    uint64_t rejectedCount() const;
+
+private:
+    void workerLoop();
+
+private:
+    size_t m_capacity;
+    std::vector<std::thread> m_workers;
+
+    std::mutex m_queueMutex;
+    std::queue<std::function<void()>> m_queue;
+    std::condition_variable m_cv;
+    bool m_exit;
+
+    std::atomic<uint64_t> m_completed;
+    std::atomic<uint64_t> m_rejected;
+};
+
+#endif // THREAD_POOL_H
@@ -0,0 +1,382 @@
+﻿/**
+* @file diary_index.cpp
+* @brief 常驻内存的日记索引，启动时扫描一次目录，之后由写入/删除和 inotify 增量更新
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "diary_index.h"
+#include "comm/log.h"
+#include <algorithm>
+#include <filesystem>
+#include <format>
+#include <chrono>
+
+static bool byFilename(const DiaryEntry& a, const DiaryEntry& b)
+{
+    return a.filename < b.filename;
+}
+
+// 有日期的在前，新的在前；文件名以日期开头，同样有日期时直接比文件名就是先比日期
+static bool newerFirst(const DiaryEntry* a, const DiaryEntry* b)
+{
+    if (a->date.empty() != b->date.empty())
+    {
+        return b->date.empty();
+    }
+    return a->filename > b->filename;
+}
+
+// 文件名形如 "(2025-08-18)标题"，不是这个格式返回空
+static std::string dateOf(const std::string& filename)
+{
+    if (filename.size() >= 12 && filename[0] == '(' && filename[11] == ')' &&
+        DiaryIndex::isDate(std::string_view(filename).substr(1, 10)))
+    {
+        return filename.substr(1, 10);
+    }
+    return {};
+}
+
+DiaryIndex& DiaryIndex::getInstance()
+{
+    static DiaryIndex instance;
+    return instance;
+}
+
+DiaryIndex::~DiaryIndex()
+{
+    stop();
+}
+
+bool DiaryIndex::start(const std::string& directory, std::unique_ptr<DiaryStore> store)
+{
+    m_directory = directory;
+    m_store = std::move(store);
+    m_version.generation = static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count());
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    if (ec)
+    {
+        LOG_ERROR(std::format("Failed to create diary directory {}: {}", m_directory, ec.message()));
+        return false;
+    }
+
+    // 日记存在日志存储里时只有服务器自己会改，不用监视
+    if (!m_store->filesInDirectory())
+    {
+        reload();
+        LOG_INFO(std::format("Diary index loaded {} entries from the log store", snapshot()->size()));
+        return true;
+    }
+
+    // 先开始监视再扫描，扫描期间发生的变化也不会漏掉
+    m_watching = m_watcher.init() && m_watcher.watch(m_directory);
+    if (!m_watching)
+    {
+        LOG_WARN(std::format("Changes to {} made outside the server won't be noticed", m_directory));
+    }
+
+    reload();
+    LOG_INFO(std::format("Diary index loaded {} entries from {}", snapshot()->size(), m_directory));
+
+    m_watcher.start([this](FileWatcher::Event event, const std::string& path)
+        {
+            std::string filename = std::filesystem::path(path).filename().string();
+            switch (event)
+            {
+            case FileWatcher::Event::Changed:
+                if (!consumeExpected(filename)) refresh(filename, false);
+                break;
+            case FileWatcher::Event::Removed: remove(filename); break;
+            case FileWatcher::Event::Overflow: reload(); break;
+            }
+        });
+    return true;
+}
+
+void DiaryIndex::stop()
+{
+    m_watcher.stop();
+}
+
+DiaryIndex::Snapshot DiaryIndex::snapshot() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return Snapshot(m_listing, &m_listing->entries);
+}
+
+DiaryIndex::Snapshot DiaryIndex::snapshot(Version& version) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    version = m_version;
+    return Snapshot(m_listing, &m_listing->entries);
+}
+
+bool DiaryIndex::isDate(std::string_view date)
+{
+    if (date.size() != 10 || date[4] != '-' || date[7] != '-')
+    {
+        return false;
+    }
+    for (size_t i : { 0, 1, 2, 3, 5, 6, 8, 9 })
+    {
+        if (date[i] < '0' || date[i] > '9')
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+DiaryIndex::Page DiaryIndex::page(const DiaryPageQuery& query, Version& version) const
+{
+    std::shared_ptr<const Listing> listing;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        version = m_version;
+        listing = m_listing;
+    }
+
+    // by_date 里有日期的在前，日期从新到旧，所以按日期的条件都是一个前缀，可以用 partition_point 二分
+    const std::vector<const DiaryEntry*>& by_date = listing->by_date;
+    auto begin = by_date.begin();
+    auto end = by_date.end();
+    bool filtered = !query.from.empty() || !query.to.empty();
+    if (!query.to.empty())
+    {
+        begin = std::partition_point(begin, end,
+            [&](const DiaryEntry* entry) { return !entry->date.empty() && entry->date > query.to; });
+    }
+    if (filtered)
+    {
+        end = std::partition_point(begin, end,
+            [&](const DiaryEntry* entry) { return !entry->date.empty() && entry->date >= query.from; });
+    }
+
+    Page page;
+    page.total = static_cast<size_t>(end - begin);
+    if (!query.after.empty())
+    {
+        // 游标那一条可能已经删了，按排序键找它后面的位置就行，不要求它还在
+        DiaryEntry key;
+        key.filename = query.after;
+        key.date = dateOf(query.after);
+        begin = std::upper_bound(begin, end, &key, newerFirst);
+    }
+
+    size_t limit = std::clamp<size_t>(query.limit, 1, DiaryPageQuery::MAX_LIMIT);
+    auto last = end - begin > static_cast<ptrdiff_t>(limit) ? begin + limit : end;
+    page.entries.assign(begin, last);
+    if (last != end)
+    {
+        page.next = page.entries.back()->filename;
+    }
+    page.snapshot = Snapshot(listing, &listing->entries);
+    return page;
+}
+
+bool DiaryIndex::find(const std::string& filename, DiaryEntry& entry) const
+{
+    Snapshot entries = snapshot();
+    DiaryEntry key;
+    key.filename = filename;
+    auto it = std::lower_bound(entries->begin(), entries->end(), key, byFilename);
+    if (it == entries->end() || it->filename != filename)
+    {
+        return false;
+    }
+    entry = *it;
+    return true;
+}
+
+bool DiaryIndex::load(const std::string& filename, DiaryEntry& entry) const
+{
+    // 标题只看第一行，不用读整篇
+    static constexpr size_t TITLE_BYTES = 1024;
+
+    DiaryStat stat;
+    std::string head;
+    if (!m_store->stat(filename, stat) || !m_store->read(filename, head, TITLE_BYTES))
+    {
+        return false;
+    }
+
+    entry.filename = filename;
+    entry.size = stat.size;
+    entry.mtime = stat.mtime;
+    entry.date = dateOf(filename);
+    entry.title = head.substr(0, head.find('\n'));
+    if (entry.title.empty())
+    {
+        entry.title = entry.date.empty() ? filename : filename.substr(12);
+    }
+    return true;
+}
+
+void DiaryIndex::reload()
+{
+    std::vector<DiaryEntry> entries;
+    for (const std::string& filename : m_store->list())
+    {
+        DiaryEntry entry;
+        if (load(filename, entry))
+        {
+            entries.push_back(std::move(entry));
+        }
+    }
+    std::sort(entries.begin(), entries.end(), byFilename);
+
+    std::shared_ptr<const Listing> previous;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        for (DiaryEntry& entry : entries)
+        {
+            entry.version = m_version.generation + 1;
+        }
+        previous = m_listing;
+        publish(std::move(entries));
+    }
+
+    // 事件丢了才会整个重新扫描，不知道哪些变了，全部通知一遍，没变的由监听方自己跳过
+    if (m_listener)
+    {
+        Snapshot current = snapshot();
+        for (const DiaryEntry& entry : previous->entries)
+        {
+            DiaryEntry key;
+            key.filename = entry.filename;
+            if (!std::binary_search(current->begin(), current->end(), key, byFilename))
+            {
+                m_listener(entry.filename, true);
+            }
+        }
+        for (const DiaryEntry& entry : *current)
+        {
+            m_listener(entry.filename, false);
+        }
+    }
+}
+
+// 调用方持有 m_mutex
+void DiaryIndex::publish(std::vector<DiaryEntry> entries)
+{
+    // entries 已经按文件名排好，倒过来再把没有日期的挪到后面就是按日期的顺序，不用再排一次
+    auto listing = std::make_shared<Listing>();
+    listing->entries = std::move(entries);
+    listing->by_date.reserve(listing->entries.size());
+    for (auto it = listing->entries.rbegin(); it != listing->entries.rend(); ++it)
+    {
+        listing->by_date.push_back(&*it);
+    }
+    std::stable_partition(listing->by_date.begin(), listing->by_date.end(),
+        [](const DiaryEntry* entry) { return !entry->date.empty(); });
+    m_listing = std::move(listing);
+    ++m_version.generation;
+    m_version.modified = time(nullptr);
+}
+
+void DiaryIndex::expectWrite(const std::string& filename)
+{
+    if (m_watching)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_expected[filename] = ExpectedWrite();
+    }
+}
+
+void DiaryIndex::update(const std::string& filename)
+{
+    refresh(filename, true);
+}
+
+void DiaryIndex::refresh(const std::string& filename, bool written)
+{
+    DiaryEntry entry;
+    if (filename.empty() || filename[0] == '.' || !load(filename, entry))
+    {
+        remove(filename);
+        return;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto expected = written ? m_expected.find(filename) : m_expected.end();
+        if (expected != m_expected.end())
+        {
+            // 事件已经在写的过程中到过了就不再等；没到的话记下读到的样子，等它来了认出来
+            if (expected->second.seen)
+            {
+                m_expected.erase(expected);
+            }
+            else
+            {
+                expected->second.writing = false;
+                expected->second.stat = DiaryStat{ entry.size, entry.mtime };
+            }
+        }
+        entry.version = m_version.generation + 1;
+        std::vector<DiaryEntry> entries = m_listing->entries;
+        auto it = std::lower_bound(entries.begin(), entries.end(), entry, byFilename);
+        if (it != entries.end() && it->filename == filename)
+        {
+            *it = std::move(entry);
+        }
+        else
+        {
+            entries.insert(it, std::move(entry));
+        }
+        publish(std::move(entries));
+    }
+    if (m_listener)
+    {
+        m_listener(filename, false);
+    }
+}
+
+bool DiaryIndex::consumeExpected(const std::string& filename)
+{
+    DiaryStat expected;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_expected.find(filename);
+        if (it == m_expected.end())
+        {
+            return false;
+        }
+        if (it->second.writing)
+        {
+            // 写入还没结束，随后的 update 会读到最新的内容
+            it->second.seen = true;
+            return true;
+        }
+        expected = it->second.stat;
+        m_expected.erase(it);
+    }
+    DiaryStat stat;
+    return m_store->stat(filename, stat) && stat.size == expected.size && stat.mtime == expected.mtime;
+}
+
+void DiaryIndex::remove(const std::string& filename)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_expected.erase(filename);
+    DiaryEntry key;
+    key.filename = filename;
+    const std::vector<DiaryEntry>& current = m_listing->entries;
+    auto it = std::lower_bound(current.begin(), current.end(), key, byFilename);
+    if (it == current.end() || it->filename != filename)
+    {
+        return;
+    }
+
+    std::vector<DiaryEntry> entries = current;
+    entries.erase(entries.begin() + (it - current.begin()));
+    publish(std::move(entries));
+    lock.unlock();
+    if (m_listener)
+    {
+        m_listener(filename, true);
+    }
+}
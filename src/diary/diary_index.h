@@ -0,0 +1,148 @@
+﻿/**
+* @file diary_index.h
+* @brief 常驻内存的日记索引，启动时扫描一次目录，之后由写入/删除和 inotify 增量更新
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef DIARY_INDEX_H
+#define DIARY_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <memory>
+#include <mutex>
+#include <functional>
+#include <cstdint>
+#include <ctime>
+#include "comm/file_watcher.h"
+#include "diary/diary_store.h"
+
+struct DiaryEntry
+{
+    std::string filename;   // "(YYYY-MM-DD)标题"，也是 URL 里用的名字
+    std::string date;       // YYYY-MM-DD，文件名不合格式时为空
+    std::string title;      // 文件第一行
+    uint64_t size = 0;
+    time_t mtime = 0;       // 文件修改时间
+    uint64_t version = 0;   // 这一条最后一次载入时索引的代数，页面用它生成弱 ETag
+};
+
+// 分页查询条件。日期是 YYYY-MM-DD，闭区间，带了日期条件时没有日期的条目不出现
+struct DiaryPageQuery
+{
+    static constexpr size_t DEFAULT_LIMIT = 50;
+    static constexpr size_t MAX_LIMIT = 200;
+
+    std::string from;
+    std::string to;
+    std::string after;      // 游标：上一页最后一条的文件名，从它之后（更早的）开始
+    size_t limit = DEFAULT_LIMIT;
+};
+
+// 条目按文件名排序。读取拿到的是不可变快照，更新时复制一份再整体替换，
+// 首页渲染不需要持锁，也不会看到改了一半的列表。
+// 每个快照还带一份按日期从新到旧排好的指针，翻页和按日期筛选都是二分查找加一页的拷贝
+class DiaryIndex
+{
+public:
+    using Snapshot = std::shared_ptr<const std::vector<DiaryEntry>>;
+
+    // 一页结果，entries 指向 snapshot 里的条目
+    struct Page
+    {
+        Snapshot snapshot;
+        std::vector<const DiaryEntry*> entries;
+        size_t total = 0;       // 符合日期条件的总条数
+        std::string next;       // 下一页的游标，没有下一页时为空
+    };
+
+    // 索引每变一次 generation 加一，起始值取启动时间，重启后也不会和之前发出去的 ETag 撞上
+    struct Version
+    {
+        uint64_t generation = 0;
+        time_t modified = 0;    // 最后一次变化的时间
+    };
+
+    // 某一篇新建、修改或删除之后调用（removed 为 true 表示删除），不持锁，可能在工作线程或者监视线程上
+    using Listener = std::function<void(const std::string& filename, bool removed)>;
+
+    static DiaryIndex& getInstance();
+
+    // 在 start 之前设置
+    void setListener(Listener listener) { m_listener = std::move(listener); }
+
+    // 从 store 读出全部日记建立索引（目录不存在就创建）；日记是目录里的文件时，还开始监视目录里的变化
+    bool start(const std::string& directory, std::unique_ptr<DiaryStore> store);
+    void stop();
+
+    const std::string& directory() const { return m_directory; }
+    // 日记内容的读写都经过它，start 之后才能用
+    DiaryStore& store() const { return *m_store; }
+    Snapshot snapshot() const;
+    // 快照和它对应的版本，一起取保证一致
+    Snapshot snapshot(Version& version) const;
+
+    // 按日期从新到旧取一页，同一天的按文件名倒序，没有日期的排在最后。代价 O(log n + limit)
+    Page page(const DiaryPageQuery& query, Version& version) const;
+
+    // 是不是合法的 YYYY-MM-DD
+    static bool isDate(std::string_view date);
+
+    // 按文件名找一条，找不到返回 false
+    bool find(const std::string& filename, DiaryEntry& entry) const;
+
+    // 服务器自己写 filename 之前调用，之后不管成没成功都要调用 update。
+    // 这中间以及 update 之后目录监视报告的就是这次写入，跳过，免得同一次写入重新读取、通知监听方两遍
+    void expectWrite(const std::string& filename);
+    // 新建或修改了 filename 之后调用，重新读取这一条
+    void update(const std::string& filename);
+    void remove(const std::string& filename);
+
+private:
+    DiaryIndex() = default;
+    ~DiaryIndex();
+    DiaryIndex(const DiaryIndex&) = delete;
+    DiaryIndex& operator=(const DiaryIndex&) = delete;
+
+    // 快照的实际内容，对外的 Snapshot 用别名构造指向其中的 entries
+    struct Listing
+    {
+        std::vector<DiaryEntry> entries;            // 按文件名
+        std::vector<const DiaryEntry*> by_date;     // 按日期从新到旧
+    };
+
+    bool load(const std::string& filename, DiaryEntry& entry) const;
+    // 服务器自己的一次写入：writing 时还没 update，监视事件先到就记 seen；update 之后等着的是改名到位的那个事件，
+    // 到了再比一次大小和修改时间，对不上说明之后又被改过
+    struct ExpectedWrite
+    {
+        bool writing = true;
+        bool seen = false;
+        DiaryStat stat;
+    };
+
+    // 重新读取一条；written 为 true 表示是服务器自己写的，要和 expectWrite 记下的对上
+    void refresh(const std::string& filename, bool written);
+    // 目录监视报告 filename 变了：是服务器自己那次写入的返回 true
+    bool consumeExpected(const std::string& filename);
+    void reload();
+    void publish(std::vector<DiaryEntry> entries);
+
+private:
+    std::string m_directory;
+    std::unique_ptr<DiaryStore> m_store;
+
+    mutable std::mutex m_mutex;         // 保护 m_listing 指针本身，以及更新之间的互斥
+    std::shared_ptr<const Listing> m_listing = std::make_shared<const Listing>();
+    Version m_version;
+    std::unordered_map<std::string, ExpectedWrite> m_expected;  // 受 m_mutex 保护
+
+    FileWatcher m_watcher;
+    bool m_watching = false;
+    Listener m_listener;
+};
+
+#endif // !DIARY_INDEX_H
@@ -0,0 +1,199 @@
+﻿/**
+* @file diary_store.cpp
+* @brief 日记内容的存储：默认一篇一个文件，也可以用追加写的日志存储（见 log_store.h）
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "diary_store.h"
+#include "comm/log.h"
+#include <filesystem>
+#include <fstream>
+#include <format>
+#include <sstream>
+#include <chrono>
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#else
+#include <unistd.h>
+#endif
+
+// 日记名里不能有的字节：路径分隔符和控制字符
+static bool isUnsafeNameByte(char c)
+{
+    return c == '/' || c == '\\' || static_cast<unsigned char>(c) < 0x20 || c == 0x7f;
+}
+
+bool isValidDiaryName(std::string_view name)
+{
+    return !name.empty() && name[0] != '.' && std::none_of(name.begin(), name.end(), isUnsafeNameByte);
+}
+
+std::string sanitizeDiaryTitle(std::string_view title)
+{
+    while (!title.empty() && title.front() == '.')
+    {
+        title.remove_prefix(1);
+    }
+    std::string result(title);
+    std::replace_if(result.begin(), result.end(), isUnsafeNameByte, '_');
+    return result;
+}
+
+FileDiaryStore::FileDiaryStore(const std::string& directory)
+    : m_directory(directory)
+{
+}
+
+std::vector<std::string> FileDiaryStore::list() const
+{
+    std::vector<std::string> names;
+    std::error_code ec;
+    for (auto& p : std::filesystem::directory_iterator(m_directory, ec))
+    {
+        std::string name = p.path().filename().string();
+        // 点开头的是临时文件和索引，目录是附件
+        if (isValidDiaryName(name) && p.is_regular_file(ec))
+        {
+            names.push_back(std::move(name));
+        }
+    }
+    return names;
+}
+
+bool FileDiaryStore::stat(const std::string& name, DiaryStat& stat) const
+{
+    std::filesystem::path path = std::filesystem::path(m_directory) / name;
+    std::error_code ec;
+    if (!isValidDiaryName(name) || !std::filesystem::is_regular_file(path, ec))
+    {
+        return false;
+    }
+    stat.size = std::filesystem::file_size(path, ec);
+    auto ftime = std::filesystem::last_write_time(path, ec);
+    stat.mtime = ec ? 0 : std::chrono::system_clock::to_time_t(
+        std::chrono::time_point_cast<std::chrono::system_clock::duration>(std::chrono::file_clock::to_sys(ftime)));
+    return true;
+}
+
+bool FileDiaryStore::read(const std::string& name, std::string& text, size_t limit) const
+{
+    if (!isValidDiaryName(name))
+    {
+        return false;
+    }
+    std::ifstream ifs(std::filesystem::path(m_directory) / name, std::ios::binary);
+    if (!ifs)
+    {
+        return false;
+    }
+    if (limit > 0)
+    {
+        text.resize(limit);
+        ifs.read(text.data(), static_cast<std::streamsize>(limit));
+        text.resize(static_cast<size_t>(ifs.gcount()));
+        return true;
+    }
+    std::ostringstream oss;
+    oss << ifs.rdbuf();
+    text = oss.str();
+    return true;
+}
+
+bool FileDiaryStore::commit(const std::string& name, const std::string& temp_path)
+{
+    if (!isValidDiaryName(name))
+    {
+        LOG_ERROR(std::format("Refusing to save diary under unsafe name {}", name));
+        return false;
+    }
+    std::error_code ec;
+    std::filesystem::rename(temp_path, std::filesystem::path(m_directory) / name, ec);
+    if (ec)
+    {
+        LOG_ERROR(std::format("Failed to save diary {}: {}", name, ec.message()));
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_unsynced.push_back(name);
+    m_directory_dirty = true;
+    return true;
+}
+
+bool FileDiaryStore::remove(const std::string& name)
+{
+    std::error_code ec;
+    if (!isValidDiaryName(name) || !std::filesystem::remove(std::filesystem::path(m_directory) / name, ec))
+    {
+        return false;
+    }
+    std::lock_guard<std::mutex> lock(m_mutex);
+    m_directory_dirty = true;
+    return true;
+}
+
+bool syncPath(const std::string& path)
+{
+#ifdef _WIN32
+    // NTFS 的元数据有日志，目录没法也不用单独刷；文件要以可写方式打开 _commit（FlushFileBuffers）才生效
+    std::error_code ec;
+    if (std::filesystem::is_directory(path, ec))
+    {
+        return true;
+    }
+    int fd = -1;
+    if (::_sopen_s(&fd, path.c_str(), _O_RDWR | _O_BINARY, _SH_DENYNO, 0) != 0)
+    {
+        return errno == ENOENT;
+    }
+    bool ok = ::_commit(fd) == 0;
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return errno == ENOENT;
+    }
+    bool ok = ::fsync(fd) == 0;
+#endif
+    if (!ok)
+    {
+        LOG_ERROR(std::format("Failed to sync {}: {}", path, std::strerror(errno)));
+    }
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+    return ok;
+}
+
+// 一篇一个文件时没法一次同步所有文件：每个文件各 fsync 一次，目录只 fsync 一次
+bool FileDiaryStore::sync()
+{
+    std::vector<std::string> names;
+    bool directory_dirty = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        names.swap(m_unsynced);
+        std::swap(directory_dirty, m_directory_dirty);
+    }
+
+    std::sort(names.begin(), names.end());
+    names.erase(std::unique(names.begin(), names.end()), names.end());
+    bool ok = true;
+    for (const std::string& name : names)
+    {
+        ok = syncPath(m_directory + "/" + name) && ok;
+    }
+    if (directory_dirty)
+    {
+        ok = syncPath(m_directory) && ok;
+    }
+    return ok;
+}
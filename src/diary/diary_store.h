@@ -0,0 +1,78 @@
+﻿/**
+* @file diary_store.h
+* @brief 日记内容的存储：默认一篇一个文件，也可以用追加写的日志存储（见 log_store.h）
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef DIARY_STORE_H
+#define DIARY_STORE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <mutex>
+#include <cstdint>
+#include <ctime>
+
+struct DiaryStat
+{
+    uint64_t size = 0;
+    time_t mtime = 0;
+};
+
+// 日记按名字（"(YYYY-MM-DD)标题"）存取，内容第一行是标题。实现必须线程安全
+class DiaryStore
+{
+public:
+    virtual ~DiaryStore() = default;
+
+    virtual std::vector<std::string> list() const = 0;
+    virtual bool stat(const std::string& name, DiaryStat& stat) const = 0;
+    // limit 不为 0 时最多读开头这么多字节，只用来取标题
+    virtual bool read(const std::string& name, std::string& text, size_t limit = 0) const = 0;
+    // 把写好的临时文件收为日记 name（已有的覆盖）。成功后临时文件归存储处理，调用方不要再碰
+    virtual bool commit(const std::string& name, const std::string& temp_path) = 0;
+    virtual bool remove(const std::string& name) = 0;
+    // 让此前 commit、remove 的修改落盘，由组提交线程调用（见 group_commit.h），和读写并发。失败返回 false
+    virtual bool sync() = 0;
+
+    // 日记是不是目录里的普通文件，是的话目录变化（包括在服务器之外修改）能用 inotify 发现
+    virtual bool filesInDirectory() const = 0;
+
+    // /status 里显示的一行，没有可说的返回空
+    virtual std::string statusText() const { return {}; }
+};
+
+// fsync 一个文件或目录。已经不在了（落盘之前又被删掉或覆盖）算成功
+bool syncPath(const std::string& path);
+
+// 日记名就是目录里的文件名（附件目录也用它）：非空，不以点开头（临时文件和索引），不含 / \ 和控制字符，
+// 不会跑到目录外面去
+bool isValidDiaryName(std::string_view name);
+// 用户填的标题要拼进日记名：/ \ 和控制字符（包括 NUL）换成 '_'，去掉开头的点
+std::string sanitizeDiaryTitle(std::string_view title);
+
+// 一篇一个文件，放在 directory 下
+class FileDiaryStore : public DiaryStore
+{
+public:
+    explicit FileDiaryStore(const std::string& directory);
+
+    std::vector<std::string> list() const override;
+    bool stat(const std::string& name, DiaryStat& stat) const override;
+    bool read(const std::string& name, std::string& text, size_t limit = 0) const override;
+    bool commit(const std::string& name, const std::string& temp_path) override;
+    bool remove(const std::string& name) override;
+    bool sync() override;
+    bool filesInDirectory() const override { return true; }
+
+private:
+    std::string m_directory;
+
+    std::mutex m_mutex;
+    std::vector<std::string> m_unsynced;    // commit 了还没落盘的日记
+    bool m_directory_dirty = false;         // 目录项有改动（改名、删除），要 fsync 目录
+};
+
+#endif // !DIARY_STORE_H
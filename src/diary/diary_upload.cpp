@@ -0,0 +1,519 @@
+﻿/**
+* @file diary_upload.cpp
+* @brief 写日记表单的流式接收：正文和附件边收边写进日记目录下的临时文件，提交时改名到位
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "diary_upload.h"
+#include "http/http_headers.h"
+#include "comm/log.h"
+#include <filesystem>
+#include <algorithm>
+#include <format>
+#include <cerrno>
+#include <cstring>
+#include <cstdlib>
+#include <cstdio>
+#include <fcntl.h>
+#include <sys/stat.h>
+
+#ifdef _WIN32
+#include <io.h>
+#include <share.h>
+#else
+#include <unistd.h>
+#endif
+
+// 在 path（以 XXXXXX 结尾）上建一个独占的临时文件，path 改成实际文件名
+static int openTempFile(std::string& path)
+{
+#ifdef _WIN32
+    int fd = -1;
+    if (::_mktemp_s(path.data(), path.size() + 1) != 0)
+    {
+        return -1;
+    }
+    ::_sopen_s(&fd, path.c_str(), _O_CREAT | _O_EXCL | _O_RDWR | _O_BINARY, _SH_DENYNO, _S_IREAD | _S_IWRITE);
+    return fd;
+#else
+    int fd = ::mkstemp(path.data());
+    if (fd >= 0)
+    {
+        // mkstemp 建的是 0600，改名后就是正式的日记和附件，权限和直接写出来的文件一样
+        ::fchmod(fd, 0644);
+    }
+    return fd;
+#endif
+}
+
+static void closeFile(int fd)
+{
+#ifdef _WIN32
+    ::_close(fd);
+#else
+    ::close(fd);
+#endif
+}
+
+static long long writeFile(int fd, std::string_view data)
+{
+#ifdef _WIN32
+    return ::_write(fd, data.data(), static_cast<unsigned>(std::min<size_t>(data.size(), 1u << 30)));
+#else
+    return ::write(fd, data.data(), data.size());
+#endif
+}
+
+static long long readFile(int fd, char* buffer, size_t size)
+{
+#ifdef _WIN32
+    return ::_read(fd, buffer, static_cast<unsigned>(size));
+#else
+    return ::read(fd, buffer, size);
+#endif
+}
+
+static void rewindFile(int fd)
+{
+#ifdef _WIN32
+    ::_lseek(fd, 0, SEEK_SET);
+#else
+    ::lseek(fd, 0, SEEK_SET);
+#endif
+}
+
+// 字段名只用来区分 title / content，太长的截掉就行
+static constexpr size_t MAX_KEY_BYTES = 256;
+
+static int hexValue(char c)
+{
+    if (c >= '0' && c <= '9') return c - '0';
+    if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+    if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+    return -1;
+}
+
+// 只留最后一段，去掉开头的点和控制字符，不让上传的文件名跑出附件目录
+static std::string sanitizeFilename(std::string_view name)
+{
+    size_t slash = name.find_last_of("/\\");
+    if (slash != std::string_view::npos)
+    {
+        name.remove_prefix(slash + 1);
+    }
+    while (!name.empty() && name.front() == '.')
+    {
+        name.remove_prefix(1);
+    }
+
+    std::string result;
+    for (char c : name.substr(0, 200))
+    {
+        result += static_cast<unsigned char>(c) < 0x20 || c == 0x7f ? '_' : c;
+    }
+    return result.empty() ? "attachment" : result;
+}
+
+// 第 n 个同名附件：photo.jpg -> photo-2.jpg，和重名日记加序号的写法一样
+static std::string numberedFilename(const std::string& name, int n)
+{
+    size_t dot = name.find_last_of('.');
+    if (dot == std::string::npos || dot == 0)
+    {
+        return std::format("{}-{}", name, n);
+    }
+    return std::format("{}-{}{}", name.substr(0, dot), n, name.substr(dot));
+}
+
+std::unique_ptr<DiaryUpload> DiaryUpload::create(const std::string& directory, std::string_view content_type)
+{
+    std::unique_ptr<DiaryUpload> upload(new DiaryUpload(directory));
+    std::string_view boundary = MultipartParser::boundaryOf(content_type);
+    if (!boundary.empty())
+    {
+        upload->m_multipart = std::make_unique<MultipartParser>(boundary);
+        DiaryUpload* self = upload.get();
+        upload->m_multipart->onPartBegin = [self](const MultipartParser::Part& part)
+            {
+                return self->beginField(part.name, part.filename);
+            };
+        upload->m_multipart->onPartData = [self](std::string_view data) { return self->appendField(data); };
+        upload->m_multipart->onPartEnd = [self]() { return self->endField(); };
+        return upload;
+    }
+
+    std::string_view media = content_type.substr(0, content_type.find(';'));
+    if (!equalsIgnoreCase(media, "application/x-www-form-urlencoded"))
+    {
+        return nullptr;
+    }
+    return upload;
+}
+
+DiaryUpload::DiaryUpload(const std::string& directory)
+    : m_directory(directory)
+{
+}
+
+DiaryUpload::~DiaryUpload()
+{
+    auto discard = [this](TempFile& file)
+        {
+            if (file.fd >= 0)
+            {
+                closeFile(file.fd);
+            }
+            if (!m_committed && !file.path.empty())
+            {
+                std::remove(file.path.c_str());
+            }
+        };
+
+    discard(m_content);
+    for (TempFile& file : m_attachments)
+    {
+        discard(file);
+    }
+}
+
+bool DiaryUpload::fail(HttpStatus status)
+{
+    m_status = status;
+    return false;
+}
+
+bool DiaryUpload::openTemp(TempFile& file)
+{
+    std::string path = m_directory + "/.upload-XXXXXX";
+    int fd = openTempFile(path);
+    if (fd < 0)
+    {
+        LOG_ERROR(std::format("Failed to create upload file in {}: {}", m_directory, std::strerror(errno)));
+        return fail(HttpStatus::InternalServerError);
+    }
+    file.path = std::move(path);
+    file.fd = fd;
+    return true;
+}
+
+bool DiaryUpload::writeAll(int fd, std::string_view data)
+{
+    while (!data.empty())
+    {
+        long long n = writeFile(fd, data);
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            LOG_ERROR(std::format("Failed to write upload: {}", std::strerror(errno)));
+            return fail(HttpStatus::InternalServerError);
+        }
+        data.remove_prefix(static_cast<size_t>(n));
+    }
+    return true;
+}
+
+bool DiaryUpload::beginField(std::string_view name, std::string_view filename)
+{
+    if (!filename.empty())
+    {
+        if (m_attachments.size() >= MAX_ATTACHMENTS)
+        {
+            return fail(HttpStatus::PayloadTooLarge);
+        }
+        // 清理后重名的附件（包括都没有文件名、退成 "attachment" 的）改名到位时会互相覆盖，加序号区分
+        TempFile file;
+        std::string base = sanitizeFilename(filename);
+        file.name = base;
+        for (int n = 2; std::any_of(m_attachments.begin(), m_attachments.end(),
+            [&file](const TempFile& other) { return other.name == file.name; }); ++n)
+        {
+            file.name = numberedFilename(base, n);
+        }
+        if (!openTemp(file))
+        {
+            return false;
+        }
+        m_attachments.push_back(std::move(file));
+        m_target = Target::Attachment;
+    }
+    else if (name == "title")
+    {
+        m_title.clear();
+        m_target = Target::Title;
+    }
+    else if (name == "content")
+    {
+        if (m_content.fd < 0)
+        {
+            if (!openTemp(m_content))
+            {
+                return false;
+            }
+            // 浏览器按表单顺序发送，标题一般已经到了，直接写在开头，提交时就只用改个名
+            if (m_target == Target::Ignore && !m_title.empty())
+            {
+                m_title_written = true;
+                if (!writeAll(m_content.fd, m_title + "\n"))
+                {
+                    return false;
+                }
+            }
+        }
+        m_target = Target::Content;
+    }
+    else
+    {
+        m_target = Target::Ignore;
+    }
+    return true;
+}
+
+bool DiaryUpload::appendField(std::string_view data)
+{
+    switch (m_target)
+    {
+    case Target::Title:
+        if (m_title.size() + data.size() > MAX_FIELD_BYTES)
+        {
+            return fail(HttpStatus::PayloadTooLarge);
+        }
+        m_title.append(data);
+        return true;
+    case Target::Content:
+        return writeAll(m_content.fd, data);
+    case Target::Attachment:
+        return writeAll(m_attachments.back().fd, data);
+    default:
+        return true;
+    }
+}
+
+bool DiaryUpload::endField()
+{
+    bool ok = m_target != Target::Content || writeAll(m_content.fd, "\n");
+    m_target = Target::Ignore;
+    return ok;
+}
+
+bool DiaryUpload::writeUrlEncoded(std::string_view chunk)
+{
+    // 解码结果先攒在 m_decoded，一段数据处理完或者字段结束时再交出去
+    m_decoded.clear();
+    size_t i = 0;
+    while (i < chunk.size())
+    {
+        if (!m_in_value)
+        {
+            size_t end = chunk.find_first_of("=&", i);
+            if (m_key.size() < MAX_KEY_BYTES)
+            {
+                m_key.append(chunk.substr(i, end - i));
+            }
+            if (end == std::string_view::npos)
+            {
+                return true;
+            }
+            if (chunk[end] == '=')
+            {
+                m_in_value = true;
+                if (!beginField(m_key, {}))
+                {
+                    return false;
+                }
+            }
+            m_key.clear();
+            i = end + 1;
+            continue;
+        }
+
+        if (!m_escape.empty())
+        {
+            if (hexValue(chunk[i]) < 0)
+            {
+                // 不是合法转义就原样保留，当前字符回到正常解码
+                m_decoded += m_escape;
+                m_escape.clear();
+                continue;
+            }
+            m_escape += chunk[i++];
+            if (m_escape.size() == 3)
+            {
+                m_decoded += static_cast<char>(hexValue(m_escape[1]) * 16 + hexValue(m_escape[2]));
+                m_escape.clear();
+            }
+            continue;
+        }
+
+        size_t end = chunk.find_first_of("&+%", i);
+        m_decoded.append(chunk.substr(i, end - i));
+        if (end == std::string_view::npos)
+        {
+            break;
+        }
+
+        i = end + 1;
+        if (chunk[end] == '+')
+        {
+            m_decoded += ' ';
+        }
+        else if (chunk[end] == '%')
+        {
+            m_escape = "%";
+        }
+        else
+        {
+            if (!appendField(m_decoded) || !endField())
+            {
+                return false;
+            }
+            m_decoded.clear();
+            m_in_value = false;
+        }
+    }
+    return appendField(m_decoded);
+}
+
+bool DiaryUpload::write(std::string_view chunk)
+{
+    if (m_multipart)
+    {
+        return m_multipart->feed(chunk);
+    }
+    return writeUrlEncoded(chunk);
+}
+
+bool DiaryUpload::finish()
+{
+    if (m_multipart)
+    {
+        return m_multipart->finish();
+    }
+    if (m_in_value)
+    {
+        if (!m_escape.empty())
+        {
+            m_decoded = std::move(m_escape);
+            m_escape.clear();
+            if (!appendField(m_decoded))
+            {
+                return false;
+            }
+        }
+        m_in_value = false;
+        return endField();
+    }
+    return true;
+}
+
+bool DiaryUpload::commit(const std::string& filename, DiaryStore& store)
+{
+    namespace fs = std::filesystem;
+
+    // 名字要拼进附件目录的路径，带 / 或 .. 的会建到日记目录外面去
+    if (!isValidDiaryName(filename))
+    {
+        LOG_ERROR(std::format("Refusing to save upload under unsafe name {}", filename));
+        return fail(HttpStatus::BadRequest);
+    }
+    if (m_content.fd < 0 && !openTemp(m_content))
+    {
+        return false;
+    }
+
+    // 标题在正文之后才到（或者根本没有正文）：另开一个文件，先写标题再把正文接上
+    if (!m_title_written)
+    {
+        TempFile merged;
+        if (!openTemp(merged) || !writeAll(merged.fd, m_title + "\n"))
+        {
+            if (merged.fd >= 0)
+            {
+                closeFile(merged.fd);
+                std::remove(merged.path.c_str());
+            }
+            return false;
+        }
+
+        char buffer[64 * 1024];
+        long long n = 0;
+        rewindFile(m_content.fd);
+        while ((n = readFile(m_content.fd, buffer, sizeof(buffer))) > 0 && writeAll(merged.fd, std::string_view(buffer, static_cast<size_t>(n))))
+        {
+        }
+        closeFile(m_content.fd);
+        std::remove(m_content.path.c_str());
+        m_content = std::move(merged);
+        if (n != 0)
+        {
+            return fail(HttpStatus::InternalServerError);
+        }
+        m_title_written = true;
+    }
+
+    closeFile(m_content.fd);
+    m_content.fd = -1;
+
+    // 附件先放好再存日记：日记一出现在索引里，它的附件就已经都在了；附件放不好就不存日记
+    fs::path dir = fs::path(m_directory) / "attachments" / filename;
+    std::vector<std::string> saved;
+    std::vector<std::string> rollback;
+    std::error_code ec;
+    if (!m_attachments.empty())
+    {
+        // 目录是这次新建的才记下来，回滚时一起删；已经存在的（比如同名文件）不能动
+        if (fs::create_directories(dir, ec))
+        {
+            rollback.push_back(dir.string());
+        }
+        for (TempFile& file : m_attachments)
+        {
+            closeFile(file.fd);
+            file.fd = -1;
+            if (!ec)
+            {
+                fs::rename(file.path, dir / file.name, ec);
+            }
+            if (ec)
+            {
+                LOG_ERROR(std::format("Failed to save attachment {} of {}: {}", file.name, filename, ec.message()));
+                removeSaved(rollback);
+                return fail(HttpStatus::InternalServerError);
+            }
+            file.path.clear();
+            saved.push_back((dir / file.name).string());
+            rollback.push_back(saved.back());
+        }
+    }
+
+    if (!store.commit(filename, m_content.path))
+    {
+        removeSaved(rollback);
+        return fail(HttpStatus::InternalServerError);
+    }
+    m_content.path.clear();
+
+    if (!m_attachments.empty())
+    {
+        m_saved_paths = std::move(saved);
+        m_saved_paths.push_back(dir.string());
+        m_saved_paths.push_back(dir.parent_path().string());
+        m_saved_paths.push_back(m_directory);
+    }
+
+    m_committed = true;
+    return true;
+}
+
+// 日记没存成，倒着删掉已经放好的附件和新建的目录
+void DiaryUpload::removeSaved(const std::vector<std::string>& paths)
+{
+    std::error_code ec;
+    for (auto it = paths.rbegin(); it != paths.rend(); ++it)
+    {
+        std::filesystem::remove(*it, ec);
+    }
+}
@@ -0,0 +1,93 @@
+﻿/**
+* @file diary_upload.h
+* @brief 写日记表单的流式接收：正文和附件边收边写进日记目录下的临时文件，提交时改名到位
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef DIARY_UPLOAD_H
+#define DIARY_UPLOAD_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include "http/http_body.h"
+#include "http/multipart_parser.h"
+#include "diary/diary_store.h"
+
+// 支持 application/x-www-form-urlencoded 和 multipart/form-data 两种表单。
+// title 放内存（有上限），content 和带文件名的字段都直接写临时文件，内存占用和上传大小无关。
+// 临时文件以 "." 开头，日记索引不会把它们当成日记；没有 commit 就析构时删掉
+class DiaryUpload : public BodySink
+{
+public:
+    static constexpr size_t MAX_FIELD_BYTES = 64 * 1024;    // 放内存的字段（标题）上限
+    static constexpr size_t MAX_ATTACHMENTS = 16;
+
+    // 表单类型不认识时返回空
+    static std::unique_ptr<DiaryUpload> create(const std::string& directory, std::string_view content_type);
+    ~DiaryUpload() override;
+
+    bool write(std::string_view chunk) override;
+    bool finish() override;
+    HttpStatus errorStatus() const override { return m_status; }
+
+    const std::string& title() const { return m_title; }
+    size_t attachmentCount() const { return m_attachments.size(); }
+
+    // 附件挪到 directory/attachments/filename/ 下，再把正文（第一行是标题）交给 store 存为 filename。
+    // 失败时什么都不留下：附件放不好就不存日记，日记存不成就删掉已经放好的附件
+    bool commit(const std::string& filename, DiaryStore& store);
+    // commit 放好的附件文件和它们的目录，要和日记一起落盘（见 group_commit.h）
+    const std::vector<std::string>& savedPaths() const { return m_saved_paths; }
+
+private:
+    enum class Target
+    {
+        Ignore,
+        Title,
+        Content,
+        Attachment
+    };
+
+    struct TempFile
+    {
+        std::string path;
+        std::string name;   // 附件的原始文件名（已清理）
+        int fd = -1;
+    };
+
+    explicit DiaryUpload(const std::string& directory);
+
+    bool beginField(std::string_view name, std::string_view filename);
+    bool appendField(std::string_view data);
+    bool endField();
+    bool writeUrlEncoded(std::string_view chunk);
+
+    bool openTemp(TempFile& file);
+    static void removeSaved(const std::vector<std::string>& paths);
+    bool writeAll(int fd, std::string_view data);
+    bool fail(HttpStatus status);
+
+private:
+    std::string m_directory;
+    HttpStatus m_status = HttpStatus::BadRequest;
+
+    Target m_target = Target::Ignore;
+    std::string m_title;
+    bool m_title_written = false;   // 标题已经写在正文临时文件开头
+    TempFile m_content;
+    std::vector<TempFile> m_attachments;
+    bool m_committed = false;
+    std::vector<std::string> m_saved_paths;
+
+    std::unique_ptr<MultipartParser> m_multipart;   // 为空表示 urlencoded
+    // urlencoded 的解码状态，字段可能被切在任何位置
+    std::string m_key;
+    std::string m_decoded;
+    bool m_in_value = false;
+    std::string m_escape;           // 收到一半的 "%X"，不在转义里时为空
+};
+
+#endif // !DIARY_UPLOAD_H
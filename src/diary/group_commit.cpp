@@ -0,0 +1,128 @@
+﻿/**
+* @file group_commit.cpp
+* @brief 组提交：并发写日记的请求排队等一个提交线程，一批只落盘一次
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "group_commit.h"
+#include "comm/log.h"
+#include <algorithm>
+#include <format>
+#include <iterator>
+
+GroupCommitter& GroupCommitter::getInstance()
+{
+    static GroupCommitter committer;
+    return committer;
+}
+
+GroupCommitter::~GroupCommitter()
+{
+    stop();
+}
+
+void GroupCommitter::start(DiaryStore& store, std::chrono::microseconds window)
+{
+    m_store = &store;
+    m_window = window;
+    m_committer = std::thread(&GroupCommitter::commitLoop, this);
+}
+
+void GroupCommitter::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_stopping = true;
+    }
+    m_queue_cv.notify_all();
+    if (m_committer.joinable())
+    {
+        m_committer.join();
+    }
+}
+
+void GroupCommitter::syncAsync(std::vector<std::string> paths, std::function<void(bool ok)> done)
+{
+    std::vector<Waiter> batch(1);
+    batch[0].paths = std::move(paths);
+    batch[0].done = std::move(done);
+
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_committer.joinable() || m_stopping)
+    {
+        // 没有提交线程（启动前、退出时）就自己落盘
+        lock.unlock();
+        bool ok = m_store ? syncBatch(batch) : true;
+        batch[0].done(ok);
+        return;
+    }
+    m_queue.push_back(std::move(batch[0]));
+    m_queue_cv.notify_one();
+}
+
+void GroupCommitter::commitLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_queue_cv.wait(lock, [this]() { return !m_queue.empty() || m_stopping; });
+        if (m_queue.empty())
+        {
+            break;  // 退出前把排着的都做完
+        }
+        if (m_window.count() > 0 && !m_stopping)
+        {
+            m_queue_cv.wait_for(lock, m_window, [this]() { return m_stopping; });
+        }
+
+        // 先取走这一批再落盘：批里的请求都是写完才排队的，之后的 store.sync() 一定覆盖它们
+        std::vector<Waiter> batch(std::make_move_iterator(m_queue.begin()), std::make_move_iterator(m_queue.end()));
+        m_queue.clear();
+        lock.unlock();
+        bool ok = syncBatch(batch);
+        // 回调在锁外做：回调里会把响应投递回 reactor，也可能接着排下一次
+        for (Waiter& waiter : batch)
+        {
+            waiter.done(ok);
+        }
+        lock.lock();
+
+        ++m_batches;
+        m_requests += batch.size();
+        m_largest_batch = std::max<uint64_t>(m_largest_batch, batch.size());
+        if (!ok)
+        {
+            ++m_failures;
+        }
+    }
+}
+
+bool GroupCommitter::syncBatch(const std::vector<Waiter>& batch)
+{
+    std::vector<std::string> paths;
+    for (const Waiter& waiter : batch)
+    {
+        paths.insert(paths.end(), waiter.paths.begin(), waiter.paths.end());
+    }
+    std::sort(paths.begin(), paths.end());
+    paths.erase(std::unique(paths.begin(), paths.end()), paths.end());
+
+    bool ok = m_store->sync();
+    for (const std::string& path : paths)
+    {
+        ok = syncPath(path) && ok;
+    }
+    if (!ok)
+    {
+        LOG_ERROR(std::format("Group commit of {} write(s) failed", batch.size()));
+    }
+    return ok;
+}
+
+std::string GroupCommitter::statusText()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    return std::format("group commit: {} writes in {} batches, largest {}, {} failed, window {}us\n",
+        m_requests, m_batches, m_largest_batch, m_failures, m_window.count());
+}
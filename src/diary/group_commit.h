@@ -0,0 +1,71 @@
+﻿/**
+* @file group_commit.h
+* @brief 组提交：并发写日记的请求排队等一个提交线程，一批只落盘一次
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef GROUP_COMMIT_H
+#define GROUP_COMMIT_H
+
+#include "diary_store.h"
+#include <string>
+#include <vector>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <chrono>
+#include <functional>
+#include <cstdint>
+
+// 写日记的请求先把内容写进存储（只到页缓存），再调用 syncAsync 排队等落盘，落盘之后才回 302。
+// 提交线程把排着的请求整批取走，store.sync() 加上附带的文件只做一遍，再逐个回调。
+// 上一批落盘期间到的请求自然合成下一批；window 不为 0 时，批里第一个请求到了以后再等这么久多凑一些。
+// 排队不占线程：响应推迟到回调里发出（见 HttpResponse::defer），工作线程和 IO 线程马上去处理别的请求
+class GroupCommitter
+{
+public:
+    static GroupCommitter& getInstance();
+
+    void start(DiaryStore& store, std::chrono::microseconds window);
+    void stop();
+
+    // 此前写进 store 的修改，以及 paths 里的文件和它们所在的目录都落盘后在提交线程上调用 done(ok)。
+    // 没有提交线程（启动前、退出后）时当场落盘并回调
+    void syncAsync(std::vector<std::string> paths, std::function<void(bool ok)> done);
+
+    std::string statusText();
+
+private:
+    GroupCommitter() = default;
+    ~GroupCommitter();
+    GroupCommitter(const GroupCommitter&) = delete;
+    GroupCommitter& operator=(const GroupCommitter&) = delete;
+
+    struct Waiter
+    {
+        std::vector<std::string> paths;
+        std::function<void(bool ok)> done;
+    };
+
+    void commitLoop();
+    bool syncBatch(const std::vector<Waiter>& batch);
+
+private:
+    DiaryStore* m_store = nullptr;
+    std::chrono::microseconds m_window{ 0 };
+
+    std::mutex m_mutex;
+    std::condition_variable m_queue_cv;     // 提交线程等请求
+    std::deque<Waiter> m_queue;
+    bool m_stopping = false;
+    std::thread m_committer;
+
+    uint64_t m_batches = 0;
+    uint64_t m_requests = 0;
+    uint64_t m_failures = 0;
+    uint64_t m_largest_batch = 0;
+};
+
+#endif // !GROUP_COMMIT_H
@@ -0,0 +1,837 @@
+﻿/**
+* @file log_store.cpp
+* @brief 追加写的日志存储：日记写成带 CRC 的记录追加到段文件里，内存索引记每篇的位置，后台压缩删掉的记录
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef _WIN32
+
+#include "log_store.h"
+#include "comm/crc32.h"
+#include "comm/log.h"
+#include <algorithm>
+#include <chrono>
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+static constexpr uint32_t RECORD_MAGIC = 0x43525046;   // "FPRC"
+static constexpr char INDEX_MAGIC[] = "FPLOGIDX";
+static constexpr uint64_t INDEX_VERSION = 1;
+static constexpr uint32_t MAX_NAME_BYTES = 4096;
+static constexpr size_t COPY_CHUNK = 64 * 1024;
+static constexpr auto COMPACT_INTERVAL = std::chrono::seconds(60);
+
+static void putVarint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+static bool getVarint(std::string_view& in, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && !in.empty(); shift += 7)
+    {
+        uint8_t byte = static_cast<uint8_t>(in.front());
+        in.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static bool preadAll(int fd, char* data, size_t size, uint64_t offset)
+{
+    while (size > 0)
+    {
+        ssize_t n = ::pread(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+static bool pwriteAll(int fd, const char* data, size_t size, uint64_t offset)
+{
+    while (size > 0)
+    {
+        ssize_t n = ::pwrite(fd, data, size, static_cast<off_t>(offset));
+        if (n < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        if (n <= 0)
+        {
+            return false;
+        }
+        data += n;
+        size -= static_cast<size_t>(n);
+        offset += static_cast<uint64_t>(n);
+    }
+    return true;
+}
+
+// CRC 从 type 开始，magic 和 crc 自己不算
+static std::string_view checkedFields(const void* header)
+{
+    return std::string_view(static_cast<const char*>(header) + 8, 24);
+}
+
+LogDiaryStore::Segment::~Segment()
+{
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+}
+
+LogDiaryStore::~LogDiaryStore()
+{
+    close();
+}
+
+std::string LogDiaryStore::segmentPath(uint32_t id) const
+{
+    char name[32];
+    snprintf(name, sizeof(name), "%06u.seg", id);
+    return m_directory + "/" + name;
+}
+
+std::shared_ptr<LogDiaryStore::Segment> LogDiaryStore::openSegment(uint32_t id, bool create) const
+{
+    std::string path = segmentPath(id);
+    int fd = ::open(path.c_str(), O_RDWR | O_CLOEXEC | (create ? O_CREAT | O_EXCL : 0), 0644);
+    if (fd < 0)
+    {
+        LOG_ERROR(std::format("Failed to open segment {}: {}", path, std::strerror(errno)));
+        return nullptr;
+    }
+    struct stat st{};
+    ::fstat(fd, &st);
+    if (create)
+    {
+        syncPath(m_directory);  // 新段的目录项也要落盘
+    }
+
+    auto segment = std::make_shared<Segment>();
+    segment->id = id;
+    segment->fd = fd;
+    segment->size = static_cast<uint64_t>(st.st_size);
+    return segment;
+}
+
+bool LogDiaryStore::open(const std::string& directory)
+{
+    m_directory = (std::filesystem::path(directory) / ".store").string();
+    std::error_code ec;
+    std::filesystem::create_directories(m_directory, ec);
+    if (ec)
+    {
+        LOG_ERROR(std::format("Failed to create store directory {}: {}", m_directory, ec.message()));
+        return false;
+    }
+
+    for (auto& p : std::filesystem::directory_iterator(m_directory, ec))
+    {
+        std::string name = p.path().filename().string();
+        if (name.size() == 10 && name.ends_with(".seg"))
+        {
+            uint32_t id = static_cast<uint32_t>(std::strtoul(name.c_str(), nullptr, 10));
+            std::shared_ptr<Segment> segment = openSegment(id, false);
+            if (!segment)
+            {
+                return false;
+            }
+            m_segments[id] = segment;
+        }
+    }
+    if (m_segments.empty())
+    {
+        std::shared_ptr<Segment> segment = openSegment(1, true);
+        if (!segment)
+        {
+            return false;
+        }
+        m_segments[1] = segment;
+    }
+    m_active = m_segments.rbegin()->second;
+
+    // 索引文件之后追加的记录重放一遍；索引文件不能用就从头扫描全部段
+    uint32_t covered_segment = m_segments.begin()->first;
+    uint64_t covered_offset = 0;
+    if (!loadIndex(covered_segment, covered_offset))
+    {
+        m_index.clear();
+        covered_segment = m_segments.begin()->first;
+        covered_offset = 0;
+    }
+    for (auto it = m_index.begin(); it != m_index.end();)
+    {
+        // 索引文件比段文件新（上次没来得及落盘）时，指向不存在位置的条目丢掉
+        auto segment = m_segments.find(it->second.segment);
+        if (segment == m_segments.end() || it->second.offset + it->second.length > segment->second->size)
+        {
+            LOG_WARN(std::format("Diary {} points past the end of its segment, dropped", it->first));
+            it = m_index.erase(it);
+            continue;
+        }
+        segment->second->live += it->second.length;
+        ++it;
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    for (auto it = m_segments.lower_bound(covered_segment); it != m_segments.end(); ++it)
+    {
+        Segment& segment = *it->second;
+        uint64_t from = segment.id == covered_segment ? std::min(covered_offset, segment.size) : 0;
+        uint64_t end = scan(segment, from, [&](const RecordHeader& header, const std::string& name, std::string_view, uint64_t offset)
+            {
+                Location location{ segment.id, offset, sizeof(RecordHeader) + header.name_size + header.body_size,
+                    header.body_size, static_cast<time_t>(header.mtime) };
+                applyLocked(static_cast<RecordType>(header.type), name, location);
+            });
+        if (end < segment.size)
+        {
+            if (&segment == m_active.get())
+            {
+                // 最后一个段末尾写了一半的记录（写的时候掉电），截掉
+                LOG_WARN(std::format("Truncating torn record at {} of {}", end, segmentPath(segment.id)));
+                if (::ftruncate(segment.fd, static_cast<off_t>(end)) == 0)
+                {
+                    segment.size = end;
+                }
+            }
+            else
+            {
+                LOG_ERROR(std::format("Corrupt record at {} of {}, the rest of this segment is unreadable", end, segmentPath(segment.id)));
+                segment.damaged = true;
+            }
+        }
+    }
+    saveIndexLocked();
+
+    LOG_INFO(std::format("Log store opened: {} diaries in {} segment(s) under {}", m_index.size(), m_segments.size(), m_directory));
+    m_compactor = std::thread(&LogDiaryStore::compactLoop, this);
+    return true;
+}
+
+void LogDiaryStore::close()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (!m_active)
+        {
+            return;
+        }
+        m_stopping = true;
+    }
+    m_compact_cv.notify_all();
+    if (m_compactor.joinable())
+    {
+        m_compactor.join();
+    }
+
+    std::lock_guard<std::mutex> lock(m_mutex);
+    ::fdatasync(m_active->fd);
+    saveIndexLocked();
+    m_active.reset();
+    m_segments.clear();
+}
+
+uint64_t LogDiaryStore::scan(const Segment& segment, uint64_t from, const Visitor& visit) const
+{
+    uint64_t offset = from;
+    std::string record;
+    while (offset + sizeof(RecordHeader) <= segment.size)
+    {
+        // 先确认名字放得下，再拿剩下的字节比正文长度，两步都不会减成负数
+        RecordHeader header{};
+        uint64_t remaining = segment.size - offset - sizeof(header);
+        if (!preadAll(segment.fd, reinterpret_cast<char*>(&header), sizeof(header), offset) ||
+            header.magic != RECORD_MAGIC || header.name_size == 0 || header.name_size > MAX_NAME_BYTES ||
+            (header.type != static_cast<uint32_t>(RecordType::Put) && header.type != static_cast<uint32_t>(RecordType::Delete)) ||
+            header.name_size > remaining || header.body_size > remaining - header.name_size)
+        {
+            break;
+        }
+
+        record.resize(header.name_size + header.body_size);
+        if (!preadAll(segment.fd, record.data(), record.size(), offset + sizeof(header)) ||
+            crc32(record, crc32(checkedFields(&header))) != header.crc)
+        {
+            break;
+        }
+
+        std::string name = record.substr(0, header.name_size);
+        visit(header, name, std::string_view(record).substr(header.name_size), offset);
+        offset += sizeof(header) + record.size();
+    }
+    return offset;
+}
+
+void LogDiaryStore::applyLocked(RecordType type, const std::string& name, const Location& location)
+{
+    auto it = m_index.find(name);
+    if (it != m_index.end())
+    {
+        auto old = m_segments.find(it->second.segment);
+        if (old != m_segments.end())
+        {
+            old->second->live -= std::min(old->second->live, it->second.length);
+        }
+        m_compact_requested = true;
+    }
+
+    if (type == RecordType::Put)
+    {
+        m_index[name] = location;
+        m_segments[location.segment]->live += location.length;
+    }
+    else if (it != m_index.end())
+    {
+        m_index.erase(it);
+    }
+}
+
+// 当前段放不下就换一个新段
+bool LogDiaryStore::reserveLocked(uint64_t length)
+{
+    if (m_active->size == 0 || m_active->size + length <= SEGMENT_BYTES)
+    {
+        return true;
+    }
+
+    std::shared_ptr<Segment> segment = openSegment(m_active->id + 1, true);
+    if (!segment)
+    {
+        return false;
+    }
+    ::fdatasync(m_active->fd);
+    m_segments[segment->id] = segment;
+    m_active = segment;
+    m_compact_requested = true;
+    saveIndexLocked();
+    return true;
+}
+
+bool LogDiaryStore::appendRecordLocked(const RecordHeader& header, std::string_view name, std::string_view body, Location& location)
+{
+    uint64_t length = sizeof(header) + name.size() + body.size();
+    if (!reserveLocked(length))
+    {
+        return false;
+    }
+
+    std::string record;
+    record.reserve(length);
+    record.append(reinterpret_cast<const char*>(&header), sizeof(header));
+    record.append(name);
+    record.append(body);
+    Segment& segment = *m_active;
+    if (!pwriteAll(segment.fd, record.data(), record.size(), segment.size))
+    {
+        LOG_ERROR(std::format("Failed to append to {}: {}", segmentPath(segment.id), std::strerror(errno)));
+        ::ftruncate(segment.fd, static_cast<off_t>(segment.size));
+        return false;
+    }
+
+    location = { segment.id, segment.size, length, header.body_size, static_cast<time_t>(header.mtime) };
+    segment.size += length;
+    return true;
+}
+
+bool LogDiaryStore::appendFileLocked(const RecordHeader& header, std::string_view name, int fd, Location& location)
+{
+    uint64_t length = sizeof(header) + name.size() + header.body_size;
+    if (!reserveLocked(length))
+    {
+        return false;
+    }
+
+    Segment& segment = *m_active;
+    std::string head(reinterpret_cast<const char*>(&header), sizeof(header));
+    head.append(name);
+    bool ok = pwriteAll(segment.fd, head.data(), head.size(), segment.size);
+
+    // 正文在内核里直接从临时文件拷到段文件，不经过用户态
+    loff_t in = 0;
+    loff_t out = static_cast<loff_t>(segment.size + head.size());
+    uint64_t remaining = header.body_size;
+    std::string buffer;
+    while (ok && remaining > 0)
+    {
+        ssize_t n = ::copy_file_range(fd, &in, segment.fd, &out, remaining, 0);
+        if (n < 0 && (errno == EXDEV || errno == ENOSYS || errno == EINVAL || errno == EOPNOTSUPP))
+        {
+            // 不支持就退回普通的读写
+            buffer.resize(std::min<uint64_t>(remaining, COPY_CHUNK));
+            ok = preadAll(fd, buffer.data(), buffer.size(), static_cast<uint64_t>(in)) &&
+                pwriteAll(segment.fd, buffer.data(), buffer.size(), static_cast<uint64_t>(out));
+            n = static_cast<ssize_t>(buffer.size());
+            in += n;
+            out += n;
+        }
+        else if (n <= 0)
+        {
+            ok = false;
+        }
+        remaining -= ok ? static_cast<uint64_t>(n) : 0;
+    }
+
+    if (!ok)
+    {
+        LOG_ERROR(std::format("Failed to append to {}: {}", segmentPath(segment.id), std::strerror(errno)));
+        ::ftruncate(segment.fd, static_cast<off_t>(segment.size));
+        return false;
+    }
+
+    location = { segment.id, segment.size, length, header.body_size, static_cast<time_t>(header.mtime) };
+    segment.size += length;
+    return true;
+}
+
+bool LogDiaryStore::put(const std::string& name, const std::string& path, time_t mtime)
+{
+    if (!isValidDiaryName(name) || name.size() > MAX_NAME_BYTES)
+    {
+        return false;
+    }
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        LOG_ERROR(std::format("Failed to open {}: {}", path, std::strerror(errno)));
+        return false;
+    }
+    struct stat st{};
+    ::fstat(fd, &st);
+
+    RecordHeader header{};
+    header.magic = RECORD_MAGIC;
+    header.type = static_cast<uint32_t>(RecordType::Put);
+    header.name_size = static_cast<uint32_t>(name.size());
+    header.body_size = static_cast<uint64_t>(st.st_size);
+    header.mtime = mtime;
+
+    // 先在锁外把 CRC 算好，持锁时只剩写
+    uint32_t crc = crc32(name, crc32(checkedFields(&header)));
+    std::string buffer(COPY_CHUNK, '\0');
+    bool ok = true;
+    for (uint64_t offset = 0; ok && offset < header.body_size; offset += buffer.size())
+    {
+        buffer.resize(std::min<uint64_t>(COPY_CHUNK, header.body_size - offset));
+        ok = preadAll(fd, buffer.data(), buffer.size(), offset);
+        crc = crc32(buffer, crc);
+    }
+    header.crc = crc;
+
+    if (ok)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        Location location;
+        ok = appendFileLocked(header, name, fd, location);
+        if (ok)
+        {
+            applyLocked(RecordType::Put, name, location);
+        }
+    }
+    ::close(fd);
+    if (m_compact_requested)
+    {
+        m_compact_cv.notify_all();
+    }
+    return ok;
+}
+
+bool LogDiaryStore::commit(const std::string& name, const std::string& temp_path)
+{
+    if (!put(name, temp_path, time(nullptr)))
+    {
+        return false;
+    }
+    ::unlink(temp_path.c_str());
+    return true;
+}
+
+bool LogDiaryStore::remove(const std::string& name)
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    if (!m_index.count(name))
+    {
+        return false;
+    }
+
+    RecordHeader header{};
+    header.magic = RECORD_MAGIC;
+    header.type = static_cast<uint32_t>(RecordType::Delete);
+    header.name_size = static_cast<uint32_t>(name.size());
+    header.mtime = time(nullptr);
+    header.crc = crc32(name, crc32(checkedFields(&header)));
+
+    Location location;
+    if (!appendRecordLocked(header, name, {}, location))
+    {
+        return false;
+    }
+    applyLocked(RecordType::Delete, name, location);
+    lock.unlock();
+    m_compact_cv.notify_all();
+    return true;
+}
+
+// 记录都追加在当前段，整批只要一次 fdatasync；换段时旧段已经同步过（见 reserveLocked）
+bool LogDiaryStore::sync()
+{
+    std::shared_ptr<Segment> segment;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        segment = m_active;
+    }
+    if (!segment || ::fdatasync(segment->fd) != 0)
+    {
+        LOG_ERROR(std::format("Failed to sync the log store: {}", std::strerror(errno)));
+        return false;
+    }
+    return true;
+}
+
+std::vector<std::string> LogDiaryStore::list() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    std::vector<std::string> names;
+    names.reserve(m_index.size());
+    for (const auto& [name, location] : m_index)
+    {
+        names.push_back(name);
+    }
+    return names;
+}
+
+bool LogDiaryStore::stat(const std::string& name, DiaryStat& stat) const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    auto it = m_index.find(name);
+    if (it == m_index.end())
+    {
+        return false;
+    }
+    stat.size = it->second.body_size;
+    stat.mtime = it->second.mtime;
+    return true;
+}
+
+bool LogDiaryStore::read(const std::string& name, std::string& text, size_t limit) const
+{
+    Location location;
+    std::shared_ptr<Segment> segment;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        auto it = m_index.find(name);
+        if (it == m_index.end())
+        {
+            return false;
+        }
+        location = it->second;
+        segment = m_segments.at(location.segment);
+    }
+
+    // 段文件只追加，拿着 shared_ptr 时即使被压缩删掉了 fd 也还能读，不需要持锁
+    RecordHeader header{};
+    if (!preadAll(segment->fd, reinterpret_cast<char*>(&header), sizeof(header), location.offset) ||
+        header.magic != RECORD_MAGIC || header.name_size != name.size() || header.body_size != location.body_size)
+    {
+        LOG_ERROR(std::format("Bad record header for {} at {} of {}", name, location.offset, segmentPath(location.segment)));
+        return false;
+    }
+
+    uint64_t body_offset = location.offset + sizeof(header) + header.name_size;
+    if (limit > 0)
+    {
+        // 只取标题，读不全整条记录，不校验
+        text.resize(std::min<uint64_t>(limit, header.body_size));
+        return preadAll(segment->fd, text.data(), text.size(), body_offset);
+    }
+
+    text.resize(header.body_size);
+    if (!preadAll(segment->fd, text.data(), text.size(), body_offset) ||
+        crc32(text, crc32(name, crc32(checkedFields(&header)))) != header.crc)
+    {
+        LOG_ERROR(std::format("CRC mismatch for {} at {} of {}", name, location.offset, segmentPath(location.segment)));
+        return false;
+    }
+    return true;
+}
+
+// 格式：magic varint(版本) varint(覆盖到的段) varint(段内偏移) varint(条数) 每条 [名字 段 偏移 长度 正文长度 时间]，最后 4 字节 CRC
+bool LogDiaryStore::saveIndexLocked()
+{
+    std::string data(INDEX_MAGIC);
+    putVarint(data, INDEX_VERSION);
+    putVarint(data, m_active->id);
+    putVarint(data, m_active->size);
+    putVarint(data, m_index.size());
+    for (const auto& [name, location] : m_index)
+    {
+        putVarint(data, name.size());
+        data.append(name);
+        putVarint(data, location.segment);
+        putVarint(data, location.offset);
+        putVarint(data, location.length);
+        putVarint(data, location.body_size);
+        putVarint(data, static_cast<uint64_t>(location.mtime));
+    }
+    uint32_t crc = crc32(data);
+    data.append(reinterpret_cast<const char*>(&crc), sizeof(crc));
+
+    std::string path = m_directory + "/index";
+    std::string tmp = path + ".tmp";
+    int fd = ::open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0644);
+    bool ok = fd >= 0 && pwriteAll(fd, data.data(), data.size(), 0) && ::fdatasync(fd) == 0;
+    if (fd >= 0)
+    {
+        ::close(fd);
+    }
+    if (!ok || ::rename(tmp.c_str(), path.c_str()) != 0)
+    {
+        LOG_ERROR(std::format("Failed to save store index {}: {}", path, std::strerror(errno)));
+        return false;
+    }
+    return syncPath(m_directory);   // 改名要等目录落盘才算数
+}
+
+bool LogDiaryStore::loadIndex(uint32_t& covered_segment, uint64_t& covered_offset)
+{
+    std::string path = m_directory + "/index";
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    if (fd < 0)
+    {
+        return false;
+    }
+    struct stat st{};
+    ::fstat(fd, &st);
+    std::string data(static_cast<size_t>(st.st_size), '\0');
+    bool ok = preadAll(fd, data.data(), data.size(), 0);
+    ::close(fd);
+
+    uint32_t crc = 0;
+    if (!ok || data.size() < sizeof(crc) + sizeof(INDEX_MAGIC))
+    {
+        LOG_WARN(std::format("Store index {} is unreadable, scanning all segments", path));
+        return false;
+    }
+    std::memcpy(&crc, data.data() + data.size() - sizeof(crc), sizeof(crc));
+    std::string_view in(data.data(), data.size() - sizeof(crc));
+    if (crc32(in) != crc || !in.starts_with(INDEX_MAGIC))
+    {
+        LOG_WARN(std::format("Store index {} fails its checksum, scanning all segments", path));
+        return false;
+    }
+    in.remove_prefix(std::strlen(INDEX_MAGIC));
+
+    uint64_t version = 0;
+    uint64_t segment = 0;
+    uint64_t count = 0;
+    if (!getVarint(in, version) || version != INDEX_VERSION || !getVarint(in, segment) ||
+        !getVarint(in, covered_offset) || !getVarint(in, count))
+    {
+        return false;
+    }
+    covered_segment = static_cast<uint32_t>(segment);
+
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        uint64_t size = 0;
+        if (!getVarint(in, size) || size > in.size())
+        {
+            return false;
+        }
+        std::string name(in.substr(0, size));
+        in.remove_prefix(size);
+
+        Location location;
+        uint64_t id = 0;
+        uint64_t mtime = 0;
+        if (!getVarint(in, id) || !getVarint(in, location.offset) || !getVarint(in, location.length) ||
+            !getVarint(in, location.body_size) || !getVarint(in, mtime))
+        {
+            return false;
+        }
+        location.segment = static_cast<uint32_t>(id);
+        location.mtime = static_cast<time_t>(mtime);
+        m_index.emplace(std::move(name), location);
+    }
+    return in.empty();
+}
+
+void LogDiaryStore::compactLoop()
+{
+    std::unique_lock<std::mutex> lock(m_mutex);
+    while (true)
+    {
+        m_compact_cv.wait_for(lock, COMPACT_INTERVAL, [this]() { return m_stopping || m_compact_requested; });
+        if (m_stopping)
+        {
+            return;
+        }
+        m_compact_requested = false;
+
+        // 从最老的段开始，只压缩已经写满的段
+        std::shared_ptr<Segment> victim;
+        for (const auto& [id, segment] : m_segments)
+        {
+            if (segment != m_active && !segment->damaged &&
+                segment->size - std::min(segment->live, segment->size) >= segment->size * COMPACT_RATIO)
+            {
+                victim = segment;
+                break;
+            }
+        }
+        if (!victim)
+        {
+            continue;
+        }
+
+        lock.unlock();
+        bool done = compact(victim);
+        lock.lock();
+        m_compact_requested = done;     // 压完一个再看看还有没有
+    }
+}
+
+bool LogDiaryStore::compact(const std::shared_ptr<Segment>& segment)
+{
+    bool older = false;
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        older = m_segments.begin()->first < segment->id;
+    }
+
+    // 段已经写满不再变化，扫描不用持锁；每条记录搬不搬要对着当前索引判断，这一步持锁
+    size_t moved = 0;
+    uint64_t kept = 0;
+    bool ok = true;
+    uint64_t end = scan(*segment, 0, [&](const RecordHeader& header, const std::string& name, std::string_view body, uint64_t offset)
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            auto it = m_index.find(name);
+            Location location;
+            if (header.type == static_cast<uint32_t>(RecordType::Put))
+            {
+                if (it != m_index.end() && it->second.segment == segment->id && it->second.offset == offset)
+                {
+                    ok = ok && appendRecordLocked(header, name, body, location);
+                    if (ok)
+                    {
+                        applyLocked(RecordType::Put, name, location);
+                        ++moved;
+                        kept += location.length;
+                    }
+                }
+            }
+            else if (it == m_index.end() && older)
+            {
+                // 更老的段里可能还有这篇的旧版本，删除标记要留着，否则没有索引文件重新扫描时它会复活
+                ok = ok && appendRecordLocked(header, name, body, location);
+                kept += location.length;
+            }
+        });
+
+    if (!ok || end < segment->size)
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        segment->damaged = true;
+        LOG_ERROR(std::format("Compaction of {} stopped at {}, keeping the segment", segmentPath(segment->id), end));
+        return false;
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ::fdatasync(m_active->fd);
+        m_segments.erase(segment->id);
+        if (!saveIndexLocked())
+        {
+            return false;   // 索引还指着旧段，旧段先不删
+        }
+    }
+    ::unlink(segmentPath(segment->id).c_str());
+    syncPath(m_directory);
+    LOG_INFO(std::format("Compacted {}: moved {} diaries, reclaimed {} bytes", segmentPath(segment->id), moved, segment->size - kept));
+    return true;
+}
+
+size_t LogDiaryStore::importDirectory(const std::string& directory)
+{
+    namespace fs = std::filesystem;
+    fs::path backup = fs::path(directory) / ".imported";
+    std::error_code ec;
+    fs::create_directories(backup, ec);
+
+    std::vector<std::string> imported;
+    for (const std::string& name : FileDiaryStore(directory).list())
+    {
+        fs::path path = fs::path(directory) / name;
+        DiaryStat stat;
+        FileDiaryStore(directory).stat(name, stat);
+        if (!put(name, path.string(), stat.mtime))
+        {
+            LOG_ERROR(std::format("Failed to import {}", path.string()));
+            continue;
+        }
+        imported.push_back(name);
+    }
+
+    // 记录和索引都落盘之后才挪走原文件，中途断电最多是重复导入
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (::fdatasync(m_active->fd) != 0 || !saveIndexLocked())
+        {
+            LOG_ERROR(std::format("Failed to sync the imported diaries, keeping the originals in {}", directory));
+            return imported.size();
+        }
+    }
+    for (const std::string& name : imported)
+    {
+        fs::rename(fs::path(directory) / name, backup / name, ec);
+    }
+    syncPath(backup.string());
+    syncPath(directory);
+    LOG_INFO(std::format("Imported {} diaries from {}, originals moved to {}", imported.size(), directory, backup.string()));
+    return imported.size();
+}
+
+std::string LogDiaryStore::statusText() const
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+    uint64_t size = 0;
+    uint64_t live = 0;
+    for (const auto& [id, segment] : m_segments)
+    {
+        size += segment->size;
+        live += segment->live;
+    }
+    return std::format("log store: {} diaries, {} segments, {}/{} bytes live\n", m_index.size(), m_segments.size(), live, size);
+}
+
+#endif // !_WIN32
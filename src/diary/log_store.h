@@ -0,0 +1,135 @@
+﻿/**
+* @file log_store.h
+* @brief 追加写的日志存储：日记写成带 CRC 的记录追加到段文件里，内存索引记每篇的位置，后台压缩删掉的记录
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef LOG_STORE_H
+#define LOG_STORE_H
+
+// 段文件靠 pread/pwrite/fdatasync/copy_file_range，只在 POSIX 上有；Windows 上只能用 --store files
+#ifndef _WIN32
+
+#include "diary_store.h"
+#include <string>
+#include <string_view>
+#include <unordered_map>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <functional>
+
+// 文件都在 directory/.store/ 下：
+//   000001.seg ...   段文件，只追加，写满 SEGMENT_BYTES 换下一个
+//   index            索引文件：每篇日记所在的段和偏移，以及它覆盖到哪个位置
+// 打开时读索引文件，再把它之后追加的记录重放一遍；索引文件坏了就扫描全部段。
+// 修改是追加新记录，删除是追加删除标记，旧记录成了垃圾，一个段里垃圾过半时后台把有效记录搬到当前段再删掉它。
+// 读出来的记录都校验 CRC。追加只写进页缓存，落盘由组提交线程调用 sync 一次做完一批
+class LogDiaryStore : public DiaryStore
+{
+public:
+    static constexpr uint64_t SEGMENT_BYTES = 64 * 1024 * 1024;
+    static constexpr double COMPACT_RATIO = 0.5;    // 垃圾占比到这么多就压缩
+
+    LogDiaryStore() = default;
+    ~LogDiaryStore() override;
+    LogDiaryStore(const LogDiaryStore&) = delete;
+    LogDiaryStore& operator=(const LogDiaryStore&) = delete;
+
+    bool open(const std::string& directory);
+    void close();
+
+    // 一次性导入：把 directory 下一篇一个文件的日记写进来（保留修改时间），
+    // 导完的原文件移到 directory/.imported/ 留作备份。返回导入的篇数
+    size_t importDirectory(const std::string& directory);
+
+    std::vector<std::string> list() const override;
+    bool stat(const std::string& name, DiaryStat& stat) const override;
+    bool read(const std::string& name, std::string& text, size_t limit = 0) const override;
+    bool commit(const std::string& name, const std::string& temp_path) override;
+    bool remove(const std::string& name) override;
+    bool sync() override;
+    bool filesInDirectory() const override { return false; }
+
+    std::string statusText() const override;
+
+private:
+    enum class RecordType : uint32_t
+    {
+        Put = 1,
+        Delete = 2
+    };
+
+    // 记录 = 头部 + 名字 + 正文，CRC 覆盖 type 之后的头部字段、名字和正文
+    struct RecordHeader
+    {
+        uint32_t magic;
+        uint32_t crc;
+        uint32_t type;
+        uint32_t name_size;
+        uint64_t body_size;
+        int64_t mtime;
+    };
+    static_assert(sizeof(RecordHeader) == 32, "record header layout");
+
+    struct Segment
+    {
+        uint32_t id = 0;
+        int fd = -1;
+        uint64_t size = 0;      // 文件长度，也就是下一条记录的偏移
+        uint64_t live = 0;      // 还被索引引用的记录字节数，其余都是垃圾
+        bool damaged = false;   // 扫描时发现坏记录，不再压缩它，免得丢掉后面读不出的数据
+
+        ~Segment();
+    };
+
+    struct Location
+    {
+        uint32_t segment = 0;
+        uint64_t offset = 0;
+        uint64_t length = 0;    // 整条记录
+        uint64_t body_size = 0;
+        time_t mtime = 0;
+    };
+
+    using Visitor = std::function<void(const RecordHeader& header, const std::string& name, std::string_view body, uint64_t offset)>;
+
+    // 依次读出段里 from 之后校验通过的记录；返回最后一条完整记录的结尾，小于段长说明后面坏了
+    uint64_t scan(const Segment& segment, uint64_t from, const Visitor& visit) const;
+    // 把文件内容作为 name 的新版本追加进来
+    bool put(const std::string& name, const std::string& path, time_t mtime);
+
+    // 以下调用方持有 m_mutex
+    void applyLocked(RecordType type, const std::string& name, const Location& location);
+    bool appendRecordLocked(const RecordHeader& header, std::string_view name, std::string_view body, Location& location);
+    bool appendFileLocked(const RecordHeader& header, std::string_view name, int fd, Location& location);
+    bool reserveLocked(uint64_t length);
+    bool saveIndexLocked();
+
+    std::shared_ptr<Segment> openSegment(uint32_t id, bool create) const;
+    std::string segmentPath(uint32_t id) const;
+    bool loadIndex(uint32_t& covered_segment, uint64_t& covered_offset);
+
+    void compactLoop();
+    bool compact(const std::shared_ptr<Segment>& segment);
+
+private:
+    std::string m_directory;    // .store 目录
+
+    mutable std::mutex m_mutex;
+    std::unordered_map<std::string, Location> m_index;
+    std::map<uint32_t, std::shared_ptr<Segment>> m_segments;
+    std::shared_ptr<Segment> m_active;
+
+    std::condition_variable m_compact_cv;
+    bool m_compact_requested = false;
+    bool m_stopping = false;
+    std::thread m_compactor;
+};
+
+#endif // !_WIN32
+
+#endif // !LOG_STORE_H
@@ -0,0 +1,203 @@
+﻿/**
+* @file asset_embedder.cpp
+* @brief 构建期工具：把资源目录下的文件生成成 C++ 源码，编进 footprints
+* @author liushisheng
+* @date 2026-10-17
+*
+* 用法：asset_embedder <资源目录> <输出目录>
+* 输出两个文件：
+*   embedded_assets_data.cpp  每个文件一个字节数组（有预压缩版本时再加一个）
+*   embedded_assets_table.h   按路径排好序的 constexpr 表，由 embed/embedded_assets.h 包含
+* 内容没变时不重写输出文件，免得无谓地重新编译
+*/
+
+#include "comm/mime_types.h"
+#include "comm/gzip.h"
+#include "comm/http_date.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdint>
+#include <ctime>
+#include <filesystem>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+struct SourceFile
+{
+    std::string path;   // 相对资源目录，用 '/' 分隔
+    std::string bytes;
+    std::string gzip;   // 预压缩版本，不值得压缩时为空
+    time_t mtime = 0;
+};
+
+static bool readFile(const fs::path& path, std::string& out)
+{
+    std::ifstream ifs(path, std::ios::binary);
+    if (!ifs) return false;
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    out = ss.str();
+    return true;
+}
+
+// 只在内容变化时写，保持输出文件的修改时间
+static bool writeIfChanged(const fs::path& path, const std::string& content)
+{
+    std::string old;
+    if (readFile(path, old) && old == content) return true;
+    std::ofstream ofs(path, std::ios::binary | std::ios::trunc);
+    ofs << content;
+    return static_cast<bool>(ofs);
+}
+
+// 小文件、压不下去的文件不带预压缩版本
+static std::string precompress(const SourceFile& file)
+{
+#ifdef ASSET_EMBEDDER_GZIP
+    constexpr size_t MIN_SIZE = 256;
+    if (file.bytes.size() < MIN_SIZE ||
+        !isCompressibleMime(guessMimeType(fs::path(file.path).extension().string())))
+    {
+        return {};
+    }
+    std::string gz;
+    if (!gzipCompress(file.bytes, gz, 9) || gz.size() * 10 > file.bytes.size() * 9)
+    {
+        return {};
+    }
+    return gz;
+#else
+    (void)file;
+    return {};
+#endif
+}
+
+// FNV-1a，只用来做 ETag
+static uint64_t hashBytes(const std::string& bytes)
+{
+    uint64_t h = 0xcbf29ce484222325ULL;
+    for (unsigned char c : bytes)
+    {
+        h ^= c;
+        h *= 0x100000001b3ULL;
+    }
+    return h;
+}
+
+static std::string cppLiteral(std::string_view s)
+{
+    std::string out = "\"";
+    for (char c : s)
+    {
+        if (c == '"' || c == '\\') out += '\\';
+        out += c;
+    }
+    out += '"';
+    return out;
+}
+
+static void appendArray(std::string& out, const std::string& name, const std::string& bytes)
+{
+    out += "extern const unsigned char " + name + "[] = {";
+    if (bytes.empty())
+    {
+        out += "0";
+    }
+    for (size_t i = 0; i < bytes.size(); ++i)
+    {
+        if (i % 32 == 0) out += "\n    ";
+        out += std::to_string(static_cast<unsigned char>(bytes[i]));
+        out += ',';
+    }
+    out += "\n};\n";
+}
+
+int main(int argc, char* argv[])
+{
+    if (argc != 3)
+    {
+        std::cerr << "usage: asset_embedder <assets dir> <output dir>" << std::endl;
+        return 1;
+    }
+    const fs::path root = argv[1];
+    const fs::path output = argv[2];
+
+    std::vector<SourceFile> files;
+    std::error_code ec;
+    for (auto it = fs::recursive_directory_iterator(root, ec); !ec && it != fs::recursive_directory_iterator(); it.increment(ec))
+    {
+        if (!it->is_regular_file()) continue;
+
+        SourceFile file;
+        file.path = it->path().lexically_relative(root).generic_string();
+        if (!readFile(it->path(), file.bytes))
+        {
+            std::cerr << "asset_embedder: cannot read " << it->path() << std::endl;
+            return 1;
+        }
+        auto ftime = fs::last_write_time(it->path());
+        file.mtime = std::chrono::system_clock::to_time_t(
+            std::chrono::time_point_cast<std::chrono::system_clock::duration>(std::chrono::file_clock::to_sys(ftime)));
+        file.gzip = precompress(file);
+        files.push_back(std::move(file));
+    }
+    if (ec)
+    {
+        std::cerr << "asset_embedder: cannot walk " << root << ": " << ec.message() << std::endl;
+        return 1;
+    }
+
+    // 表按路径的字节序排好，运行时和编译期都用二分查找
+    std::sort(files.begin(), files.end(),
+        [](const SourceFile& a, const SourceFile& b) { return a.path < b.path; });
+
+    std::string data = "// 由 asset_embedder 生成，不要手改\n\n";
+    std::string table = "// 由 asset_embedder 生成，不要手改，由 embed/embedded_assets.h 包含\n\n";
+    std::string entries;
+    for (size_t i = 0; i < files.size(); ++i)
+    {
+        const SourceFile& file = files[i];
+        std::string name = "EMBEDDED_ASSET_" + std::to_string(i);
+        std::string gzip_name = file.gzip.empty() ? "nullptr" : name + "_GZ";
+
+        data += "// " + file.path + "\n";
+        appendArray(data, name, file.bytes);
+        table += "extern const unsigned char " + name + "[];\n";
+        if (!file.gzip.empty())
+        {
+            appendArray(data, gzip_name, file.gzip);
+            table += "extern const unsigned char " + gzip_name + "[];\n";
+        }
+        data += '\n';
+
+        // 压缩版本是另一种表示，ETag 也要不同
+        char hash[32];
+        snprintf(hash, sizeof(hash), "%016llx", static_cast<unsigned long long>(hashBytes(file.bytes)));
+        std::string etag = std::string("\"") + hash + "\"";
+        std::string gzip_etag = file.gzip.empty() ? std::string() : std::string("\"") + hash + "-gz\"";
+
+        entries += "    EmbeddedAsset{ " + cppLiteral(file.path) + ", "
+            + cppLiteral(guessMimeType(fs::path(file.path).extension().string())) + ",\n"
+            + "        " + name + ", " + std::to_string(file.bytes.size()) + ", "
+            + gzip_name + ", " + std::to_string(file.gzip.size()) + ",\n"
+            + "        " + cppLiteral(etag) + ", " + cppLiteral(gzip_etag) + ", " + cppLiteral(formatHttpDate(file.mtime)) + ", "
+            + std::to_string(static_cast<long long>(file.mtime)) + " },\n";
+    }
+    table += "\ninline constexpr std::array<EmbeddedAsset, " + std::to_string(files.size()) + "> EMBEDDED_ASSETS\n{ {\n"
+        + entries + "} };\n";
+
+    fs::create_directories(output, ec);
+    if (!writeIfChanged(output / "embedded_assets_data.cpp", data) ||
+        !writeIfChanged(output / "embedded_assets_table.h", table))
+    {
+        std::cerr << "asset_embedder: cannot write to " << output << std::endl;
+        return 1;
+    }
+    return 0;
+}
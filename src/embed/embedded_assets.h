@@ -0,0 +1,53 @@
+﻿/**
+* @file embedded_assets.h
+* @brief 编进程序的静态资源：构建时由 asset_embedder 把 src/assets 生成成只读表，按路径 constexpr 查找
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef EMBEDDED_ASSETS_H
+#define EMBEDDED_ASSETS_H
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <memory>
+#include <string_view>
+
+// 一个嵌入的文件，所有字段在构建时算好，内容在只读数据段里，程序运行期间一直有效
+struct EmbeddedAsset
+{
+    std::string_view path;              // 相对 src/assets，如 "three/three.js"
+    std::string_view content_type;
+    const unsigned char* data;
+    size_t size;
+    const unsigned char* gzip_data;     // gzip 预压缩版本，没有时为 nullptr
+    size_t gzip_size;
+    std::string_view etag;              // 内容哈希，带引号
+    std::string_view gzip_etag;         // 压缩版本的 ETag，没有压缩版本时为空
+    std::string_view last_modified;     // 构建时源文件的修改时间，HTTP 日期格式
+    long long mtime;                    // 同一个时间，秒，比较 If-Modified-Since 用
+
+    std::string_view bytes() const { return { reinterpret_cast<const char*>(data), size }; }
+    std::string_view gzipBytes() const { return { reinterpret_cast<const char*>(gzip_data), gzip_size }; }
+};
+
+#include "embedded_assets_table.h"
+
+// 路径不含开头的 '/'，找不到返回 nullptr。可以在编译期用，比如 static_assert 页面模板确实编进去了
+constexpr const EmbeddedAsset* findEmbeddedAsset(std::string_view path)
+{
+    auto it = std::lower_bound(EMBEDDED_ASSETS.begin(), EMBEDDED_ASSETS.end(), path,
+        [](const EmbeddedAsset& asset, std::string_view key) { return asset.path < key; });
+    return it != EMBEDDED_ASSETS.end() && it->path == path ? &*it : nullptr;
+}
+
+// 发送路径要求共享内存有一个持有者；嵌入资源不会释放，所有响应共用这个空持有者
+inline const std::shared_ptr<const void>& embeddedAssetOwner()
+{
+    static const char anchor = 0;
+    static const std::shared_ptr<const void> owner(&anchor, [](const void*) {});
+    return owner;
+}
+
+#endif // !EMBEDDED_ASSETS_H
@@ -0,0 +1,196 @@
+﻿/**
+* @file api_handler.h
+* @brief  日记的 JSON 接口，给脚本用：/api/diaries 列表、单篇读取、新建和删除
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include <router/router.h>
+#include "diary/diary_index.h"
+#include "diary/diary_upload.h"
+#include "diary/group_commit.h"
+#include "comm/json_writer.h"
+#include "comm/http_date.h"
+#include "http/http_conditional.h"
+#include <format>
+
+static constexpr std::string_view JSON_CONTENT_TYPE = "application/json; charset=utf-8";
+
+// {"error": message}
+void setJsonError(HttpResponse& res, HttpStatus status, std::string_view message)
+{
+    std::string body;
+    JsonWriter(body).beginObject().key("error").value(message).endObject();
+    res.setStatus(status);
+    res.setBody(std::move(body), JSON_CONTENT_TYPE);
+}
+
+// 索引里有的字段：name date title size mtime，没有日期的 date 为 null
+void writeDiaryFields(JsonWriter& json, const DiaryEntry& entry)
+{
+    json.key("name").value(entry.filename);
+    json.key("date");
+    if (entry.date.empty()) json.null();
+    else json.value(entry.date);
+    json.key("title").value(entry.title);
+    json.key("size").value(static_cast<uint64_t>(entry.size));
+    json.key("mtime").value(static_cast<int64_t>(entry.mtime));
+}
+
+// 日记第一行是标题，content 只要后面的正文，和查看页一样
+std::string_view diaryContent(std::string_view text)
+{
+    size_t eol = text.find('\n');
+    return eol == std::string_view::npos ? std::string_view() : text.substr(eol + 1);
+}
+
+// GET /api/diaries?from=&to=&after=&limit=&content=1
+// 和首页一样按日期从新到旧分页，next 是下一页的游标（没有下一页为 null）。
+// content=1 时每篇带上正文，用来整批导出：正文逐篇读进同一个缓冲区再转义写出，不为每篇建字符串
+void handlerApiListDiaries(const HttpRequest& req, HttpResponse& res)
+{
+    DiaryPageQuery query;
+    if (!parseDiaryPageQuery(req, query))
+    {
+        setJsonError(res, HttpStatus::BadRequest, "from/to 应为 YYYY-MM-DD，limit 应为数字");
+        return;
+    }
+    bool with_content = req.query("content") == "1";
+
+    DiaryIndex::Version version;
+    DiaryIndex::Page page = DiaryIndex::getInstance().page(query, version);
+    std::string etag = makeWeakEtag({ version.generation });
+    res.setHeader(HttpHeader::ETag, etag);
+    res.setHeader(HttpHeader::LastModified, formatHttpDate(version.modified));
+    res.setHeader(HttpHeader::CacheControl, CACHE_CONTROL_REVALIDATE);
+    if (isNotModified(req, etag, version.modified))
+    {
+        setNotModified(res);
+        return;
+    }
+
+    std::string body;
+    body.reserve(page.entries.size() * (with_content ? 1024 : 160) + 64);
+    std::string text;
+    JsonWriter json(body);
+    json.beginObject().key("diaries").beginArray();
+    for (const DiaryEntry* entry : page.entries)
+    {
+        json.beginObject();
+        writeDiaryFields(json, *entry);
+        if (with_content)
+        {
+            // 列出之后又被删掉的给 null
+            json.key("content");
+            if (DiaryIndex::getInstance().store().read(entry->filename, text)) json.value(diaryContent(text));
+            else json.null();
+        }
+        json.endObject();
+    }
+    json.endArray();
+    json.key("total").value(static_cast<uint64_t>(page.total));
+    json.key("next");
+    if (page.next.empty()) json.null();
+    else json.value(page.next);
+    json.endObject();
+
+    res.setStatus(HttpStatus::OK);
+    res.setBody(std::move(body), JSON_CONTENT_TYPE);
+}
+
+// GET /api/diaries/:name
+void handlerApiGetDiary(const HttpRequest& req, HttpResponse& res)
+{
+    std::string filename(req.param("name"));
+
+    DiaryEntry entry;
+    if (!DiaryIndex::getInstance().find(filename, entry))
+    {
+        setJsonError(res, HttpStatus::NotFound, "日记不存在");
+        return;
+    }
+    std::string etag = makeWeakEtag({ entry.version });
+    res.setHeader(HttpHeader::ETag, etag);
+    res.setHeader(HttpHeader::LastModified, formatHttpDate(entry.mtime));
+    res.setHeader(HttpHeader::CacheControl, CACHE_CONTROL_REVALIDATE);
+    if (isNotModified(req, etag, entry.mtime))
+    {
+        setNotModified(res);
+        return;
+    }
+
+    std::string text;
+    if (!DiaryIndex::getInstance().store().read(filename, text))
+    {
+        setJsonError(res, HttpStatus::NotFound, "日记不存在");
+        return;
+    }
+
+    std::string body;
+    body.reserve(text.size() + 256);
+    JsonWriter json(body);
+    json.beginObject();
+    writeDiaryFields(json, entry);
+    json.key("content").value(diaryContent(text));
+    json.endObject();
+
+    res.setStatus(HttpStatus::OK);
+    res.setBody(std::move(body), JSON_CONTENT_TYPE);
+}
+
+// POST /api/diaries，正文和写日记页面一样是表单（urlencoded 或 multipart，可以带附件），
+// 落盘之后回 201，Location 指向新日记，正文是它的索引字段
+void handlerApiCreateDiary(const HttpRequest& req, HttpResponse& res)
+{
+    DiaryUpload* upload = dynamic_cast<DiaryUpload*>(req.body_stream.get());
+    if (!upload)
+    {
+        setJsonError(res, HttpStatus::BadRequest, "正文应为 application/x-www-form-urlencoded 或 multipart/form-data");
+        return;
+    }
+
+    std::string filename;
+    DiaryEntry entry;
+    if (!saveDiary(*upload, filename) || !DiaryIndex::getInstance().find(filename, entry))
+    {
+        setJsonError(res, HttpStatus::InternalServerError, "保存日记失败");
+        return;
+    }
+
+    std::string body;
+    JsonWriter json(body);
+    json.beginObject();
+    writeDiaryFields(json, entry);
+    json.endObject();
+
+    res.setStatus(HttpStatus::Created);
+    res.setHeader(HttpHeader::Location, "/api/diaries/" + urlEncode(filename));
+    res.setBody(std::move(body), JSON_CONTENT_TYPE);
+    respondWhenDurable(res, upload->savedPaths(), [](HttpResponse& res)
+        {
+            setJsonError(res, HttpStatus::InternalServerError, "保存日记失败");
+        });
+}
+
+// DELETE /api/diaries/:name，落盘之后回 204
+void handlerApiDeleteDiary(const HttpRequest& req, HttpResponse& res)
+{
+    std::string filename(req.param("name"));
+
+    if (!DiaryIndex::getInstance().store().remove(filename))
+    {
+        setJsonError(res, HttpStatus::NotFound, "日记不存在");
+        return;
+    }
+    DiaryIndex::getInstance().remove(filename);
+    res.setStatus(HttpStatus::NoContent);
+    respondWhenDurable(res, {}, [](HttpResponse& res)
+        {
+            setJsonError(res, HttpStatus::InternalServerError, "删除日记失败");
+        });
+}
+
+static RouteRegister _reg_api_list("/api/diaries", "GET", handlerApiListDiaries);
+static RouteRegister _reg_api_get("/api/diaries/:name", "GET", handlerApiGetDiary);
+static RouteRegister _reg_api_create("/api/diaries", "POST", handlerApiCreateDiary, diaryUploadStream);
+static RouteRegister _reg_api_delete("/api/diaries/:name", "DELETE", handlerApiDeleteDiary);
@@ -6,43 +6,88 @@
 */
 
 #include <router/router.h>
+#include "cache/asset_cache.h"
+#include "embed/embedded_assets.h"
+#include "comm/config.h"
+#include "http/http_conditional.h"
+#include "http/http_range.h"
 #include <fstream>
 #include <iomanip>
 #include <filesystem>
 #include <format>
 
-inline std::string guessMimeType(const std::string& ext)
+inline void handlerAssets(const HttpRequest& req, HttpResponse& res) 
 {
-    static const std::unordered_map<std::string, std::string> mime
+    // 默认只看编进程序的表，内容在只读数据段里，零拷贝发出
+    const std::string& assets_dir = Config::getInstance().assets_dir;
+    if (assets_dir.empty())
     {
-        {".html", "text/html"},
-        {".htm", "text/html"},
-        {".css", "text/css"},
-        {".js", "application/javascript"},
-        {".png", "image/png" },
-        {".jpg", "image/jpeg"},
-        {".gif", "image/jpeg"},
-        {".svg", "image/gif"},
-        {".ico", "image/x-icon"}
-    };
-    auto it = mime.find(ext);
-    if (it != mime.end())return it->second;
-    return "application/octet-stream";
-}
+        const EmbeddedAsset* asset = findEmbeddedAsset(req.param("path"));
+        if (!asset)
+        {
+            res.setBody("404 Not Found", "text/plain");
+            res.setStatus(HttpStatus::NotFound);
+            return;
+        }
+        // 有构建时压好的版本就按 Accept-Encoding 选一个，两种表示的 ETag 不同
+        bool gzip = asset->gzip_data && req.acceptsEncoding("gzip");
+        std::string_view etag = gzip ? asset->gzip_etag : asset->etag;
+        res.setHeader(HttpHeader::ETag, etag);
+        res.setHeader(HttpHeader::LastModified, asset->last_modified);
+        res.setHeader(HttpHeader::CacheControl, CACHE_CONTROL_ASSETS);
+        if (asset->gzip_data)
+        {
+            res.setHeader(HttpHeader::Vary, "Accept-Encoding");
+        }
+        if (isNotModified(req, etag, static_cast<time_t>(asset->mtime)))
+        {
+            setNotModified(res);
+            return;
+        }
 
-inline void handlerAssets(const HttpRequest& req, HttpResponse& res) 
-{
-    static const std::filesystem::path baseDir = std::filesystem::absolute("assets");
-    static std::string prefix = "/assets/";
+        res.setShared(SharedBuffer{ embeddedAssetOwner(), gzip ? asset->gzipBytes() : asset->bytes() }, asset->content_type);
+        if (gzip)
+        {
+            res.setHeader(HttpHeader::ContentEncoding, "gzip");
+        }
+        res.setStatus(HttpStatus::OK);
+        applyRange(req, res);
+        return;
+    }
 
-    if (req.path.find(prefix, 0) != 0)
+    // 开发模式：热门资源直接从缓存发，不碰文件系统
+    if (auto asset = AssetCache::getInstance().get(req.param("path")))
     {
-        res.setBody("404 Not Found", "text/plain");
-        res.setStatus(HttpStatus::NotFound);
+        // 压缩版本第一次用到时才压，之后和原文一起留在缓存里
+        bool compressible = isCompressibleMime(asset->content_type);
+        std::string_view gzip = compressible && req.acceptsEncoding("gzip") ? asset->gzipBytes() : std::string_view();
+        std::string_view etag = gzip.empty() ? asset->etag : asset->gzip_etag;
+        res.setHeader(HttpHeader::ETag, etag);
+        res.setHeader(HttpHeader::LastModified, asset->last_modified);
+        res.setHeader(HttpHeader::CacheControl, CACHE_CONTROL_REVALIDATE);
+        if (compressible)
+        {
+            res.setHeader(HttpHeader::Vary, "Accept-Encoding");
+        }
+        if (isNotModified(req, etag, asset->mtime))
+        {
+            setNotModified(res);
+            return;
+        }
+
+        res.setShared(SharedBuffer{ asset, gzip.empty() ? asset->bytes : gzip }, asset->content_type);
+        if (!gzip.empty())
+        {
+            res.setHeader(HttpHeader::ContentEncoding, "gzip");
+        }
+        res.setStatus(HttpStatus::OK);
+        applyRange(req, res);
         return;
     }
 
-    std::filesystem::path filePath = std::filesystem::weakly_canonical(baseDir / req.path.substr(prefix.size()));
+    // 不在缓存里（太大、缓存关闭或者文件不存在）
+    static const std::filesystem::path baseDir = std::filesystem::weakly_canonical(assets_dir);
+    std::filesystem::path filePath = std::filesystem::weakly_canonical(baseDir / req.param("path"));
 
     if (filePath.string().find(baseDir.string(), 0) != 0 ||
         !std::filesystem::exists(filePath) ||
@@ -53,14 +98,20 @@ inline void handlerAssets(const HttpRequest& req, HttpResponse& res)
         return;
     }
 
-    std::ifstream ifs(filePath, std::ios::binary);
-    std::ostringstream oss;
-    oss << ifs.rdbuf();
+    // 只打开文件，正文由发送路径用 sendfile 直接从页缓存发出
+    auto file = FileRegion::open(filePath.string());
+    if (!file)
+    {
+        res.setBody("403 Forbidden", "text/plain");
+        res.setStatus(HttpStatus::Forbidden);
+        return;
+    }
 
-    res.setBody(oss.str(), guessMimeType(filePath.extension().string()));
+    res.setFile(std::move(file), guessMimeType(filePath.extension().string()));
     res.setStatus(HttpStatus::OK);
+    applyRange(req, res);
 }
 
 
 
-static RouteRegister _regAssets("/assets", "GET", handlerAssets);
\ No newline at end of file
+static RouteRegister _regAssets("/assets/*path", "GET", handlerAssets);
\ No newline at end of file
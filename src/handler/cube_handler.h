@@ -1,4 +1,4 @@
-
+﻿
 /**
 * @file cube_handler.h
 * @brief  3D 正方体，玩玩
@@ -7,20 +7,30 @@
 */
 
 #include <router/router.h>
+#include "template/html_template.h"
+#include "embed/embedded_assets.h"
+#include "http/http_conditional.h"
 #include <fstream>
 #include <iomanip>
 #include <filesystem>
 #include <format>
 
+static_assert(findEmbeddedAsset("html/3D_cube.html"), "cube page is missing from src/assets");
 
 void handlerCube(const HttpRequest& req, HttpResponse& res)
 {
-    std::ifstream ifs("assets/html/3D_cube.html");
-    std::stringstream ss;
-    ss << ifs.rdbuf();
-    std::string html = ss.str();
+    static HtmlTemplate page("html/3D_cube.html");
+
+    std::string etag = makeWeakEtag({ page.version() });
+    res.setHeader(HttpHeader::ETag, etag);
+    res.setHeader(HttpHeader::CacheControl, CACHE_CONTROL_REVALIDATE);
+    if (isNotModified(req, etag, 0))
+    {
+        setNotModified(res);
+        return;
+    }
 
-    res.setBody(html, "text/html");
+    res.setBody(page.render(), "text/html");
     res.setStatus(HttpStatus::OK);
 }
 
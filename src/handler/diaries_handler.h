@@ -6,10 +6,25 @@
 */
 
 #include <router/router.h>
+#include "diary/diary_index.h"
+#include "diary/diary_upload.h"
+#include "diary/group_commit.h"
+#include "template/html_template.h"
+#include "embed/embedded_assets.h"
+#include "http/http_conditional.h"
+#include "comm/http_date.h"
 #include <fstream>
 #include <iomanip>
 #include <filesystem>
 #include <format>
+#include <charconv>
+#include <cctype>
+#include <mutex>
+#include <functional>
+
+// 页面模板缺了在编译期就报错，而不是等到请求时
+static_assert(findEmbeddedAsset("html/index.html") && findEmbeddedAsset("html/write.html") &&
+    findEmbeddedAsset("html/diary_view.html"), "diary page templates are missing from src/assets");
 
 // 生成文件名 YYYY-MM-DD-title.txt
 std::string generateDiaryFilename(std::string title) 
@@ -27,18 +42,19 @@ std::string generateDiaryFilename(std::string title)
     return oss.str();
 }
 
-// 读取 diaries 文件夹，生成 HTML 列表（删除用 POST 表单）
-std::string buildDiaryListHtml(const std::string& diary_dir)
+// 用内存里的日记索引生成 HTML 列表，不访问文件系统
+std::string buildDiaryListHtml(const std::vector<const DiaryEntry*>& entries)
 {
     std::ostringstream oss;
     oss << "<table>\n";
-    oss << "<tr><th>文件名</th><th>操作</th></tr>\n";
+    oss << "<tr><th>日期</th><th>文件名</th><th>操作</th></tr>\n";
 
-    for (auto& p : std::filesystem::directory_iterator(diary_dir))
+    for (const DiaryEntry* entry : entries)
     {
-        std::string filename = p.path().filename().string();
+        const std::string& filename = entry->filename;
 
         oss << "<tr>"
+            << "<td>" << entry->date << "</td>"
             << "<td>" << filename << "</td>"
             << "<td>"
             << "<a href=\"/diary/" << filename << "\">查看</a> "
@@ -52,44 +68,69 @@ std::string buildDiaryListHtml(const std::string& diary_dir)
     return oss.str();
 }
 
-inline std::unordered_map<std::string, std::string> parseFormData(const std::string& body)
+// 查询串里的值做百分号编码，游标是文件名，里面有中文和括号
+std::string urlEncode(std::string_view value)
+{
+    static constexpr char HEX[] = "0123456789ABCDEF";
+    std::string encoded;
+    for (unsigned char c : value)
+    {
+        if (std::isalnum(c) || c == '-' || c == '_' || c == '.' || c == '~')
+        {
+            encoded += static_cast<char>(c);
+        }
+        else
+        {
+            encoded += '%';
+            encoded += HEX[c >> 4];
+            encoded += HEX[c & 15];
+        }
+    }
+    return encoded;
+}
+
+// 从查询串读分页条件，日期格式不对返回 false
+bool parseDiaryPageQuery(const HttpRequest& req, DiaryPageQuery& query)
 {
-    std::unordered_map<std::string, std::string> result;
-    std::istringstream ss(body);
-    std::string pair;
+    query.from = req.query("from");
+    query.to = req.query("to");
+    query.after = req.query("after");
+    if ((!query.from.empty() && !DiaryIndex::isDate(query.from)) || (!query.to.empty() && !DiaryIndex::isDate(query.to)))
+    {
+        return false;
+    }
 
-    while (std::getline(ss, pair, '&'))
+    std::string limit = req.query("limit");
+    if (!limit.empty())
     {
-        auto pos = pair.find("=");
-        if (pos != std::string::npos)
+        auto [ptr, ec] = std::from_chars(limit.data(), limit.data() + limit.size(), query.limit);
+        if (ec != std::errc() || ptr != limit.data() + limit.size())
         {
-            std::string key = pair.substr(0, pos);
-            std::string value = pair.substr(pos + 1);
-
-            // url decode
-            std::string decoded;
-            for (size_t i = 0; i < value.length(); ++i)
-            {
-                if (value[i] == '+')
-                {
-                    decoded += ' ';
-                }
-                else if (value[i] == '%' && i + 2 < value.length())
-                {
-                    int hex;
-                    std::istringstream(value.substr(i + 1, 2)) >> std::hex >> hex;
-                    decoded += static_cast<char>(hex);
-                    i += 2;
-                }
-                else
-                {
-                    decoded += value[i];
-                }
-            }
-            result[key] = decoded;
+            return false;
         }
     }
-    return result;
+    return true;
+}
+
+// 翻页链接：保留日期条件和每页条数，只换游标
+std::string buildPagerHtml(std::string_view path, const DiaryPageQuery& query, const DiaryIndex::Page& page)
+{
+    std::string common;
+    if (!query.from.empty()) common += "&from=" + query.from;
+    if (!query.to.empty()) common += "&to=" + query.to;
+    if (query.limit != DiaryPageQuery::DEFAULT_LIMIT) common += std::format("&limit={}", query.limit);
+
+    std::string html = std::format("<p>共 {} 篇", page.total);
+    if (!query.after.empty())
+    {
+        html += std::format(" <a href=\"{}?{}\">最新</a>", path, common.empty() ? "" : common.substr(1));
+    }
+    if (!page.next.empty())
+    {
+        html += std::format(" <a href=\"{}?after={}{}\">更早</a>", path, urlEncode(page.next), common);
+    }
+    html += "</p>\n";
+    return html;
 }
 
 std::string utf8_truncate(const std::string& s, size_t chars)
@@ -113,118 +154,177 @@ std::string utf8_truncate(const std::string& s, size_t chars)
 }
 
 
+// 首页和 /diaries 都是按日期倒序的分页列表，支持 ?from=YYYY-MM-DD&to=YYYY-MM-DD&after=游标&limit=N
 void handlerHome(const HttpRequest& req, HttpResponse& res) 
 {
-    std::ifstream ifs("assets/html/index.html");
-    std::stringstream ss;
-    ss << ifs.rdbuf();
-    std::string html = ss.str();
-
-    std::string diaries_path = "diaries";
-#ifdef DIARIES_PATH
-    diaries_path = DIARIES_PATH;
-#endif
-    if (!std::filesystem::exists(diaries_path))
+    static HtmlTemplate page("html/index.html");
+
+    DiaryPageQuery query;
+    if (!parseDiaryPageQuery(req, query))
     {
-        std::filesystem::create_directories(diaries_path);
+        res.setStatus(HttpStatus::BadRequest);
+        res.setBody("日期格式应为 YYYY-MM-DD");
+        return;
     }
-    std::string diary_list = buildDiaryListHtml(diaries_path);
 
-    size_t pos = html.find("{{DIARY_LIST}}");
-    if (pos != std::string::npos)
-        html.replace(pos, std::string("{{DIARY_LIST}}").length(), diary_list);
+    // 列表只随索引和模板变化，浏览器手里的还是最新的就不渲染
+    DiaryIndex::Version version;
+    DiaryIndex::Page diaries = DiaryIndex::getInstance().page(query, version);
+    std::string etag = makeWeakEtag({ version.generation, page.version() });
+    res.setHeader(HttpHeader::ETag, etag);
+    res.setHeader(HttpHeader::LastModified, formatHttpDate(version.modified));
+    res.setHeader(HttpHeader::CacheControl, CACHE_CONTROL_REVALIDATE);
+    if (isNotModified(req, etag, version.modified))
+    {
+        setNotModified(res);
+        return;
+    }
 
-    res.setBody(html, "text/html");
+    std::string diary_list = buildDiaryListHtml(diaries.entries);
+    std::string pager = buildPagerHtml(req.path, query, diaries);
+    res.setBody(page.render({ { "DIARY_LIST", diary_list }, { "PAGER", pager },
+        { "FROM", query.from }, { "TO", query.to } }), "text/html");
     res.setStatus(HttpStatus::OK);
 }
 
 void handlerWrite(const HttpRequest& req, HttpResponse& res)
 {
-    std::ifstream ifs("assets/html/write.html");
-    std::stringstream ss;
-    ss << ifs.rdbuf();
-    std::string html = ss.str();
+    static HtmlTemplate page("html/write.html");
 
-    res.setBody(html, "text/html");
+    std::string etag = makeWeakEtag({ page.version() });
+    res.setHeader(HttpHeader::ETag, etag);
+    res.setHeader(HttpHeader::CacheControl, CACHE_CONTROL_REVALIDATE);
+    if (isNotModified(req, etag, 0))
+    {
+        setNotModified(res);
+        return;
+    }
+
+    res.setBody(page.render(), "text/html");
     res.setStatus(HttpStatus::OK);
 }
 
-void handlerPostWrite(const HttpRequest& req, HttpResponse& res)
+// 响应照成功的样子填好之后调用：等此前写进存储的修改和 paths 都落盘了再发出，用户看到结果时就不会因为掉电丢掉。
+// 落盘失败时清掉已经设置的头部，由 on_fail 改成错误响应。等待不占线程，同时写的请求并成一批落盘（见 group_commit.h）
+void respondWhenDurable(HttpResponse& res, std::vector<std::string> paths, std::function<void(HttpResponse&)> on_fail)
 {
-    LOG_INFO(std::format("Raw POST body: {}", req.body));
+    res.defer = [&res, paths = std::move(paths), on_fail = std::move(on_fail)](std::function<void()> resume) mutable
+        {
+            GroupCommitter::getInstance().syncAsync(std::move(paths),
+                [&res, on_fail = std::move(on_fail), resume = std::move(resume)](bool ok)
+                {
+                    if (!ok)
+                    {
+                        res.headers.clear();
+                        on_fail(res);
+                    }
+                    resume();
+                });
+        };
+}
 
-    auto form =  parseFormData(req.body);
-    std::string title = form["title"];
-    std::string content = form["content"];
+// 表单正文在 IO 线程上已经边收边写进了日记目录下的临时文件，这里只剩起名字、改名到位
+// 把收完的日记存好（还没落盘，见 respondWhenDurable），成功时 filename 是最终的名字。表单页面和 /api/diaries 共用
+bool saveDiary(DiaryUpload& upload, std::string& filename)
+{
+    const std::string& title = upload.title();
+    // 标题要拼进文件名和附件目录名，里面的 / \ 之类会让文件写到日记目录外面去，先换掉
+    std::string safe_title = sanitizeDiaryTitle(title);
+    std::string truncate_string = utf8_truncate(safe_title, 10);
+    if (truncate_string.size() < safe_title.size()) truncate_string += "...";
 
-    std::string truncate_string = utf8_truncate(title, 10);
-    if (truncate_string.size() < title.size()) truncate_string += "...";
+    // 同一天同一个（截断后的）标题以前会互相覆盖，重名时加序号；选名字到进索引之间不能有别的写入插进来
+    {
+        static std::mutex name_mutex;
+        std::lock_guard<std::mutex> lock(name_mutex);
+        std::string base = generateDiaryFilename(truncate_string);
+        filename = base;
+        DiaryEntry existing;
+        for (int n = 2; DiaryIndex::getInstance().find(filename, existing); ++n)
+        {
+            filename = std::format("{}-{}", base, n);
+        }
 
-    std::string filename = generateDiaryFilename(truncate_string);
+        // 目录监视会报告这次改名，索引已经由这里更新，不用再读一遍
+        DiaryIndex::getInstance().expectWrite(filename);
+        bool ok = upload.commit(filename, DiaryIndex::getInstance().store());
+        DiaryIndex::getInstance().update(filename);
+        if (!ok)
+        {
+            return false;
+        }
+    }
+    LOG_INFO(std::format("Saved diary {} with {} attachment(s)", filename, upload.attachmentCount()));
+    return true;
+}
 
-    std::string diaries_path = "diaries";
-#ifdef DIARIES_PATH
-    diaries_path = DIARIES_PATH;
-#endif
-    if (!std::filesystem::exists(diaries_path))
+void handlerPostWrite(const HttpRequest& req, HttpResponse& res)
+{
+    DiaryUpload* upload = dynamic_cast<DiaryUpload*>(req.body_stream.get());
+    if (!upload)
     {
-        std::filesystem::create_directories(diaries_path);
+        res.setStatus(HttpStatus::BadRequest);
+        res.setBody("表单格式不对");
+        return;
     }
 
-    std::ofstream ofs(std::filesystem::path(diaries_path) / filename);
-    ofs << title << "\n";
-    ofs << content << "\n";
-    ofs.close();
+    std::string filename;
+    if (!saveDiary(*upload, filename))
+    {
+        res.setStatus(HttpStatus::InternalServerError);
+        res.setBody("保存日记失败");
+        return;
+    }
 
     res.setStatus(HttpStatus::Found);
-    res.headers["Location"] = "/";
+    res.setHeader(HttpHeader::Location, "/");
     res.setBody("");
+    respondWhenDurable(res, upload->savedPaths(), [](HttpResponse& res)
+        {
+            res.setStatus(HttpStatus::InternalServerError);
+            res.setBody("保存日记失败");
+        });
+}
+
+// 写日记的正文不整个缓冲，按表单类型建一个接收器直接写盘
+std::unique_ptr<BodySink> diaryUploadStream(const HttpRequest& req)
+{
+    return DiaryUpload::create(DiaryIndex::getInstance().directory(), req.headers.get(HttpHeader::ContentType));
 }
 
 void handlerViewDiary(const HttpRequest& req, HttpResponse& res)
 {
-    std::string path = req.path; // "/diary/filename"
-    std::string filename = path.substr(std::string("/diary/").size());
+    static HtmlTemplate page("html/diary_view.html");
+    std::string filename(req.param("name")); // "/diary/:name"
 
-    std::string diaries_path = "diaries";
-#ifdef DIARIES_PATH
-    diaries_path = DIARIES_PATH;
-#endif
-    std::filesystem::path file_path = std::filesystem::path(diaries_path) / filename;
+    // 索引里有这一篇就先看浏览器缓存的是不是最新的，是的话不读文件
+    DiaryEntry entry;
+    if (DiaryIndex::getInstance().find(filename, entry))
+    {
+        std::string etag = makeWeakEtag({ entry.version, page.version() });
+        res.setHeader(HttpHeader::ETag, etag);
+        res.setHeader(HttpHeader::LastModified, formatHttpDate(entry.mtime));
+        res.setHeader(HttpHeader::CacheControl, CACHE_CONTROL_REVALIDATE);
+        if (isNotModified(req, etag, entry.mtime))
+        {
+            setNotModified(res);
+            return;
+        }
+    }
 
-    if (!std::filesystem::exists(file_path))
+    std::string text;
+    if (!DiaryIndex::getInstance().store().read(filename, text))
     {
         res.setStatus(HttpStatus::NotFound);
         res.setBody("日记不存在");
         return;
     }
 
-    std::ifstream ifs(file_path);
-    std::string first_line;
-    std::getline(ifs, first_line);  // 第一行作为标题
-    std::stringstream ss;
-    ss << ifs.rdbuf();
-    std::string content = ss.str(); // 剩余部分作为正文
-    ifs.close();
-
-    // 读取模板
-    std::ifstream template_file("assets/html/diary_view.html");
-    std::stringstream tss;
-    tss << template_file.rdbuf();
-    std::string html = tss.str();
-
-    // 替换占位符
-    size_t pos = html.find("{{TITLE}}");
-    if (pos != std::string::npos)
-        html.replace(pos, std::string("{{TITLE}}").length(), first_line);
-
-    pos = html.find("{{TITLE}}");
-    if (pos != std::string::npos)
-        html.replace(pos, std::string("{{TITLE}}").length(), first_line);
-
-    pos = html.find("{{CONTENT}}");
-    if (pos != std::string::npos)
-        html.replace(pos, std::string("{{CONTENT}}").length(), content);
+    size_t eol = text.find('\n');
+    std::string first_line = text.substr(0, eol);  // 第一行作为标题
+    std::string content = eol == std::string::npos ? std::string() : text.substr(eol + 1); // 剩余部分作为正文
+
+    std::string html = page.render({ { "TITLE", first_line }, { "CONTENT", content } });
 
     LOG_DEBUG(std::format("html: {}", html));
 
@@ -234,32 +334,34 @@ void handlerViewDiary(const HttpRequest& req, HttpResponse& res)
 
 void handlerDeleteDiary(const HttpRequest& req, HttpResponse& res)
 {
-    // URL 形式: /delete/filename
-    std::string path = req.path; // "/delete/2025-08-18_title"
-    std::string filename = path.substr(std::string("/delete/").size());
-
-    std::string diaries_path = "diaries";
-#ifdef DIARIES_PATH
-    diaries_path = DIARIES_PATH;
-#endif
-    std::filesystem::path file_path = std::filesystem::path(diaries_path) / filename;
+    // URL 形式: /delete/:name
+    std::string filename(req.param("name"));
 
-    if (std::filesystem::exists(file_path))
+    if (!DiaryIndex::getInstance().store().remove(filename))
     {
-        std::filesystem::remove(file_path);
+        res.setStatus(HttpStatus::NotFound);
+        res.setBody("日记不存在");
+        return;
     }
+    DiaryIndex::getInstance().remove(filename);
 
     // 重定向回首页
     res.setStatus(HttpStatus::Found);
-    res.headers["Location"] = "/";
+    res.setHeader(HttpHeader::Location, "/");
     res.setBody("");
+    respondWhenDurable(res, {}, [](HttpResponse& res)
+        {
+            res.setStatus(HttpStatus::InternalServerError);
+            res.setBody("删除日记失败");
+        });
 }
 
 // 静态对象，程序启动时自动执行构造函数注册路由
 static RouteRegister _reg_home("/", "GET", handlerHome);
+static RouteRegister _reg_diaries("/diaries", "GET", handlerHome);
 static RouteRegister _req_write("/write", "GET", handlerWrite);
-static RouteRegister _req_post_write("/post_write", "POST", handlerPostWrite);
-static RouteRegister _reg_view("/diary", "GET", handlerViewDiary);
-static RouteRegister _reg_delete("/delete", "GET", handlerDeleteDiary);
+static RouteRegister _req_post_write("/post_write", "POST", handlerPostWrite, diaryUploadStream);
+static RouteRegister _reg_view("/diary/:name", "GET", handlerViewDiary);
+static RouteRegister _reg_delete("/delete/:name", "GET", handlerDeleteDiary);
 
 
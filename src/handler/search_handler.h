@@ -0,0 +1,113 @@
+﻿/**
+* @file search_handler.h
+* @brief  全文检索页面
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include <router/router.h>
+#include "search/search_index.h"
+#include "diary/diary_index.h"
+#include "template/html_template.h"
+#include "embed/embedded_assets.h"
+#include <format>
+#include <charconv>
+#include <algorithm>
+
+static_assert(findEmbeddedAsset("html/search.html"), "search page template is missing from src/assets");
+
+std::string escapeHtml(std::string_view text)
+{
+    std::string escaped;
+    escaped.reserve(text.size());
+    for (char c : text)
+    {
+        switch (c)
+        {
+        case '&': escaped += "&amp;"; break;
+        case '<': escaped += "&lt;"; break;
+        case '>': escaped += "&gt;"; break;
+        case '"': escaped += "&quot;"; break;
+        default: escaped += c;
+        }
+    }
+    return escaped;
+}
+
+// 从正文里截一段包含第一个查询词的文字，只对显示出来的几条读文件
+std::string buildSearchSnippet(const std::string& filename, std::string_view query)
+{
+    static constexpr size_t BEFORE = 30;
+    static constexpr size_t AFTER = 120;
+
+    std::string content;
+    DiaryIndex::getInstance().store().read(filename, content);
+    content.erase(0, std::min(content.size(), content.find('\n') + 1));    // 去掉标题行
+
+    // 英文词建索引时转了小写，找位置时也按小写比
+    std::string lower = content;
+    for (char& c : lower)
+    {
+        if (c >= 'A' && c <= 'Z') c = static_cast<char>(c - 'A' + 'a');
+    }
+    size_t hit = std::string::npos;
+    SearchIndex::tokenize(query, SearchIndex::TokenMode::Query, [&](std::string_view term)
+        {
+            hit = std::min(hit, lower.find(term));
+        });
+    if (hit == std::string::npos)
+    {
+        hit = 0;
+    }
+
+    // 前后都退到 UTF-8 字符边界
+    size_t begin = hit > BEFORE ? hit - BEFORE : 0;
+    while (begin > 0 && (static_cast<unsigned char>(content[begin]) & 0xC0) == 0x80) --begin;
+    size_t end = std::min(content.size(), hit + AFTER);
+    while (end < content.size() && (static_cast<unsigned char>(content[end]) & 0xC0) == 0x80) ++end;
+
+    return (begin > 0 ? "…" : "") + escapeHtml(std::string_view(content).substr(begin, end - begin)) +
+        (end < content.size() ? "…" : "");
+}
+
+// GET /search?q=关键词&limit=N
+void handlerSearch(const HttpRequest& req, HttpResponse& res)
+{
+    static constexpr size_t DEFAULT_LIMIT = 20;
+    static constexpr size_t MAX_LIMIT = 100;
+    static HtmlTemplate page("html/search.html");
+
+    std::string query = req.query("q");
+    size_t limit = DEFAULT_LIMIT;
+    std::string limit_text = req.query("limit");
+    if (!limit_text.empty())
+    {
+        auto [ptr, ec] = std::from_chars(limit_text.data(), limit_text.data() + limit_text.size(), limit);
+        if (ec != std::errc() || ptr != limit_text.data() + limit_text.size())
+        {
+            res.setStatus(HttpStatus::BadRequest);
+            res.setBody("limit 应为数字");
+            return;
+        }
+        limit = std::clamp<size_t>(limit, 1, MAX_LIMIT);
+    }
+
+    std::string results;
+    if (!query.empty())
+    {
+        size_t total = 0;
+        std::vector<SearchHit> hits = SearchIndex::getInstance().search(query, limit, total);
+        results = std::format("<p>找到 {} 篇</p>\n<ul>\n", total);
+        for (const SearchHit& hit : hits)
+        {
+            results += std::format("<li><a href=\"/diary/{}\">{}</a> <small>{}</small><p>{}</p></li>\n",
+                hit.filename, escapeHtml(hit.title), escapeHtml(hit.filename), buildSearchSnippet(hit.filename, query));
+        }
+        results += "</ul>\n";
+    }
+
+    res.setBody(page.render({ { "QUERY", escapeHtml(query) }, { "RESULTS", results } }), "text/html");
+    res.setStatus(HttpStatus::OK);
+}
+
+static RouteRegister _reg_search("/search", "GET", handlerSearch);
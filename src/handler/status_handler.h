@@ -0,0 +1,22 @@
+﻿/**
+* @file status_handler.h
+* @brief  运行状态，工作线程池和负载丢弃情况
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include <router/router.h>
+#include <http/http_server.h>
+#include "cache/asset_cache.h"
+#include "search/search_index.h"
+#include "diary/diary_index.h"
+#include "diary/group_commit.h"
+
+void handlerStatus(const HttpRequest& /*req*/, HttpResponse& res)
+{
+    res.setBody(HttpServer::getInstance().statusText() + AssetCache::getInstance().statusText() +
+        DiaryIndex::getInstance().store().statusText() + GroupCommitter::getInstance().statusText() + SearchIndex::getInstance().statusText(), "text/plain");
+    res.setStatus(HttpStatus::OK);
+}
+
+static RouteRegister _reg_status("/status", "GET", handlerStatus);
@@ -0,0 +1,36 @@
+﻿/**
+* @file http_body.h
+* @brief 流式接收请求正文：头部一到就交给处理函数注册的接收器，正文边到边写，不在内存里攒整个正文
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef HTTP_BODY_H
+#define HTTP_BODY_H
+
+#include <functional>
+#include <memory>
+#include <string_view>
+#include "http/http_response_builder.h"
+
+struct HttpRequest;
+
+// 接收器在 IO 线程上调用，正文收完后请求照常交给处理函数，处理函数从 HttpRequest::body_stream 取回它。
+// 连接中途断开或者出错时接收器直接析构，需要自己清理写了一半的东西
+class BodySink
+{
+public:
+	virtual ~BodySink() = default;
+
+	// 收到一段正文，返回 false 时回 errorStatus() 并关闭连接
+	virtual bool write(std::string_view chunk) = 0;
+	// Content-Length 个字节都收到了，返回 false 同上
+	virtual bool finish() = 0;
+
+	virtual HttpStatus errorStatus() const { return HttpStatus::BadRequest; }
+};
+
+// 路由上注册的工厂，头部解析完时按请求创建接收器，返回空表示拒绝（400）
+using BodyStreamFactory = std::function<std::unique_ptr<BodySink>(const HttpRequest&)>;
+
+#endif // !HTTP_BODY_H
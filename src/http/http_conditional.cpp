@@ -0,0 +1,77 @@
+﻿/**
+* @file http_conditional.cpp
+* @brief 条件请求：按 If-None-Match / If-Modified-Since 判断能不能回 304，以及各类资源的缓存策略
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "http_conditional.h"
+#include "comm/http_date.h"
+#include <charconv>
+
+// 弱比较只看引号里的内容，不管 W/ 前缀
+static std::string_view opaqueTag(std::string_view tag)
+{
+	if (tag.starts_with("W/")) tag.remove_prefix(2);
+	return tag;
+}
+
+static bool matchesEtag(std::string_view list, std::string_view etag)
+{
+	std::string_view ours = opaqueTag(etag);
+	while (!list.empty())
+	{
+		size_t comma = list.find(',');
+		std::string_view item = list.substr(0, comma);
+		list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+		while (!item.empty() && (item.front() == ' ' || item.front() == '\t')) item.remove_prefix(1);
+		while (!item.empty() && (item.back() == ' ' || item.back() == '\t')) item.remove_suffix(1);
+		if (item == "*" || (!ours.empty() && opaqueTag(item) == ours))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+std::string makeWeakEtag(std::initializer_list<uint64_t> parts)
+{
+	std::string etag = "W/\"";
+	for (uint64_t part : parts)
+	{
+		if (etag.size() > 3) etag += '-';
+		char buf[16];
+		auto result = std::to_chars(buf, buf + sizeof(buf), part, 16);
+		etag.append(buf, result.ptr);
+	}
+	etag += '"';
+	return etag;
+}
+
+bool isNotModified(const HttpRequest& req, std::string_view etag, time_t last_modified)
+{
+	if (req.headers.has(HttpHeader::IfNoneMatch))
+	{
+		return matchesEtag(req.headers.get(HttpHeader::IfNoneMatch), etag);
+	}
+
+	time_t since = 0;
+	if (last_modified != 0 && req.headers.has(HttpHeader::IfModifiedSince) &&
+		parseHttpDate(req.headers.get(HttpHeader::IfModifiedSince), since))
+	{
+		return last_modified <= since;
+	}
+	return false;
+}
+
+void setNotModified(HttpResponse& res)
+{
+	res.setStatus(HttpStatus::NotModified);
+	res.body.clear();
+	res.file.reset();
+	res.shared = SharedBuffer{};
+	res.headers.erase(HttpHeader::ContentLength);
+	res.headers.erase(HttpHeader::ContentType);
+	res.headers.erase(HttpHeader::ContentEncoding);
+}
@@ -0,0 +1,36 @@
+﻿/**
+* @file http_conditional.h
+* @brief 条件请求：按 If-None-Match / If-Modified-Since 判断能不能回 304，以及各类资源的缓存策略
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef HTTP_CONDITIONAL_H
+#define HTTP_CONDITIONAL_H
+
+#include <string>
+#include <string_view>
+#include <initializer_list>
+#include <cstdint>
+#include <ctime>
+#include "http/http_request_parser.h"
+#include "http/http_response_builder.h"
+
+// Cache-Control 策略
+// 编进程序的资源随版本发布才会变，浏览器可以直接用一段时间，过期后靠 ETag 验证
+constexpr std::string_view CACHE_CONTROL_ASSETS = "public, max-age=3600";
+// 页面和开发模式下的资源随时会变，每次都回来验证，没变就只回 304
+constexpr std::string_view CACHE_CONTROL_REVALIDATE = "no-cache";
+
+// 弱 ETag W/"a-b-c"（十六进制），给按版本号区分的动态页面用：内容等价但不保证逐字节相同
+std::string makeWeakEtag(std::initializer_list<uint64_t> parts);
+
+// 处理函数设置好验证器之后、生成正文之前调用。
+// 按 RFC 9110 的顺序：带了 If-None-Match 就只看它（弱比较，"*" 匹配任何），
+// 否则看 If-Modified-Since；last_modified 为 0 表示没有修改时间
+bool isNotModified(const HttpRequest& req, std::string_view etag, time_t last_modified);
+
+// 改成 304：保留 ETag、Cache-Control、Vary 这些头，不带正文
+void setNotModified(HttpResponse& res);
+
+#endif // !HTTP_CONDITIONAL_H
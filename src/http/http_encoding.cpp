@@ -0,0 +1,41 @@
+﻿/**
+* @file http_encoding.cpp
+* @brief 内容编码协商：动态生成的文本正文超过阈值时按 Accept-Encoding 压缩
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "http_encoding.h"
+#include "comm/gzip.h"
+#include "comm/mime_types.h"
+
+void encodeResponse(const HttpRequest& req, HttpResponse& res)
+{
+	if (res.file || res.shared.owner || res.headers.has(HttpHeader::ContentEncoding))
+	{
+		return;
+	}
+
+	// "text/html; charset=utf-8" 只看分号前面
+	std::string_view type = res.headers.get(HttpHeader::ContentType);
+	type = type.substr(0, type.find(';'));
+	if (res.status != HttpStatus::OK || !isCompressibleMime(type) || !gzipAvailable())
+	{
+		return;
+	}
+	res.setHeader(HttpHeader::Vary, "Accept-Encoding");
+
+	if (res.body.size() < GZIP_MIN_BYTES || !req.acceptsEncoding("gzip"))
+	{
+		return;
+	}
+
+	std::string compressed;
+	if (!gzipCompress(res.body, compressed, GZIP_DYNAMIC_LEVEL) || compressed.size() >= res.body.size())
+	{
+		return;
+	}
+	res.body = std::move(compressed);
+	res.setHeader(HttpHeader::ContentEncoding, "gzip");
+	res.setHeader(HttpHeader::ContentLength, std::to_string(res.body.size()));
+}
@@ -0,0 +1,25 @@
+﻿/**
+* @file http_encoding.h
+* @brief 内容编码协商：动态生成的文本正文超过阈值时按 Accept-Encoding 压缩
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef HTTP_ENCODING_H
+#define HTTP_ENCODING_H
+
+#include "http/http_request_parser.h"
+#include "http/http_response_builder.h"
+
+// 小于这个大小的正文压缩省不了几个字节，不值得花 CPU
+constexpr size_t GZIP_MIN_BYTES = 1024;
+
+// 动态压缩用的等级，页面每次请求都要压，比静态资源的构建期压缩要快一些
+constexpr int GZIP_DYNAMIC_LEVEL = 6;
+
+// 路由之后、构建响应之前调用。只处理内存里的正文（body），
+// 共享内存和文件正文由处理函数自己选预压缩的版本；处理函数已经设置了 Content-Encoding 的不动。
+// 可压缩类型的响应都带上 Vary: Accept-Encoding，让缓存按编码区分
+void encodeResponse(const HttpRequest& req, HttpResponse& res);
+
+#endif // !HTTP_ENCODING_H
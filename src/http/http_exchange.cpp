@@ -0,0 +1,48 @@
+﻿/**
+* @file http_exchange.cpp
+* @brief 一次请求-响应用到的临时对象和它们的分配区
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "http_exchange.h"
+
+HttpExchange::CountingResource HttpExchange::s_upstream;
+std::atomic<uint64_t> HttpExchange::s_exchanges{ 0 };
+std::atomic<uint64_t> HttpExchange::s_heap_allocs{ 0 };
+std::atomic<uint64_t> HttpExchange::s_heap_bytes{ 0 };
+
+void* HttpExchange::CountingResource::do_allocate(size_t bytes, size_t alignment)
+{
+	s_heap_allocs.fetch_add(1, std::memory_order_relaxed);
+	s_heap_bytes.fetch_add(bytes, std::memory_order_relaxed);
+	return std::pmr::new_delete_resource()->allocate(bytes, alignment);
+}
+
+void HttpExchange::CountingResource::do_deallocate(void* p, size_t bytes, size_t alignment)
+{
+	std::pmr::new_delete_resource()->deallocate(p, bytes, alignment);
+}
+
+bool HttpExchange::CountingResource::do_is_equal(const std::pmr::memory_resource& other) const noexcept
+{
+	return this == &other;
+}
+
+HttpExchange::HttpExchange()
+	: m_arena(m_inline, sizeof(m_inline), &s_upstream)
+{
+	m_request.emplace(&m_arena);
+	m_response.emplace(&m_arena);
+}
+
+void HttpExchange::reset()
+{
+	// 容器必须先析构，release 之后它们指向的内存就无效了
+	m_request.reset();
+	m_response.reset();
+	m_arena.release();
+	m_request.emplace(&m_arena);
+	m_response.emplace(&m_arena);
+	s_exchanges.fetch_add(1, std::memory_order_relaxed);
+}
@@ -0,0 +1,64 @@
+﻿/**
+* @file http_exchange.h
+* @brief 一次请求-响应用到的临时对象和它们的分配区
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef HTTP_EXCHANGE_H
+#define HTTP_EXCHANGE_H
+
+#include <memory_resource>
+#include <optional>
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include "http/http_request_parser.h"
+#include "http/http_response_builder.h"
+
+// 每个连接一个。请求和响应里的字符串、容器都从单调分配区里取，
+// 响应序列化进发送缓冲之后调用 reset，一次释放全部内存。
+// 分配区先用内嵌的缓冲，用完才向堆要，正常大小的请求整个过程不碰堆
+class HttpExchange
+{
+public:
+	static constexpr size_t INLINE_ARENA_BYTES = 8 * 1024;
+
+	HttpExchange();
+	~HttpExchange() = default;
+	HttpExchange(const HttpExchange&) = delete;
+	HttpExchange& operator=(const HttpExchange&) = delete;
+
+	HttpRequest& request() { return *m_request; }
+	HttpResponse& response() { return *m_response; }
+
+	// 析构请求和响应，释放分配区，再构造一对空的
+	void reset();
+
+	// 所有连接累计：处理过的请求数，分配区内嵌缓冲不够时向堆申请的次数和字节数
+	static uint64_t exchangeCount() { return s_exchanges.load(std::memory_order_relaxed); }
+	static uint64_t heapAllocCount() { return s_heap_allocs.load(std::memory_order_relaxed); }
+	static uint64_t heapAllocBytes() { return s_heap_bytes.load(std::memory_order_relaxed); }
+
+private:
+	// 分配区的上游，只做计数，实际分配交给默认的 new/delete
+	class CountingResource : public std::pmr::memory_resource
+	{
+	private:
+		void* do_allocate(size_t bytes, size_t alignment) override;
+		void do_deallocate(void* p, size_t bytes, size_t alignment) override;
+		bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override;
+	};
+
+	static CountingResource s_upstream;
+	static std::atomic<uint64_t> s_exchanges;
+	static std::atomic<uint64_t> s_heap_allocs;
+	static std::atomic<uint64_t> s_heap_bytes;
+
+	alignas(std::max_align_t) std::byte m_inline[INLINE_ARENA_BYTES];
+	std::pmr::monotonic_buffer_resource m_arena;
+	std::optional<HttpRequest> m_request;
+	std::optional<HttpResponse> m_response;
+};
+
+#endif // !HTTP_EXCHANGE_H
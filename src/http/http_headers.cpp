@@ -0,0 +1,257 @@
+﻿/**
+* @file http_headers.cpp
+* @brief 请求头、响应头的紧凑存储：常用头部按枚举放在固定槽位，其余放在一个小数组里
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "http_headers.h"
+#include <cstring>
+#include <bit>
+
+static constexpr std::array<std::string_view, static_cast<size_t>(HttpHeader::Count)> HEADER_NAMES = {
+	"Host",
+	"Connection",
+	"Content-Length",
+	"Content-Type",
+	"Transfer-Encoding",
+	"Cookie",
+	"User-Agent",
+	"Accept",
+	"Accept-Encoding",
+	"If-None-Match",
+	"If-Modified-Since",
+	"If-Range",
+	"Range",
+	"Cache-Control",
+	"Location",
+	"Retry-After",
+	"ETag",
+	"Last-Modified",
+	"Content-Encoding",
+	"Content-Range",
+	"Accept-Ranges",
+	"Vary",
+};
+
+static constexpr char toLowerAscii(char c)
+{
+	return (c >= 'A' && c <= 'Z') ? static_cast<char>(c - 'A' + 'a') : c;
+}
+
+bool equalsIgnoreCase(std::string_view a, std::string_view b)
+{
+	if (a.size() != b.size())
+	{
+		return false;
+	}
+	for (size_t i = 0; i < a.size(); ++i)
+	{
+		if (toLowerAscii(a[i]) != toLowerAscii(b[i]))
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+std::string_view headerName(HttpHeader header)
+{
+	return HEADER_NAMES[static_cast<size_t>(header)];
+}
+
+HttpHeader lookupHeader(std::string_view name)
+{
+	// 先比长度和首字母，绝大多数候选在这一步就排除了
+	char first = toLowerAscii(name.empty() ? '\0' : name[0]);
+	for (size_t i = 0; i < HEADER_NAMES.size(); ++i)
+	{
+		std::string_view candidate = HEADER_NAMES[i];
+		if (candidate.size() == name.size() && toLowerAscii(candidate[0]) == first
+			&& equalsIgnoreCase(candidate, name))
+		{
+			return static_cast<HttpHeader>(i);
+		}
+	}
+	return HttpHeader::Count;
+}
+
+HttpHeaders::HttpHeaders(std::pmr::memory_resource* resource)
+	: m_resource(resource), m_other(resource)
+{
+}
+
+HttpHeaders::~HttpHeaders()
+{
+	clear();
+}
+
+std::string_view HttpHeaders::copy(std::string_view s)
+{
+	if (s.empty())
+	{
+		return {};
+	}
+	char* p = static_cast<char*>(m_resource->allocate(s.size(), 1));
+	std::memcpy(p, s.data(), s.size());
+	return std::string_view(p, s.size());
+}
+
+void HttpHeaders::release(std::string_view s)
+{
+	if (!s.empty())
+	{
+		m_resource->deallocate(const_cast<char*>(s.data()), s.size(), 1);
+	}
+}
+
+HttpHeaders::Field* HttpHeaders::findOther(std::string_view name)
+{
+	for (Field& field : m_other)
+	{
+		if (equalsIgnoreCase(field.name, name))
+		{
+			return &field;
+		}
+	}
+	return nullptr;
+}
+
+void HttpHeaders::setView(HttpHeader header, std::string_view value)
+{
+	erase(header);
+	m_known[static_cast<size_t>(header)] = value;
+	m_present |= bit(header);
+}
+
+void HttpHeaders::set(HttpHeader header, std::string_view value)
+{
+	erase(header);
+	m_known[static_cast<size_t>(header)] = copy(value);
+	m_present |= bit(header);
+	m_owned |= bit(header);
+}
+
+void HttpHeaders::setView(std::string_view name, std::string_view value)
+{
+	HttpHeader header = lookupHeader(name);
+	if (header != HttpHeader::Count)
+	{
+		setView(header, value);
+		return;
+	}
+
+	Field* field = findOther(name);
+	if (!field)
+	{
+		m_other.push_back(Field{ name, value, false });
+		return;
+	}
+	if (field->owned)
+	{
+		release(std::string_view(field->name.data(), field->name.size() + field->value.size()));
+	}
+	*field = Field{ name, value, false };
+}
+
+void HttpHeaders::set(std::string_view name, std::string_view value)
+{
+	HttpHeader header = lookupHeader(name);
+	if (header != HttpHeader::Count)
+	{
+		set(header, value);
+		return;
+	}
+
+	// 名字和值拷贝到同一块内存里
+	char* p = static_cast<char*>(m_resource->allocate(name.size() + value.size(), 1));
+	std::memcpy(p, name.data(), name.size());
+	std::memcpy(p + name.size(), value.data(), value.size());
+	Field owned{ std::string_view(p, name.size()), std::string_view(p + name.size(), value.size()), true };
+
+	Field* field = findOther(name);
+	if (!field)
+	{
+		m_other.push_back(owned);
+		return;
+	}
+	if (field->owned)
+	{
+		release(std::string_view(field->name.data(), field->name.size() + field->value.size()));
+	}
+	*field = owned;
+}
+
+std::string_view HttpHeaders::get(std::string_view name) const
+{
+	HttpHeader header = lookupHeader(name);
+	if (header != HttpHeader::Count)
+	{
+		return get(header);
+	}
+	for (const Field& field : m_other)
+	{
+		if (equalsIgnoreCase(field.name, name))
+		{
+			return field.value;
+		}
+	}
+	return {};
+}
+
+bool HttpHeaders::has(std::string_view name) const
+{
+	HttpHeader header = lookupHeader(name);
+	if (header != HttpHeader::Count)
+	{
+		return has(header);
+	}
+	for (const Field& field : m_other)
+	{
+		if (equalsIgnoreCase(field.name, name))
+		{
+			return true;
+		}
+	}
+	return false;
+}
+
+void HttpHeaders::erase(HttpHeader header)
+{
+	size_t index = static_cast<size_t>(header);
+	if (m_owned & bit(header))
+	{
+		release(m_known[index]);
+	}
+	m_known[index] = {};
+	m_present &= ~bit(header);
+	m_owned &= ~bit(header);
+}
+
+void HttpHeaders::clear()
+{
+	for (size_t i = 0; i < m_known.size(); ++i)
+	{
+		if (m_owned & (1u << i))
+		{
+			release(m_known[i]);
+		}
+	}
+	m_known = {};
+	m_present = 0;
+	m_owned = 0;
+
+	for (const Field& field : m_other)
+	{
+		if (field.owned)
+		{
+			release(std::string_view(field.name.data(), field.name.size() + field.value.size()));
+		}
+	}
+	m_other.clear();
+}
+
+size_t HttpHeaders::size() const
+{
+	return static_cast<size_t>(std::popcount(m_present)) + m_other.size();
+}
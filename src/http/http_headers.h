@@ -0,0 +1,121 @@
+﻿/**
+* @file http_headers.h
+* @brief 请求头、响应头的紧凑存储：常用头部按枚举放在固定槽位，其余放在一个小数组里
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef HTTP_HEADERS_H
+#define HTTP_HEADERS_H
+
+#include <array>
+#include <string_view>
+#include <vector>
+#include <memory_resource>
+#include <cstdint>
+
+// 服务端会读或写的头部，取值直接用作数组下标
+enum class HttpHeader : uint8_t
+{
+	Host,
+	Connection,
+	ContentLength,
+	ContentType,
+	TransferEncoding,
+	Cookie,
+	UserAgent,
+	Accept,
+	AcceptEncoding,
+	IfNoneMatch,
+	IfModifiedSince,
+	IfRange,
+	Range,
+	CacheControl,
+	Location,
+	RetryAfter,
+	ETag,
+	LastModified,
+	ContentEncoding,
+	ContentRange,
+	AcceptRanges,
+	Vary,
+
+	Count	// 不是头部，表示未知
+};
+
+// 头部的规范写法，构造响应时按它输出
+std::string_view headerName(HttpHeader header);
+
+// 按名字查枚举，不区分大小写，不认识的返回 HttpHeader::Count
+HttpHeader lookupHeader(std::string_view name);
+
+// ASCII 范围内不区分大小写的比较
+bool equalsIgnoreCase(std::string_view a, std::string_view b);
+
+// 头部名不区分大小写，同名头部后设置的覆盖先设置的。
+// setView 只记下 string_view，调用方保证它比 HttpHeaders 活得久（比如请求头指向请求原文）；
+// set 把名字和值拷贝到构造时给的内存资源里，一般是连接上的分配区
+class HttpHeaders
+{
+public:
+	explicit HttpHeaders(std::pmr::memory_resource* resource = std::pmr::get_default_resource());
+	~HttpHeaders();
+	HttpHeaders(const HttpHeaders&) = delete;
+	HttpHeaders& operator=(const HttpHeaders&) = delete;
+
+	void setView(HttpHeader header, std::string_view value);
+	void setView(std::string_view name, std::string_view value);
+	void set(HttpHeader header, std::string_view value);
+	void set(std::string_view name, std::string_view value);
+
+	bool has(HttpHeader header) const { return m_present & bit(header); }
+	// 不存在时返回空
+	std::string_view get(HttpHeader header) const { return m_known[static_cast<size_t>(header)]; }
+	std::string_view get(std::string_view name) const;
+	bool has(std::string_view name) const;
+
+	void erase(HttpHeader header);
+	void clear();
+	size_t size() const;
+
+	// 按 f(name, value) 依次访问所有头部
+	template <typename F>
+	void forEach(F&& f) const
+	{
+		for (size_t i = 0; i < m_known.size(); ++i)
+		{
+			if (m_present & (1u << i))
+			{
+				f(headerName(static_cast<HttpHeader>(i)), m_known[i]);
+			}
+		}
+		for (const Field& field : m_other)
+		{
+			f(field.name, field.value);
+		}
+	}
+
+private:
+	struct Field
+	{
+		std::string_view name;
+		std::string_view value;
+		bool owned = false;	// 名字和值是一整块从 m_resource 分配的
+	};
+
+	static constexpr uint32_t bit(HttpHeader header) { return 1u << static_cast<uint32_t>(header); }
+
+	std::string_view copy(std::string_view s);
+	void release(std::string_view s);
+	Field* findOther(std::string_view name);
+
+	std::pmr::memory_resource* m_resource;
+	std::array<std::string_view, static_cast<size_t>(HttpHeader::Count)> m_known{};
+	uint32_t m_present = 0;
+	uint32_t m_owned = 0;
+	std::pmr::vector<Field> m_other;
+
+	static_assert(static_cast<size_t>(HttpHeader::Count) <= 32, "presence bits are a uint32_t");
+};
+
+#endif // !HTTP_HEADERS_H
@@ -0,0 +1,230 @@
+﻿/**
+* @file http_range.cpp
+* @brief Range 请求：单段直接切片，多段拼成 multipart/byteranges，都不复制正文
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "http_range.h"
+#include "comm/http_date.h"
+#include <charconv>
+#include <chrono>
+#include <string>
+
+static std::string_view trimSpaces(std::string_view s)
+{
+	while (!s.empty() && (s.front() == ' ' || s.front() == '\t')) s.remove_prefix(1);
+	while (!s.empty() && (s.back() == ' ' || s.back() == '\t')) s.remove_suffix(1);
+	return s;
+}
+
+static bool parseNumber(std::string_view text, uint64_t& value)
+{
+	if (text.empty()) return false;
+	auto [ptr, ec] = std::from_chars(text.data(), text.data() + text.size(), value);
+	return ec == std::errc() && ptr == text.data() + text.size();
+}
+
+RangeParse parseRange(std::string_view value, uint64_t size, RangeSet& ranges)
+{
+	ranges.count = 0;
+	value = trimSpaces(value);
+	if (value.size() < 6 || !equalsIgnoreCase(value.substr(0, 6), "bytes="))
+	{
+		return RangeParse::Ignore;
+	}
+	value.remove_prefix(6);
+
+	size_t total = 0;	// 所有段加起来的长度，重叠的段可以让响应比文件大很多倍
+	size_t specs = 0;
+	while (!value.empty())
+	{
+		size_t comma = value.find(',');
+		std::string_view spec = trimSpaces(value.substr(0, comma));
+		value = comma == std::string_view::npos ? std::string_view() : value.substr(comma + 1);
+		if (spec.empty()) continue;		// 规范允许多余的逗号
+		if (++specs > RangeSet::MAX_RANGES) return RangeParse::Ignore;
+
+		size_t dash = spec.find('-');
+		if (dash == std::string_view::npos) return RangeParse::Ignore;
+		std::string_view first_text = spec.substr(0, dash);
+		std::string_view last_text = spec.substr(dash + 1);
+
+		ByteRange range;
+		if (first_text.empty())
+		{
+			// "-500"：最后 500 个字节
+			uint64_t suffix = 0;
+			if (!parseNumber(last_text, suffix)) return RangeParse::Ignore;
+			if (suffix == 0 || size == 0) continue;
+			range.first = suffix >= size ? 0 : size - suffix;
+			range.last = size - 1;
+		}
+		else
+		{
+			if (!parseNumber(first_text, range.first)) return RangeParse::Ignore;
+			range.last = size == 0 ? 0 : size - 1;
+			if (!last_text.empty())
+			{
+				uint64_t last = 0;
+				if (!parseNumber(last_text, last) || last < range.first) return RangeParse::Ignore;
+				range.last = std::min(range.last, last);
+			}
+			if (range.first >= size) continue;
+		}
+
+		total += range.length();
+		ranges.items[ranges.count++] = range;
+	}
+
+	if (specs == 0) return RangeParse::Ignore;
+	if (ranges.count == 0) return RangeParse::Unsatisfiable;
+	if (total > 2 * size) return RangeParse::Ignore;
+	return RangeParse::Satisfiable;
+}
+
+// If-Range 是 ETag 时要强比较，是日期时要和 Last-Modified 完全一致
+static bool ifRangeMatches(const HttpRequest& req, const HttpResponse& res)
+{
+	if (!req.headers.has(HttpHeader::IfRange))
+	{
+		return true;
+	}
+	std::string_view condition = trimSpaces(req.headers.get(HttpHeader::IfRange));
+	if (condition.starts_with("\"") || condition.starts_with("W/"))
+	{
+		std::string_view etag = res.headers.get(HttpHeader::ETag);
+		return !etag.empty() && !etag.starts_with("W/") && condition == etag;
+	}
+
+	time_t since = 0;
+	time_t modified = 0;
+	return res.headers.has(HttpHeader::LastModified) &&
+		parseHttpDate(condition, since) &&
+		parseHttpDate(res.headers.get(HttpHeader::LastModified), modified) &&
+		since == modified;
+}
+
+static void appendContentRange(std::string& out, const ByteRange& range, uint64_t size)
+{
+	char buf[64];
+	char* p = buf;
+	p = std::to_chars(p, buf + sizeof(buf), range.first).ptr;
+	*p++ = '-';
+	p = std::to_chars(p, buf + sizeof(buf), range.last).ptr;
+	*p++ = '/';
+	p = std::to_chars(p, buf + sizeof(buf), size).ptr;
+	out += "bytes ";
+	out.append(buf, p);
+}
+
+// 分隔符在进程内固定，取启动时间，碰巧出现在文件内容里的可能可以忽略
+static std::string_view boundary()
+{
+	static const std::string value = []()
+		{
+			char buf[32];
+			auto seed = static_cast<uint64_t>(std::chrono::steady_clock::now().time_since_epoch().count());
+			auto result = std::to_chars(buf, buf + sizeof(buf), seed ^ 0x9e3779b97f4a7c15ULL, 36);
+			return "footprints_" + std::string(buf, result.ptr);
+		}();
+	return value;
+}
+
+void applyRange(const HttpRequest& req, HttpResponse& res)
+{
+	if (res.status != HttpStatus::OK || (!res.shared.owner && !res.file))
+	{
+		return;
+	}
+	res.setHeader(HttpHeader::AcceptRanges, "bytes");
+
+	if (!req.headers.has(HttpHeader::Range) || req.method != "GET" || !ifRangeMatches(req, res))
+	{
+		return;
+	}
+
+	const uint64_t size = res.file ? res.file->length : res.shared.bytes.size();
+	RangeSet ranges;
+	switch (parseRange(req.headers.get(HttpHeader::Range), size, ranges))
+	{
+	case RangeParse::Ignore:
+		return;
+	case RangeParse::Unsatisfiable:
+	{
+		std::string content_range = "bytes */" + std::to_string(size);
+		res.file.reset();
+		res.shared = SharedBuffer{};
+		res.body.clear();
+		res.headers.erase(HttpHeader::ContentType);
+		res.headers.erase(HttpHeader::ContentEncoding);
+		res.setHeader(HttpHeader::ContentRange, content_range);
+		res.setHeader(HttpHeader::ContentLength, "0");
+		res.setStatus(HttpStatus::RangeNotSatisfiable);
+		return;
+	}
+	case RangeParse::Satisfiable:
+		break;
+	}
+
+	res.setStatus(HttpStatus::PartialContent);
+
+	// 切片：文件区间共用 fd，共享内存共用持有者，都不复制
+	auto appendSlice = [&res](OutputBuffer& out, const ByteRange& range)
+		{
+			if (res.file)
+			{
+				out.appendFile(FileRegion::slice(res.file, static_cast<int64_t>(range.first), range.length()));
+			}
+			else
+			{
+				out.appendShared(SharedBuffer{ res.shared.owner, res.shared.bytes.substr(range.first, range.length()) });
+			}
+		};
+
+	if (ranges.count == 1)
+	{
+		const ByteRange& range = ranges.items[0];
+		std::string content_range;
+		appendContentRange(content_range, range, size);
+		res.setHeader(HttpHeader::ContentRange, content_range);
+		res.setHeader(HttpHeader::ContentLength, std::to_string(range.length()));
+		if (res.file)
+		{
+			res.file = FileRegion::slice(res.file, static_cast<int64_t>(range.first), range.length());
+		}
+		else
+		{
+			res.shared.bytes = res.shared.bytes.substr(range.first, range.length());
+		}
+		return;
+	}
+
+	// 多段：每段前面一小段头部，数据本身是切片
+	std::string content_type(res.headers.get(HttpHeader::ContentType));
+	auto parts = std::make_unique<OutputBuffer>();
+	std::string head;
+	for (size_t i = 0; i < ranges.count; ++i)
+	{
+		head.clear();
+		head += i == 0 ? "--" : "\r\n--";
+		head += boundary();
+		head += "\r\nContent-Type: ";
+		head += content_type;
+		head += "\r\nContent-Range: ";
+		appendContentRange(head, ranges.items[i], size);
+		head += "\r\n\r\n";
+		parts->append(std::string_view(head));
+		appendSlice(*parts, ranges.items[i]);
+	}
+	head = "\r\n--";
+	head += boundary();
+	head += "--\r\n";
+	parts->append(std::string_view(head));
+
+	res.file.reset();
+	res.shared = SharedBuffer{};
+	res.parts = std::move(parts);
+	res.setHeader(HttpHeader::ContentType, "multipart/byteranges; boundary=" + std::string(boundary()));
+	res.setHeader(HttpHeader::ContentLength, std::to_string(res.parts->size()));
+}
@@ -0,0 +1,49 @@
+﻿/**
+* @file http_range.h
+* @brief Range 请求：单段直接切片，多段拼成 multipart/byteranges，都不复制正文
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef HTTP_RANGE_H
+#define HTTP_RANGE_H
+
+#include <array>
+#include <cstdint>
+#include <string_view>
+#include "http/http_request_parser.h"
+#include "http/http_response_builder.h"
+
+// 闭区间 [first, last]
+struct ByteRange
+{
+	uint64_t first = 0;
+	uint64_t last = 0;
+
+	uint64_t length() const { return last - first + 1; }
+};
+
+struct RangeSet
+{
+	// 段数再多就不是正常的断点续传或多线程下载了，直接回整个文件
+	static constexpr size_t MAX_RANGES = 16;
+
+	std::array<ByteRange, MAX_RANGES> items;
+	size_t count = 0;
+};
+
+enum class RangeParse
+{
+	Ignore,			// 没有 Range、格式不对或者段数太多，当作普通请求
+	Satisfiable,	// ranges 里至少有一段
+	Unsatisfiable	// 格式对，但没有一段落在文件里，回 416
+};
+
+// 解析 "bytes=0-99,200-,-500"，按总长 size 截断，落在文件外的段丢掉
+RangeParse parseRange(std::string_view value, uint64_t size, RangeSet& ranges);
+
+// 处理函数设置好完整正文（shared 或 file）和 ETag / Last-Modified 之后调用。
+// 总是加上 Accept-Ranges；请求带了 Range 且 If-Range 对得上时改成 206 或 416，否则不动
+void applyRange(const HttpRequest& req, HttpResponse& res);
+
+#endif // !HTTP_RANGE_H
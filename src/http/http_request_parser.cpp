@@ -6,141 +6,400 @@
 */
 
 #include "http_request_parser.h"
+#include "http_scan.h"
 #include "comm/log.h"
 #include <format>
 #include <algorithm>
-#include <iostream>
-
-std::string urlDecode(const std::string& value)
-{
-    std::string decoded;
-    for (size_t i = 0; i < value.length(); ++i)
-    {
-        if (value[i] == '+')
-        {
-            decoded += ' ';
-        }
-        else if (value[i] == '%' && i + 2 < value.length())
-        {
-            int hex = 0;
-            std::istringstream(value.substr(i + 1, 2)) >> std::hex >> hex;
-            decoded += static_cast<char>(hex);
-            i += 2;
-        }
-        else
-        {
-            decoded += value[i];
-        }
-    }
-
-    return decoded;
-}
-
-std::string HttpRequestParser::trim(const std::string& s)
+#include <charconv>
+
+static int hexValue(char c)
+{
+	if (c >= '0' && c <= '9') return c - '0';
+	if (c >= 'a' && c <= 'f') return c - 'a' + 10;
+	if (c >= 'A' && c <= 'F') return c - 'A' + 10;
+	return -1;
+}
+
+// '+' 解成空格，不合法的 % 转义原样保留
+template <typename String>
+static void decodeInto(std::string_view value, String& decoded)
+{
+	decoded.clear();
+	decoded.reserve(value.size());
+	for (size_t i = 0; i < value.size(); ++i)
+	{
+		if (value[i] == '+')
+		{
+			decoded += ' ';
+		}
+		else if (value[i] == '%' && i + 2 < value.size() && hexValue(value[i + 1]) >= 0 && hexValue(value[i + 2]) >= 0)
+		{
+			decoded += static_cast<char>(hexValue(value[i + 1]) * 16 + hexValue(value[i + 2]));
+			i += 2;
+		}
+		else
+		{
+			decoded += value[i];
+		}
+	}
+}
+
+std::string HttpRequest::query(std::string_view name) const
+{
+	auto it = query_params.find(name);
+	std::string value;
+	if (it != query_params.end())
+	{
+		decodeInto(it->second, value);
+	}
+	return value;
+}
+
+bool HttpRequest::keepAlive() const
+{
+	std::string_view connection = headers.get(HttpHeader::Connection);
+
+	// HTTP/1.1 默认长连接，HTTP/1.0 需要显式 keep-alive
+	if (version == "HTTP/1.1")
+	{
+		return !equalsIgnoreCase(connection, "close");
+	}
+	return equalsIgnoreCase(connection, "keep-alive");
+}
+
+bool HttpRequest::acceptsEncoding(std::string_view coding) const
+{
+	std::string_view list = headers.get(HttpHeader::AcceptEncoding);
+	int wildcard = -1;	// -1 没出现，0 拒绝，1 接受
+	while (!list.empty())
+	{
+		size_t comma = list.find(',');
+		std::string_view item = list.substr(0, comma);
+		list = comma == std::string_view::npos ? std::string_view() : list.substr(comma + 1);
+
+		// 形如 "gzip;q=0.5"，只关心 q 是不是 0
+		size_t semicolon = item.find(';');
+		std::string_view name = item.substr(0, semicolon);
+		while (!name.empty() && (name.front() == ' ' || name.front() == '\t')) name.remove_prefix(1);
+		while (!name.empty() && (name.back() == ' ' || name.back() == '\t')) name.remove_suffix(1);
+
+		bool accepted = true;
+		if (semicolon != std::string_view::npos)
+		{
+			std::string_view params = item.substr(semicolon + 1);
+			size_t q = params.find("q=");
+			if (q != std::string_view::npos)
+			{
+				std::string_view value = params.substr(q + 2);
+				accepted = false;
+				for (char c : value)
+				{
+					if (c >= '1' && c <= '9') { accepted = true; break; }
+					if (c != '0' && c != '.') break;
+				}
+			}
+		}
+
+		if (equalsIgnoreCase(name, coding)) return accepted;
+		if (name == "*") wildcard = accepted ? 1 : 0;
+	}
+	return wildcard == 1;
+}
+
+void HttpRequestParser::urlDecode(std::string_view value, std::pmr::string& decoded)
+{
+	decodeInto(value, decoded);
+}
+
+std::string_view HttpRequestParser::trim(std::string_view s)
 {
 	size_t start = s.find_first_not_of(" \r\n\t");
 	size_t end = s.find_last_not_of(" \r\n\t");
 
-	if (start == std::string::npos || end == std::string::npos)
+	if (start == std::string_view::npos)
 	{
-		return "";
+		return {};
 	}
 
 	return s.substr(start, end - start + 1);
 }
 
-std::unordered_map<std::string, std::string> HttpRequestParser::parseQueryString(const std::string& query)
+void HttpRequestParser::parseQueryString(std::string_view query, std::pmr::unordered_map<std::string_view, std::string_view>& params)
 {
-	std::unordered_map<std::string, std::string> params;
-	std::istringstream iss(query);
-
-	std::string item;
-	while (std::getline(iss, item, '&'))
+	while (!query.empty())
 	{
+		const char* query_end = query.data() + query.size();
+		const char* amp = scanChar(query.data(), query_end, '&');
+		std::string_view item(query.data(), amp - query.data());
+		query = amp == query_end ? std::string_view() : std::string_view(amp + 1, query_end - amp - 1);
+		if (item.empty())
+		{
+			continue;
+		}
+
 		size_t pos = item.find('=');
-		if (pos != std::string::npos)
+		if (pos != std::string_view::npos)
 		{
 			params[item.substr(0, pos)] = item.substr(pos + 1);
 		}
 		else
 		{
-			params[item] = "";
+			params[item] = {};
 		}
 	}
-	return params;
 }
 
-std::unordered_map<std::string, std::string> HttpRequestParser::parseCookies(const std::string& cookie_header)
+void HttpRequestParser::parseCookies(std::string_view cookie_header, std::pmr::unordered_map<std::string_view, std::string_view>& cookies)
 {
-	std::unordered_map<std::string, std::string> cookies;
-	std::istringstream iss(cookie_header);
-
-	std::string item;
-
-	while (std::getline(iss, item, ';'))
+	while (!cookie_header.empty())
 	{
+		const char* header_end = cookie_header.data() + cookie_header.size();
+		const char* semi = scanChar(cookie_header.data(), header_end, ';');
+		std::string_view item(cookie_header.data(), semi - cookie_header.data());
+		cookie_header = semi == header_end ? std::string_view() : std::string_view(semi + 1, header_end - semi - 1);
+
 		size_t pos = item.find('=');
-		if (pos != std::string::npos)
+		if (pos != std::string_view::npos)
 		{
 			cookies[trim(item.substr(0, pos))] = trim(item.substr(pos + 1));
 		}
 	}
-	return cookies;
 }
 
-HttpRequest HttpRequestParser::parse(const std::string& rawRequest)
+HttpRequestParser::Result HttpRequestParser::fail(HttpStatus status)
 {
-	HttpRequest req;
-	std::istringstream iss(rawRequest);
+	m_state = State::Failed;
+	m_error = status;
+	return Result::Error;
+}
 
-	std::string line;
-	if (!std::getline(iss, line))
+HttpRequestParser::Result HttpRequestParser::feed(std::string_view buffer)
+{
+	while (m_state == State::RequestLine || m_state == State::Headers)
 	{
-		LOG_WARN("Failed to read request line");
-		return req;
+		const char* buffer_end = buffer.data() + buffer.size();
+		const char* nl = scanChar(buffer.data() + std::min(m_scan, buffer.size()), buffer_end, '\n');
+		if (nl == buffer_end)
+		{
+			m_scan = buffer.size();
+			if (buffer.size() > MAX_HEADER_BYTES)
+			{
+				return fail(HttpStatus::RequestHeaderFieldsTooLarge);
+			}
+			return Result::Incomplete;
+		}
+
+		size_t line_end = nl - buffer.data();
+		if (line_end + 1 > MAX_HEADER_BYTES)
+		{
+			return fail(HttpStatus::RequestHeaderFieldsTooLarge);
+		}
+
+		size_t begin = m_line_start;
+		size_t end = line_end;
+		if (end > begin && buffer[end - 1] == '\r')
+		{
+			--end;
+		}
+		m_line_start = m_scan = line_end + 1;
+
+		if (m_state == State::RequestLine)
+		{
+			if (begin == end)
+			{
+				continue; // 忽略请求前多余的空行
+			}
+			if (!parseRequestLine(buffer, begin, end))
+			{
+				return Result::Error;
+			}
+			m_state = State::Headers;
+		}
+		else if (begin == end)
+		{
+			m_header_end = m_line_start;
+			m_state = State::Body;
+		}
+		else if (!parseHeaderLine(buffer, begin, end))
+		{
+			return Result::Error;
+		}
 	}
-	line = trim(line);
-	std::istringstream line_iss(line);
-	line_iss >> req.method >> req.path >> req.version;
-	req.path = urlDecode(req.path);
-	LOG_DEBUG(std::format("Parsing HTTP request: {} {} {}", req.method, req.path, req.version));
 
-	size_t qpos = req.path.find('?');
-	if (qpos != std::string::npos)
+	if (m_state == State::Body && buffer.size() >= requestLength())
+	{
+		m_state = State::Done;
+	}
+	else if (m_state == State::Body && !m_headers_reported)
+	{
+		// 头部收完、正文还在路上，只报告一次，之后照常等正文收完
+		m_headers_reported = true;
+		return Result::Headers;
+	}
+
+	switch (m_state)
+	{
+	case State::Done: return Result::Complete;
+	case State::Failed: return Result::Error;
+	default: return Result::Incomplete;
+	}
+}
+
+bool HttpRequestParser::parseRequestLine(std::string_view buffer, size_t begin, size_t end)
+{
+	std::string_view line = buffer.substr(begin, end - begin);
+	const char* line_end = line.data() + line.size();
+	const char* p1 = scanChar(line.data(), line_end, ' ');
+	const char* p2 = p1 == line_end ? line_end : scanChar(p1 + 1, line_end, ' ');
+	size_t sp1 = p1 - line.data();
+	size_t sp2 = p2 - line.data();
+	if (p2 == line_end || sp2 == sp1 + 1 || !isToken(line.data(), p1)
+		|| line.compare(sp2 + 1, 7, "HTTP/1.") != 0)
+	{
+		fail(HttpStatus::BadRequest);
+		return false;
+	}
+
+	uint32_t base = static_cast<uint32_t>(begin);
+	m_method = { base, static_cast<uint32_t>(sp1) };
+	m_target = { static_cast<uint32_t>(base + sp1 + 1), static_cast<uint32_t>(sp2 - sp1 - 1) };
+	m_version = { static_cast<uint32_t>(base + sp2 + 1), static_cast<uint32_t>(line.size() - sp2 - 1) };
+	return true;
+}
+
+bool HttpRequestParser::parseHeaderLine(std::string_view buffer, size_t begin, size_t end)
+{
+	std::string_view line = buffer.substr(begin, end - begin);
+	const char* line_end = line.data() + line.size();
+	const char* colon_pos = scanChar(line.data(), line_end, ':');
+	size_t colon = colon_pos - line.data();
+	if (colon_pos == line_end || !isToken(line.data(), colon_pos))
+	{
+		fail(HttpStatus::BadRequest); // 头部名必须是 token，不能为空，也不能带空白（包括已废弃的折行）
+		return false;
+	}
+	if (m_headers.size() >= MAX_HEADER_COUNT)
 	{
-		req.query_params = parseQueryString(req.path.substr(qpos + 1));
-		req.path = req.path.substr(0, qpos);
+		fail(HttpStatus::RequestHeaderFieldsTooLarge);
+		return false;
 	}
 
-	while (std::getline(iss, line) && !trim(line).empty())
+	std::string_view name = line.substr(0, colon);
+	std::string_view value = trim(line.substr(colon + 1));
+	HttpHeader id = lookupHeader(name);
+
+	if (id == HttpHeader::ContentLength)
 	{
-		line = trim(line);
-		size_t pos = line.find(':');
-		if (pos != std::string::npos)
+		size_t length = 0;
+		auto [ptr, ec] = std::from_chars(value.data(), value.data() + value.size(), length);
+		if (ec == std::errc::result_out_of_range)
+		{
+			fail(HttpStatus::PayloadTooLarge);
+			return false;
+		}
+		if (ec != std::errc() || ptr != value.data() + value.size() || value.empty())
 		{
-			std::string key = trim(line.substr(0, pos));
-			std::string value = trim(line.substr(pos + 1));
-			req.headers[key] = value;
+			fail(HttpStatus::BadRequest);
+			return false;
 		}
+		if (length > m_max_body)
+		{
+			fail(HttpStatus::PayloadTooLarge);
+			return false;
+		}
+		m_content_length = length;
 	}
-
-	auto it = req.headers.find("Cookie");
-	if (it != req.headers.end())
+	else if (id == HttpHeader::TransferEncoding)
 	{
-		req.cookies = parseCookies(it->second);
+		fail(HttpStatus::NotImplemented); // 不支持分块上传
+		return false;
 	}
 
-	it = req.headers.find("Content-Length");
-	if (it != req.headers.end())
+	HeaderSpan header;
+	header.id = id;
+	header.name = { static_cast<uint32_t>(begin), static_cast<uint32_t>(name.size()) };
+	header.value = { static_cast<uint32_t>(value.data() - buffer.data()), static_cast<uint32_t>(value.size()) };
+	m_headers.push_back(header);
+	return true;
+}
+
+void HttpRequestParser::take(std::string& buffer, HttpRequest& req)
+{
+	// 拷进分配区而不是拿走 buffer，连接的读缓冲保留容量，下个请求不用重新分配
+	size_t length = requestLength();
+	fill(buffer, length, req);
+	buffer.erase(0, length);
+	reset();
+}
+
+void HttpRequestParser::takeHeaders(std::string_view buffer, HttpRequest& req) const
+{
+	fill(buffer, m_header_end, req);
+}
+
+size_t HttpRequestParser::detachBody(std::string& buffer)
+{
+	size_t remaining = m_content_length;
+	buffer.erase(0, m_header_end);
+	reset();
+	return remaining;
+}
+
+void HttpRequestParser::fill(std::string_view buffer, size_t length, HttpRequest& req) const
+{
+	req.raw.assign(buffer.data(), length);
+
+	std::string_view raw = req.raw;
+	req.method = m_method.in(raw);
+	req.target = m_target.in(raw);
+	req.version = m_version.in(raw);
+	req.body = raw.substr(m_header_end);
+
+	req.headers.clear();
+	for (const HeaderSpan& header : m_headers)
 	{
-		int content_length = std::stoi(it->second);
-		if (content_length > 0)
+		if (header.id != HttpHeader::Count)
 		{
-			std::string body(content_length, '\0');
-			iss.read(&body[0], content_length);
-			req.body = body;
+			req.headers.setView(header.id, header.value.in(raw));
 		}
+		else
+		{
+			req.headers.setView(header.name.in(raw), header.value.in(raw));
+		}
+	}
+
+	req.query_params.clear();
+	size_t qpos = req.target.find('?');
+	std::string_view path = req.target.substr(0, qpos);
+	if (qpos != std::string_view::npos)
+	{
+		parseQueryString(req.target.substr(qpos + 1), req.query_params);
+	}
+	if (path.find_first_of("%+") != std::string_view::npos)
+	{
+		urlDecode(path, req.path);
+	}
+	else
+	{
+		req.path.assign(path);
 	}
+	LOG_DEBUG(std::format("Parsing HTTP request: {} {} {}", req.method, req.path, req.version));
 
-	return req;
+	req.cookies.clear();
+	if (req.headers.has(HttpHeader::Cookie))
+	{
+		parseCookies(req.headers.get(HttpHeader::Cookie), req.cookies);
+	}
+}
+
+void HttpRequestParser::reset()
+{
+	m_state = State::RequestLine;
+	m_line_start = 0;
+	m_scan = 0;
+	m_header_end = 0;
+	m_content_length = 0;
+	m_headers_reported = false;
+	m_error = HttpStatus::BadRequest;
+	m_headers.clear();
 }
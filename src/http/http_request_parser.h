@@ -9,36 +9,162 @@
 #define HTTP_REQUEST_PARSER_H
 
 #include <string>
+#include <string_view>
 #include <unordered_map>
-#include <sstream>
-#include <algorithm>
+#include <memory_resource>
+#include <vector>
+#include <array>
+#include <cstdint>
+#include "http/http_response_builder.h"
+#include "http/http_headers.h"
+#include "http/http_body.h"
 
+// 路由匹配出的路径参数（/diary/:name 里的 name），定长数组，不分配内存，值指向 HttpRequest::path
+struct RouteParams
+{
+	static constexpr size_t MAX_PARAMS = 8;
+
+	std::array<std::pair<std::string_view, std::string_view>, MAX_PARAMS> items;
+	size_t count = 0;
+
+	// 不存在时返回空
+	std::string_view get(std::string_view name) const
+	{
+		for (size_t i = 0; i < count; ++i)
+		{
+			if (items[i].first == name) return items[i].second;
+		}
+		return {};
+	}
+};
+
+// 请求原文放在 raw 里，其余字段都是指向 raw 的 string_view，所以不能拷贝。
+// 所有容器都从构造时给的内存资源分配，一般是连接上的分配区（见 HttpExchange）
 struct HttpRequest
 {
-	std::string method;
-	std::string path;
-	std::string version;
-	std::unordered_map<std::string, std::string> headers;
-	std::string body;
-	std::unordered_map<std::string, std::string> query_params;
-	std::unordered_map<std::string, std::string> cookies;
+	std::pmr::string raw;
+	std::string_view method;
+	std::string_view target;	// 原始请求目标，包含查询串
+	std::pmr::string path;		// 解码后的路径，不含查询串
+	std::string_view version;
+	HttpHeaders headers;			// 值指向 raw
+	std::string_view body;
+	std::pmr::unordered_map<std::string_view, std::string_view> query_params;
+	std::pmr::unordered_map<std::string_view, std::string_view> cookies;
+	RouteParams params;			// 由 Router 填写
+	std::unique_ptr<BodySink> body_stream;	// 路由要求流式接收时，正文已经写进这里，body 为空
+
+	explicit HttpRequest(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: raw(resource), path(resource), headers(resource), query_params(resource), cookies(resource)
+	{
+	}
+	HttpRequest(const HttpRequest&) = delete;
+	HttpRequest& operator=(const HttpRequest&) = delete;
+
+	// 按 HTTP 版本和 Connection 头判断是否保持连接
+	bool keepAlive() const;
+
+	// 按 Accept-Encoding 判断客户端是否接受某种内容编码（如 "gzip"），q=0 表示拒绝，"*" 匹配其余编码
+	bool acceptsEncoding(std::string_view coding) const;
+
+	std::string_view param(std::string_view name) const { return params.get(name); }
+
+	// 查询参数解码后的值，不存在时返回空。query_params 里存的是原文
+	std::string query(std::string_view name) const;
 };
 
+// 可恢复的增量解析器，每个连接一个。
+// 每次收到数据后用整个未处理的缓冲区调用 feed，解析器记住上次扫描到的位置，
+// 已经看过的字节不会再扫描；缓冲区可以重新分配，内部只保存偏移
 class HttpRequestParser
 {
 public:
+	enum class Result
+	{
+		Incomplete,	// 还需要更多数据
+		Headers,	// 头部收完了，正文还没收完。每个请求最多报告一次，可以选择流式接收正文，也可以继续 feed
+		Complete,	// 缓冲区开头是一个完整请求，长度见 requestLength()
+		Error		// 请求非法或超出限制，应答 errorStatus() 后关闭连接
+	};
+
+	static constexpr size_t MAX_HEADER_BYTES = 16 * 1024;		// 请求行加全部头部
+	static constexpr size_t MAX_HEADER_COUNT = 64;
+	static constexpr size_t MAX_BODY_BYTES = 8 * 1024 * 1024;	// 整个放进内存的正文上限，流式接收的另算
+
 	HttpRequestParser() = default;
 	~HttpRequestParser() = default;
 
-	static HttpRequest parse(const std::string& raw_request);
+	Result feed(std::string_view buffer);
+
+	// Content-Length 超过它直接 413，默认 MAX_BODY_BYTES；允许流式上传时由服务层调大
+	void setMaxBodyBytes(size_t bytes) { m_max_body = bytes; }
+
+	size_t requestLength() const { return m_header_end + m_content_length; }
+	size_t contentLength() const { return m_content_length; }
+	HttpStatus errorStatus() const { return m_error; }
+
+	// Complete 之后，从 buffer 开头取走这个请求：请求字节拷进 req.raw，字段指向它。
+	// 之后解析器回到初始状态，可以继续解析流水线里的下一个请求
+	void take(std::string& buffer, HttpRequest& req);
+
+	// Headers 之后，只把头部拷进 req（body 为空），buffer 和解析状态都不动，
+	// 之后可以接着 feed 等整个请求，或者调用 detachBody 改成流式接收
+	void takeHeaders(std::string_view buffer, HttpRequest& req) const;
+
+	// 从 buffer 去掉头部，解析器回到初始状态，返回还要收多少字节正文，这些字节由调用方直接消费
+	size_t detachBody(std::string& buffer);
 
 private:
+	enum class State
+	{
+		RequestLine,
+		Headers,
+		Body,
+		Done,
+		Failed
+	};
+
+	// 在 raw 中的偏移和长度
+	struct Span
+	{
+		uint32_t offset = 0;
+		uint32_t length = 0;
 
-	static std::string trim(const std::string& s);
-	
-	static std::unordered_map<std::string, std::string> parseQueryString(const std::string& query);
+		std::string_view in(std::string_view raw) const { return raw.substr(offset, length); }
+	};
+
+	struct HeaderSpan
+	{
+		HttpHeader id;	// 不认识的头部是 HttpHeader::Count，按名字存
+		Span name;
+		Span value;
+	};
+
+	Result fail(HttpStatus status);
+	void fill(std::string_view buffer, size_t length, HttpRequest& req) const;
+	bool parseRequestLine(std::string_view buffer, size_t begin, size_t end);
+	bool parseHeaderLine(std::string_view buffer, size_t begin, size_t end);
+	void reset();
+
+	static void urlDecode(std::string_view value, std::pmr::string& decoded);
+	static std::string_view trim(std::string_view s);
+	static void parseQueryString(std::string_view query, std::pmr::unordered_map<std::string_view, std::string_view>& params);
+	static void parseCookies(std::string_view cookie_header, std::pmr::unordered_map<std::string_view, std::string_view>& cookies);
+
+private:
+	State m_state = State::RequestLine;
+	size_t m_line_start = 0;	// 当前行的起始位置
+	size_t m_scan = 0;			// 下次从这里开始找换行
+	size_t m_header_end = 0;	// 空行之后的位置，也就是正文开始的位置
+	size_t m_content_length = 0;
+	size_t m_max_body = MAX_BODY_BYTES;
+	bool m_headers_reported = false;
+	HttpStatus m_error = HttpStatus::BadRequest;
 
-	static std::unordered_map<std::string, std::string> parseCookies(const std::string& cookie_header);
+	Span m_method;
+	Span m_target;
+	Span m_version;
+	std::vector<HeaderSpan> m_headers;
 };
 
 #endif // !HTTP_REQUEST_PARSER_H
@@ -7,25 +7,80 @@
 
 #include "http_response_builder.h"
 #include <format>
+#include <ctime>
 #include <comm/log.h>
 
-std::string HttpResponseBuilder::build(const HttpResponse& res)
+void HttpResponseBuilder::build(HttpResponse& res, OutputBuffer& out, std::string header_buf)
 {
-	std::ostringstream oss;
-	
 	LOG_DEBUG(std::format("Building HTTP response with status: {} {}", toInt(res.status), HttpStatusReason(res.status)));
-	oss << "HTTP/1.1 " << toInt(res.status) << " " << HttpStatusReason(res.status) << "\r\n";
 
-	for (const auto& kv : res.headers)
+	header_buf.clear();
+	header_buf += HttpStatusLine(res.status);
+
+	res.headers.forEach([&header_buf](std::string_view name, std::string_view value)
+		{
+			header_buf += name;
+			header_buf += ": ";
+			header_buf += value;
+			header_buf += "\r\n";
+		});
+
+	header_buf += dateHeader();
+
+	// 204 和 304 没有正文，也不能带 Content-Length 表示正文长度
+	bool bodiless = res.status == HttpStatus::NoContent || res.status == HttpStatus::NotModified;
+	if (!bodiless && !res.headers.has(HttpHeader::ContentLength))
 	{
-		oss << kv.first << ": " << kv.second << "\r\n";
+		size_t length = res.parts ? res.parts->size() : res.file ? res.file->length : res.shared.owner ? res.shared.bytes.size() : res.body.size();
+		header_buf += "Content-Length: "; // 长连接靠它划分响应边界
+		header_buf += std::to_string(length);
+		header_buf += "\r\n";
 	}
 
-	oss << "Connection: close\r\n";
+	header_buf += res.keep_alive ? "Connection: keep-alive\r\n" : "Connection: close\r\n";
+	header_buf += "\r\n";
 
-	oss << "\r\n";
+	// 头部和正文各占一段，发送时用 writev 一次交给内核，不再拼接正文
+	out.append(std::move(header_buf));
+	if (bodiless)
+	{
+		return;
+	}
+	if (res.parts)
+	{
+		out.append(std::move(*res.parts));
+	}
+	else if (res.file)
+	{
+		out.appendFile(std::move(res.file));
+	}
+	else if (res.shared.owner)
+	{
+		out.appendShared(std::move(res.shared));
+	}
+	else if (!res.body.empty())
+	{
+		out.append(std::move(res.body));
+	}
+}
 
-	oss << res.body;
+std::string_view HttpResponseBuilder::dateHeader()
+{
+	thread_local time_t cached_time = 0;
+	thread_local char cached[64] = {};
+	thread_local size_t cached_len = 0;
 
-	return oss.str();
-};
\ No newline at end of file
+	time_t now = time(nullptr);
+	if (now != cached_time)
+	{
+		tm tm_utc{};
+#ifdef _WIN32
+		gmtime_s(&tm_utc, &now);
+#else
+		gmtime_r(&now, &tm_utc);
+#endif
+		cached_len = strftime(cached, sizeof(cached), "Date: %a, %d %b %Y %H:%M:%S GMT\r\n", &tm_utc);
+		cached_time = now;
+	}
+	return std::string_view(cached, cached_len);
+}
@@ -8,22 +8,31 @@
 #ifndef HTTP_RESPONSE_BUILDER_H
 #define HTTP_RESPONSE_BUILDER_H
 
-#include <unordered_map>
+#include <memory_resource>
 #include <string>
-#include <sstream>
+#include <string_view>
+#include <memory>
+#include <functional>
+#include "socket/output_buffer.h"
+#include "http/http_headers.h"
 
 enum class HttpStatus
 {
 	OK					= 200,
 	Created				= 201,
 	NoContent			= 204,
+	PartialContent		= 206,
 
 	Found				= 302,
+	NotModified			= 304,
 
 	BadRequest			= 400,
 	Unauthorized		= 401,
 	Forbidden			= 403,
 	NotFound			= 404,
+	PayloadTooLarge		= 413,
+	RangeNotSatisfiable	= 416,
+	RequestHeaderFieldsTooLarge = 431,
 
 	InternalServerError = 500,
 	NotImplemented		= 501,
@@ -42,10 +51,16 @@ inline std::string HttpStatusReason(HttpStatus status)
 	case HttpStatus::OK: return "OK";
 	case HttpStatus::Created: return "Created";
 	case HttpStatus::NoContent: return "No Content";
+	case HttpStatus::PartialContent: return "Partial Content";
+	case HttpStatus::Found: return "Found";
+	case HttpStatus::NotModified: return "Not Modified";
 	case HttpStatus::BadRequest: return "Bad Request";
 	case HttpStatus::Unauthorized: return "Unauthorized";
 	case HttpStatus::Forbidden: return "Forbidden";
 	case HttpStatus::NotFound: return "Not Found";
+	case HttpStatus::PayloadTooLarge: return "Payload Too Large";
+	case HttpStatus::RangeNotSatisfiable: return "Range Not Satisfiable";
+	case HttpStatus::RequestHeaderFieldsTooLarge: return "Request Header Fields Too Large";
 	case HttpStatus::InternalServerError: return "Internal Server Error";
 	case HttpStatus::NotImplemented: return "Not Implemented";
 	case HttpStatus::BadGateway: return "Bad Gateway";
@@ -54,22 +69,81 @@ inline std::string HttpStatusReason(HttpStatus status)
 	}
 }
 
+// 完整的状态行，编译期就定好，构造响应时直接拷贝
+inline std::string_view HttpStatusLine(HttpStatus status)
+{
+	switch (status) {
+	case HttpStatus::OK: return "HTTP/1.1 200 OK\r\n";
+	case HttpStatus::Created: return "HTTP/1.1 201 Created\r\n";
+	case HttpStatus::NoContent: return "HTTP/1.1 204 No Content\r\n";
+	case HttpStatus::PartialContent: return "HTTP/1.1 206 Partial Content\r\n";
+	case HttpStatus::Found: return "HTTP/1.1 302 Found\r\n";
+	case HttpStatus::NotModified: return "HTTP/1.1 304 Not Modified\r\n";
+	case HttpStatus::BadRequest: return "HTTP/1.1 400 Bad Request\r\n";
+	case HttpStatus::Unauthorized: return "HTTP/1.1 401 Unauthorized\r\n";
+	case HttpStatus::Forbidden: return "HTTP/1.1 403 Forbidden\r\n";
+	case HttpStatus::NotFound: return "HTTP/1.1 404 Not Found\r\n";
+	case HttpStatus::PayloadTooLarge: return "HTTP/1.1 413 Payload Too Large\r\n";
+	case HttpStatus::RangeNotSatisfiable: return "HTTP/1.1 416 Range Not Satisfiable\r\n";
+	case HttpStatus::RequestHeaderFieldsTooLarge: return "HTTP/1.1 431 Request Header Fields Too Large\r\n";
+	case HttpStatus::InternalServerError: return "HTTP/1.1 500 Internal Server Error\r\n";
+	case HttpStatus::NotImplemented: return "HTTP/1.1 501 Not Implemented\r\n";
+	case HttpStatus::BadGateway: return "HTTP/1.1 502 Bad Gateway\r\n";
+	case HttpStatus::ServiceUnavailable: return "HTTP/1.1 503 Service Unavailable\r\n";
+	default: return "HTTP/1.1 500 Internal Server Error\r\n";
+	}
+}
+
 struct HttpResponse
 {
 	HttpStatus status = HttpStatus::OK;
-	std::unordered_map<std::string, std::string> headers;
-	std::string body;
+	HttpHeaders headers;	// 和请求共用连接上的分配区，见 HttpExchange
+	std::string body;	// 正文会移动进发送缓冲，比这次请求活得久，所以不放在分配区里
+	std::shared_ptr<FileRegion> file;	// 非空时正文是这段文件，发送时走 sendfile，不读进内存
+	SharedBuffer shared;	// 非空时正文是别处持有的内存（比如资源缓存），发送时直接引用
+	std::unique_ptr<OutputBuffer> parts;	// 非空时正文由多段拼成（multipart/byteranges），只有这种响应才分配
+	bool keep_alive = false;	// 由服务层根据请求设置，决定 Connection 头
+	// 响应要等别的线程做完一件事才能发出时由处理函数设置（比如写日记要等组提交落盘）。
+	// 服务层不马上发送，而是调用 defer(resume)；事情做完后在任意线程调用 resume()，响应回到连接所在的 reactor 上发出。
+	// 调用 resume 之前还可以改写响应，这期间同一连接上的后续请求排着不处理
+	std::function<void(std::function<void()> resume)> defer;
+
+	explicit HttpResponse(std::pmr::memory_resource* resource = std::pmr::get_default_resource())
+		: headers(resource)
+	{
+	}
+
+	inline void setHeader(std::string_view key, std::string_view value)
+	{
+		headers.set(key, value);
+	}
+
+	inline void setHeader(HttpHeader header, std::string_view value)
+	{
+		headers.set(header, value);
+	}
 
-	inline void setHeader(const std::string& key, const std::string& value)
+	inline void setBody(std::string b, std::string_view contentType = "text/plain")
 	{
-		headers[key] = value;
+		body = std::move(b);
+		setHeader(HttpHeader::ContentType, contentType);
+		setHeader(HttpHeader::ContentLength, std::to_string(body.size()));
 	}
 
-	inline void setBody(const std::string& b, const std::string& contentType = "text/plain")
+	inline void setShared(SharedBuffer buffer, std::string_view contentType)
 	{
-		body = b;
-		headers["Content-Type"] = contentType;
-		headers["Content-Length"] = std::to_string(body.size());
+		body.clear();
+		shared = std::move(buffer);
+		setHeader(HttpHeader::ContentType, contentType);
+		setHeader(HttpHeader::ContentLength, std::to_string(shared.bytes.size()));
+	}
+
+	inline void setFile(std::shared_ptr<FileRegion> f, std::string_view contentType)
+	{
+		body.clear();
+		file = std::move(f);
+		setHeader(HttpHeader::ContentType, contentType);
+		setHeader(HttpHeader::ContentLength, std::to_string(file->length));
 	}
 
 	inline void setStatus(HttpStatus s) 
@@ -81,7 +155,13 @@ struct HttpResponse
 class HttpResponseBuilder
 {
 public:
-	static std::string build(const HttpResponse& res);
+	// 状态行和头部写进 header_buf 单独成一段，正文随后：内存正文移动进来，文件正文只放文件区间。
+	// header_buf 一般传连接发送缓冲回收下来的字符串（OutputBuffer::takeSpare），省掉一次分配
+	static void build(HttpResponse& res, OutputBuffer& out, std::string header_buf = {});
+
+private:
+	// "Date: ...\r\n"，每个线程缓存一份，每秒最多格式化一次
+	static std::string_view dateHeader();
 };
 
 #endif // !HTTP_RESPONSE_BUILDER_H
@@ -0,0 +1,344 @@
+﻿/**
+* @file http_server.cpp
+* @brief  http服务，把 socket 事件循环、请求解析、路由和工作线程池串起来
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "http_server.h"
+#include "http_encoding.h"
+#include "router/router.h"
+#include "comm/log.h"
+#include <format>
+#include <thread>
+
+#ifndef _WIN32
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+// 把当前线程绑定到一个 CPU 上
+static void pinCurrentThread(size_t index)
+{
+#ifndef _WIN32
+    unsigned cpu_count = std::max(1u, std::thread::hardware_concurrency());
+    cpu_set_t cpus;
+    CPU_ZERO(&cpus);
+    CPU_SET(index % cpu_count, &cpus);
+    if (pthread_setaffinity_np(pthread_self(), sizeof(cpus), &cpus) != 0)
+    {
+        LOG_WARN(std::format("Failed to pin reactor {} to cpu {}", index, index % cpu_count));
+    }
+#endif
+}
+
+HttpServer& HttpServer::getInstance()
+{
+    static HttpServer instance;
+    return instance;
+}
+
+bool HttpServer::start(const Config& config)
+{
+    size_t reactors = config.reactors;
+#ifdef _WIN32
+    if (reactors > 1)
+    {
+        LOG_WARN("SO_REUSEPORT is not available on Windows, using a single reactor");
+        reactors = 1;
+    }
+#endif
+
+    for (size_t i = 0; i < reactors; ++i)
+    {
+        auto server = std::make_unique<SocketServer>(config.port, reactors > 1);
+        if (!server->start())
+        {
+            return false;
+        }
+        server->setIdleTimeout(static_cast<int>(config.keepalive_timeout));
+        server->setUseIoUring(config.io_backend == "uring");
+        m_servers.push_back(std::move(server));
+    }
+    m_pin_cpu = config.pin_cpu;
+    m_max_upload = std::max(config.max_upload_mb * 1024 * 1024, HttpRequestParser::MAX_BODY_BYTES);
+    Router::getInstance().freeze();
+
+    if (config.worker_threads > 0)
+    {
+        m_pool = std::make_unique<ThreadPool>(config.worker_threads, config.queue_capacity);
+    }
+    return true;
+}
+
+// 第 0 个 reactor 跑在调用线程上，其余各起一个线程
+bool HttpServer::run()
+{
+    std::vector<std::thread> threads;
+    for (size_t i = 1; i < m_servers.size(); ++i)
+    {
+        threads.emplace_back([this, i]()
+            {
+                if (m_pin_cpu) pinCurrentThread(i);
+                SocketServer* server = m_servers[i].get();
+                server->run([this, server](Connection& conn) { onMessage(server, conn); });
+            });
+    }
+
+    if (m_pin_cpu) pinCurrentThread(0);
+    SocketServer* server = m_servers[0].get();
+    bool ok = server->run([this, server](Connection& conn) { onMessage(server, conn); });
+
+    for (auto& t : threads)
+    {
+        t.join();
+    }
+    return ok;
+}
+
+std::string HttpServer::statusText()
+{
+    std::string text = std::format("reactors: {}\n", m_servers.size());
+    text += std::format("requests: {}\narena heap allocations: {} ({} bytes)\n",
+        HttpExchange::exchangeCount(), HttpExchange::heapAllocCount(), HttpExchange::heapAllocBytes());
+    if (!m_pool)
+    {
+        return text + "workers: 0 (requests handled on the IO thread)\n";
+    }
+
+    return text + std::format("workers: {}\nqueue: {}/{}\ncompleted: {}\nshed: {}\n",
+        m_pool->threadCount(), m_pool->queueSize(), m_pool->queueCapacity(),
+        m_pool->completedCount(), m_pool->rejectedCount());
+}
+
+// 流水线上的请求按顺序处理：同步模式一直处理到读缓冲里没有完整请求或者发送缓冲积压到上限，
+// 线程池模式一次只交出一个，响应回来后 SocketServer 再回调处理下一个
+void HttpServer::onMessage(SocketServer* server, Connection& conn)
+{
+    auto* slot = std::any_cast<std::shared_ptr<HttpSession>>(&conn.context);
+    if (!slot)
+    {
+        slot = &conn.context.emplace<std::shared_ptr<HttpSession>>(std::make_shared<HttpSession>());
+    }
+    std::shared_ptr<HttpSession>& session = *slot;
+    HttpRequestParser* parser = &session->parser;
+    parser->setMaxBodyBytes(m_max_upload);
+
+    while (conn.canProcess())
+    {
+        HttpRequest& request = session->exchange.request();
+        if (session->body_remaining > 0)
+        {
+            // 流式接收：读缓冲里有多少正文就交给接收器多少，交完就丢，不攒整个正文
+            size_t n = std::min(session->body_remaining, conn.read_buf.size());
+            if (n == 0)
+            {
+                return;
+            }
+            BodySink& sink = *request.body_stream;
+            bool ok = sink.write(std::string_view(conn.read_buf.data(), n));
+            conn.read_buf.erase(0, n);
+            session->body_remaining -= n;
+            if (!ok || (session->body_remaining == 0 && !sink.finish()))
+            {
+                session->body_remaining = 0;
+                reject(conn, sink.errorStatus());
+                return;
+            }
+            if (session->body_remaining > 0)
+            {
+                return;
+            }
+        }
+        else
+        {
+            HttpRequestParser::Result result = parser->feed(conn.read_buf);
+            if (result == HttpRequestParser::Result::Incomplete)
+            {
+                return; // 请求还没收完整
+            }
+            if (result == HttpRequestParser::Result::Error)
+            {
+                reject(conn, parser->errorStatus());
+                return;
+            }
+
+            if (result == HttpRequestParser::Result::Headers)
+            {
+                // 头部到了、正文还在路上：路由要流式接收就从这里开始把正文直接交给它
+                parser->takeHeaders(conn.read_buf, request);
+                const BodyStreamFactory* factory = Router::getInstance().bodyStream(request);
+                if (!factory && parser->contentLength() > HttpRequestParser::MAX_BODY_BYTES)
+                {
+                    reject(conn, HttpStatus::PayloadTooLarge);
+                    return;
+                }
+                if (factory && !(request.body_stream = (*factory)(request)))
+                {
+                    reject(conn, HttpStatus::BadRequest);
+                    return;
+                }
+                if (equalsIgnoreCase(request.headers.get("Expect"), "100-continue"))
+                {
+                    conn.output.append(std::string_view("HTTP/1.1 100 Continue\r\n\r\n"));
+                }
+                if (factory)
+                {
+                    session->body_remaining = parser->detachBody(conn.read_buf);
+                }
+                continue;
+            }
+
+            parser->take(conn.read_buf, request);
+
+            // 正文和头部一起到了：流式路由照样走接收器，处理函数只需要一种写法
+            const BodyStreamFactory* factory = Router::getInstance().bodyStream(request);
+            if (!factory && request.body.size() > HttpRequestParser::MAX_BODY_BYTES)
+            {
+                reject(conn, HttpStatus::PayloadTooLarge);
+                return;
+            }
+            if (factory)
+            {
+                request.body_stream = (*factory)(request);
+                BodySink* sink = request.body_stream.get();
+                if (!sink || !sink->write(request.body) || !sink->finish())
+                {
+                    reject(conn, sink ? sink->errorStatus() : HttpStatus::BadRequest);
+                    return;
+                }
+                request.body = {};
+            }
+        }
+
+        if (!m_pool)
+        {
+            if (!handleRequest(session->exchange))
+            {
+                // 响应发出之前流水线上后面的请求不处理，和交给工作线程时一样
+                conn.pending = true;
+                deferResponse(server, conn.fd, conn.id, session);
+                continue;
+            }
+            bool keep_alive = false;
+            conn.output.append(finishResponse(session->exchange, keep_alive, conn.output.takeSpare()));
+            conn.close_after_write = !keep_alive;
+            continue;
+        }
+
+        sock_t fd = conn.fd;
+        uint64_t id = conn.id;
+        // 头部缓冲在 IO 线程从连接上取好再交给工作线程，OutputBuffer 本身不是线程安全的。
+        // 响应回来之前 IO 线程不会再碰这个会话，工作线程可以独占它
+        bool accepted = m_pool->trySubmit([server, fd, id, session,
+            header_buf = conn.output.takeSpare()]() mutable
+            {
+                if (!handleRequest(session->exchange))
+                {
+                    deferResponse(server, fd, id, std::move(session));
+                    return;
+                }
+                bool keep_alive = false;
+                OutputBuffer response = finishResponse(session->exchange, keep_alive, std::move(header_buf));
+                server->post([server, fd, id, keep_alive, response = std::move(response)]() mutable
+                    {
+                        server->sendTo(fd, id, std::move(response), !keep_alive);
+                    });
+            });
+
+        if (accepted)
+        {
+            conn.pending = true;
+        }
+        else
+        {
+            session->exchange.reset();
+            shed(conn);
+        }
+    }
+}
+
+// 请求非法或超出限制，回一个错误响应然后关闭连接，剩下的数据不再解析
+void HttpServer::reject(Connection& conn, HttpStatus status)
+{
+    LOG_WARN(std::format("Rejecting request on socket {}: {} {}", conn.fd, toInt(status), HttpStatusReason(status)));
+
+    HttpResponse res;
+    res.setStatus(status);
+    res.setBody(std::format("{} {}", toInt(status), HttpStatusReason(status)));
+
+    HttpResponseBuilder::build(res, conn.output, conn.output.takeSpare());
+    conn.read_buf.clear();
+    conn.close_after_write = true;
+}
+
+// 工作队列已满，直接回 503，不再排队
+void HttpServer::shed(Connection& conn)
+{
+    uint64_t shed_count = m_pool->rejectedCount();
+    if (shed_count == 1 || shed_count % 1000 == 0)
+    {
+        LOG_WARN(std::format("Work queue full, shedding load (total shed: {})", shed_count));
+    }
+
+    HttpResponse res;
+    res.setStatus(HttpStatus::ServiceUnavailable);
+    res.setHeader(HttpHeader::RetryAfter, "1");
+    res.setBody("503 Service Unavailable");
+
+    HttpResponseBuilder::build(res, conn.output, conn.output.takeSpare());
+    conn.close_after_write = true;
+}
+
+bool HttpServer::handleRequest(HttpExchange& exchange)
+{
+    HttpRequest& query = exchange.request();
+    HttpResponse& res = exchange.response();
+    res.keep_alive = query.keepAlive();
+    try 
+    {
+        if (!Router::getInstance().route(query, res))
+        {
+            res.setStatus(HttpStatus::NotFound);
+            res.setBody("404 Not Found");
+        }
+    } 
+    catch (const std::exception& e) 
+    {
+        LOG_ERROR(std::format("处理请求时发生错误: {}", e.what()));
+        res.defer = nullptr;
+        res.setStatus(HttpStatus::InternalServerError);
+        res.setBody("500 Internal Server Error");
+    }
+    return !res.defer;
+}
+
+void HttpServer::deferResponse(SocketServer* server, sock_t fd, uint64_t id, std::shared_ptr<HttpSession> session)
+{
+    // 先从响应上取下来：resume 之后这个响应就要序列化、重置了
+    auto defer = std::move(session->exchange.response().defer);
+    session->exchange.response().defer = nullptr;
+    // 会话由 resume 带着，连接在等待期间关掉也不会提前析构；响应投递回 reactor 时头部缓冲由那边现取
+    defer([server, fd, id, session = std::move(session)]()
+        {
+            server->post([server, fd, id, session]()
+                {
+                    bool keep_alive = false;
+                    OutputBuffer response = finishResponse(session->exchange, keep_alive);
+                    server->sendTo(fd, id, std::move(response), !keep_alive);
+                });
+        });
+}
+
+OutputBuffer HttpServer::finishResponse(HttpExchange& exchange, bool& keep_alive, std::string header_buf)
+{
+    HttpRequest& query = exchange.request();
+    HttpResponse& res = exchange.response();
+    encodeResponse(query, res);
+
+    keep_alive = res.keep_alive; // 处理函数可以强制关闭连接
+    OutputBuffer out;
+    HttpResponseBuilder::build(res, out, std::move(header_buf));
+    exchange.reset(); // 响应已经序列化进发送缓冲，请求和响应用过的内存一次释放
+    return out;
+}
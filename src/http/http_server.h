@@ -0,0 +1,65 @@
+﻿/**
+* @file http_server.h
+* @brief  http服务，把 socket 事件循环、请求解析、路由和工作线程池串起来
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef HTTP_SERVER_H
+#define HTTP_SERVER_H
+
+#include "socket/socket_server.h"
+#include "http/http_request_parser.h"
+#include "http/http_response_builder.h"
+#include "http/http_exchange.h"
+#include "comm/thread_pool.h"
+#include "comm/config.h"
+#include <memory>
+#include <vector>
+
+// 挂在 Connection::context 上的 HTTP 状态。交给工作线程时连同 shared_ptr 一起带走，
+// 连接在处理期间被关闭也不会提前析构
+struct HttpSession
+{
+    HttpRequestParser parser;
+    HttpExchange exchange;
+    size_t body_remaining = 0;  // 流式接收中还没收到的正文字节数，接收器在 exchange.request().body_stream
+};
+
+class HttpServer
+{
+public:
+    static HttpServer& getInstance();
+
+    bool start(const Config& config);
+    bool run();
+
+    // 运行时状态，纯文本，给 /status 用
+    std::string statusText();
+
+private:
+    HttpServer() = default;
+    ~HttpServer() = default;
+    HttpServer(const HttpServer&) = delete;
+    HttpServer& operator=(const HttpServer&) = delete;
+
+    void onMessage(SocketServer* server, Connection& conn);
+    void shed(Connection& conn);
+    void reject(Connection& conn, HttpStatus status);
+
+    // 路由并调用处理函数，工作线程和 IO 线程都会调用。返回 false 表示处理函数推迟了响应（HttpResponse::defer）
+    static bool handleRequest(HttpExchange& exchange);
+    // 编码、序列化响应并重置 exchange，keep_alive 返回是否保持连接
+    static OutputBuffer finishResponse(HttpExchange& exchange, bool& keep_alive, std::string header_buf = {});
+    // 推迟的响应：交给处理函数安排的异步操作，完成后投递回 server 序列化发出
+    static void deferResponse(SocketServer* server, sock_t fd, uint64_t id, std::shared_ptr<HttpSession> session);
+
+private:
+    // 每个 reactor 一个 SocketServer，各自有监听套接字、epoll 和连接表，互不共享
+    std::vector<std::unique_ptr<SocketServer>> m_servers;
+    std::unique_ptr<ThreadPool> m_pool;     // 为空时在 IO 线程里直接处理
+    bool m_pin_cpu = false;
+    size_t m_max_upload = HttpRequestParser::MAX_BODY_BYTES;  // Content-Length 上限，流式路由用得到
+};
+
+#endif // !HTTP_SERVER_H
@@ -0,0 +1,217 @@
+﻿/**
+* @file multipart_parser.cpp
+* @brief multipart/form-data 增量解析，数据分几次到都行，每个字段的内容边解析边交出去，不整块缓冲
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "multipart_parser.h"
+#include "http/http_headers.h"
+#include <algorithm>
+#include <functional>
+
+// 取 "; key=value" 形式的参数，值可以带引号
+static std::string_view headerParam(std::string_view value, std::string_view key)
+{
+	size_t pos = 0;
+	while ((pos = value.find(';', pos)) != std::string_view::npos)
+	{
+		++pos;
+		while (pos < value.size() && (value[pos] == ' ' || value[pos] == '\t'))
+		{
+			++pos;
+		}
+		size_t eq = value.find('=', pos);
+		if (eq == std::string_view::npos)
+		{
+			return {};
+		}
+		if (!equalsIgnoreCase(value.substr(pos, eq - pos), key))
+		{
+			continue;
+		}
+
+		std::string_view param = value.substr(eq + 1);
+		if (!param.empty() && param[0] == '"')
+		{
+			size_t close = param.find('"', 1);
+			return param.substr(1, close == std::string_view::npos ? std::string_view::npos : close - 1);
+		}
+		return param.substr(0, param.find_first_of("; \t"));
+	}
+	return {};
+}
+
+MultipartParser::MultipartParser(std::string_view boundary)
+{
+	if (boundary.empty() || boundary.size() > MAX_BOUNDARY_BYTES)
+	{
+		m_state = State::Failed;
+		return;
+	}
+	m_delimiter.append("\r\n--").append(boundary);
+	// 第一个分隔符前面没有换行，先垫上一个，所有分隔符就能用同一个模式找
+	m_buffer = "\r\n";
+}
+
+std::string_view MultipartParser::boundaryOf(std::string_view content_type)
+{
+	std::string_view media = content_type.substr(0, content_type.find(';'));
+	while (!media.empty() && (media.back() == ' ' || media.back() == '\t'))
+	{
+		media.remove_suffix(1);
+	}
+	if (!equalsIgnoreCase(media, "multipart/form-data"))
+	{
+		return {};
+	}
+	return headerParam(content_type, "boundary");
+}
+
+size_t MultipartParser::findDelimiter(std::string_view data) const
+{
+	// 分隔符在一次解析里反复找，边界串又比较长，Horspool 每次能跳过好几个字节
+	auto it = std::search(data.begin(), data.end(),
+		std::boyer_moore_horspool_searcher(m_delimiter.begin(), m_delimiter.end()));
+	return it == data.end() ? std::string_view::npos : static_cast<size_t>(it - data.begin());
+}
+
+bool MultipartParser::fail()
+{
+	m_state = State::Failed;
+	m_buffer.clear();
+	return false;
+}
+
+bool MultipartParser::parseHeaders(std::string_view block)
+{
+	m_part = Part();
+	while (!block.empty())
+	{
+		size_t eol = block.find("\r\n");
+		std::string_view line = block.substr(0, eol);
+		block = eol == std::string_view::npos ? std::string_view() : block.substr(eol + 2);
+
+		size_t colon = line.find(':');
+		if (colon == std::string_view::npos)
+		{
+			return false;
+		}
+		std::string_view name = line.substr(0, colon);
+		std::string_view value = line.substr(colon + 1);
+		while (!value.empty() && (value.front() == ' ' || value.front() == '\t'))
+		{
+			value.remove_prefix(1);
+		}
+
+		if (equalsIgnoreCase(name, "Content-Disposition"))
+		{
+			m_part.name = headerParam(value, "name");
+			m_part.filename = headerParam(value, "filename");
+		}
+		else if (equalsIgnoreCase(name, "Content-Type"))
+		{
+			m_part.content_type = value;
+		}
+	}
+	return true;
+}
+
+bool MultipartParser::feed(std::string_view data)
+{
+	if (m_state == State::Failed)
+	{
+		return false;
+	}
+	if (m_state == State::Done)
+	{
+		return true; // 结束标记之后的内容按规定忽略
+	}
+
+	m_buffer.append(data);
+	std::string_view rest = m_buffer;
+	// 分隔符可能被切在两段数据之间，末尾这么多字节先留着等下一段
+	const size_t keep = m_delimiter.size() - 1;
+	bool ok = true;
+
+	while (ok)
+	{
+		if (m_state == State::Preamble || m_state == State::Data)
+		{
+			size_t pos = findDelimiter(rest);
+			if (pos == std::string_view::npos)
+			{
+				size_t safe = rest.size() > keep ? rest.size() - keep : 0;
+				if (m_state == State::Data && safe > 0)
+				{
+					ok = onPartData(rest.substr(0, safe));
+				}
+				rest.remove_prefix(safe);
+				break;
+			}
+			if (m_state == State::Data)
+			{
+				ok = (pos == 0 || onPartData(rest.substr(0, pos))) && onPartEnd();
+			}
+			rest.remove_prefix(pos + m_delimiter.size());
+			m_state = State::AfterDelimiter;
+		}
+		else if (m_state == State::AfterDelimiter)
+		{
+			if (rest.size() < 2)
+			{
+				break;
+			}
+			if (rest.starts_with("--"))
+			{
+				m_state = State::Done;
+				rest = {};
+				break;
+			}
+			// 分隔符和换行之间允许有空白
+			size_t eol = rest.find("\r\n");
+			if (eol == std::string_view::npos)
+			{
+				// 换行可能只到了 '\r'，它不算多余的字符
+				std::string_view blank = rest.ends_with('\r') ? rest.substr(0, rest.size() - 1) : rest;
+				if (blank.find_first_not_of(" \t") != std::string_view::npos)
+				{
+					return fail();
+				}
+				break;
+			}
+			if (rest.substr(0, eol).find_first_not_of(" \t") != std::string_view::npos)
+			{
+				return fail();
+			}
+			rest.remove_prefix(eol + 2);
+			m_state = State::Headers;
+		}
+		else // Headers
+		{
+			size_t end = rest.starts_with("\r\n") ? 0 : rest.find("\r\n\r\n");
+			if (end == std::string_view::npos)
+			{
+				if (rest.size() > MAX_PART_HEADER_BYTES)
+				{
+					return fail();
+				}
+				break;
+			}
+			if (end > MAX_PART_HEADER_BYTES || !parseHeaders(rest.substr(0, end)))
+			{
+				return fail();
+			}
+			rest.remove_prefix(end == 0 ? 2 : end + 4);
+			m_state = State::Data;
+			ok = onPartBegin(m_part);
+		}
+	}
+
+	if (!ok)
+	{
+		return fail();
+	}
+	m_buffer.erase(0, m_buffer.size() - rest.size());
+	return true;
+}
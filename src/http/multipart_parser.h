@@ -0,0 +1,69 @@
+﻿/**
+* @file multipart_parser.h
+* @brief multipart/form-data 增量解析，数据分几次到都行，每个字段的内容边解析边交出去，不整块缓冲
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef MULTIPART_PARSER_H
+#define MULTIPART_PARSER_H
+
+#include <functional>
+#include <string>
+#include <string_view>
+
+// 用法：设置好三个回调，收到一段正文就 feed 一段，全部收完调用 finish 检查是否完整。
+// 回调返回 false 时解析器停下，之后的 feed 都返回 false。
+// 内部只保留跨段的分隔符前缀和还没收完的字段头，内存占用和正文大小无关
+class MultipartParser
+{
+public:
+	static constexpr size_t MAX_BOUNDARY_BYTES = 70;		// RFC 2046 的上限
+	static constexpr size_t MAX_PART_HEADER_BYTES = 8 * 1024;
+
+	struct Part
+	{
+		std::string name;			// Content-Disposition 的 name
+		std::string filename;		// 上传文件时才有
+		std::string content_type;
+	};
+
+	std::function<bool(const Part& part)> onPartBegin;
+	std::function<bool(std::string_view data)> onPartData;	// 同一个字段可能分多次交出
+	std::function<bool()> onPartEnd;
+
+	// boundary 为空或超长时解析器直接处于失败状态
+	explicit MultipartParser(std::string_view boundary);
+	MultipartParser(const MultipartParser&) = delete;
+	MultipartParser& operator=(const MultipartParser&) = delete;
+
+	bool feed(std::string_view data);
+	// 收到结束分隔符了返回 true
+	bool finish() const { return m_state == State::Done; }
+
+	// 从 Content-Type 取 boundary 参数，不是 multipart/form-data 返回空
+	static std::string_view boundaryOf(std::string_view content_type);
+
+private:
+	enum class State
+	{
+		Preamble,		// 第一个分隔符之前，丢掉
+		AfterDelimiter,	// 分隔符后面是 "\r\n" 还是结束标记 "--"
+		Headers,
+		Data,
+		Done,
+		Failed
+	};
+
+	size_t findDelimiter(std::string_view data) const;
+	bool parseHeaders(std::string_view block);
+	bool fail();
+
+private:
+	State m_state = State::Preamble;
+	std::string m_delimiter;	// "\r\n--" + boundary
+	std::string m_buffer;		// 还没处理完的字节
+	Part m_part;
+};
+
+#endif // !MULTIPART_PARSER_H
@@ -1,104 +1,80 @@
 ﻿#include "comm/log.h"
-#include "socket/socket_server.h"
-#include "http/http_request_parser.h"
-#include "http/http_response_builder.h"
+#include "comm/config.h"
+#include "http/http_server.h"
+#include "diary/diary_index.h"
+#include "diary/log_store.h"
+#include "diary/group_commit.h"
+#include "search/search_index.h"
+#include "cache/asset_cache.h"
 #include "router/router.h"
 #include "handler/diaries_handler.h"
+#include "handler/api_handler.h"
 #include "handler/assets_handler.h"
 #include "handler/cube_handler.h"
+#include "handler/search_handler.h"
+#include "handler/status_handler.h"
 
-size_t getContentLengthFromHeader(const std::string& header_str) 
+int main(int argc, char* argv[])
 {
-    size_t pos = header_str.find("Content-Length:");
-    if (pos != std::string::npos) 
+    LOG_LEVEL(LogLevel::LOG_DEBUG);
+
+    Config& config = Config::getInstance();
+    if (!config.parseArgs(argc, argv))
+    {
+        std::cerr << config.usage() << std::endl;
+        return -1;
+    }
+
+    std::string diaries_path = "diaries";
+#ifdef DIARIES_PATH
+    diaries_path = DIARIES_PATH;
+#endif
+    // 日记的增删改（包括在服务器之外改的）都同步到全文索引
+    DiaryIndex::getInstance().setListener([](const std::string& filename, bool removed)
+        {
+            if (removed) SearchIndex::getInstance().remove(filename);
+            else SearchIndex::getInstance().update(filename);
+        });
+    std::unique_ptr<DiaryStore> store;
+#ifndef _WIN32
+    if (config.store == "log")
     {
-        pos += 15; // 跳过 "Content-Length:"
-        // 跳过可能的空格
-        while (pos < header_str.size() && isspace(static_cast<unsigned char>(header_str[pos]))) 
+        auto log_store = std::make_unique<LogDiaryStore>();
+        if (!log_store->open(diaries_path))
         {
-            ++pos;
+            return -1;
         }
-        // 读取数字
-        size_t len = 0;
-        while (pos < header_str.size() && isdigit(static_cast<unsigned char>(header_str[pos]))) 
+        if (config.import_diaries)
         {
-            len = len * 10 + (header_str[pos] - '0');
-            ++pos;
+            log_store->importDirectory(diaries_path);
         }
-        return len;
+        store = std::move(log_store);
     }
-    return 0;
-}
-
-int main()
-{
-    LOG_LEVEL(LogLevel::LOG_DEBUG);
-
-    SocketServer server(8080); // 监听端口
-    if (!server.start())
+    else
+#endif
+    {
+        store = std::make_unique<FileDiaryStore>(diaries_path);
+    }
+    if (!DiaryIndex::getInstance().start(diaries_path, std::move(store)))
     {
         return -1;
     }
+    GroupCommitter::getInstance().start(DiaryIndex::getInstance().store(), std::chrono::microseconds(config.commit_window_us));
+    SearchIndex::getInstance().start(diaries_path, DiaryIndex::getInstance().store());
 
-    while (true)
+    // 默认用编进程序的资源，不依赖工作目录；开发模式才从磁盘读，走缓存
+    if (!config.assets_dir.empty())
     {
-        sock_t client = server.accept();
-        if (client != INVALID_SOCKET)
-        {
-            std::thread([client, &server]()
-                {
-                    std::string request;
-                    char buffer[4096];
-                    int n = 0;
-                    while ((n = server.recvData(client, buffer, sizeof(buffer) - 1)) > 0)
-                    {
-                        buffer[n] = '\0';
-                        request += buffer;
-
-                        auto headers_end = request.find("\r\n\r\n");
-                        if (headers_end != std::string::npos) 
-                        {
-                            std::string header_str = request.substr(0, headers_end);
-                            size_t content_length = getContentLengthFromHeader(header_str);
-
-                            while (request.size() < headers_end + 4 + content_length) 
-                            {
-                                n = server.recvData(client, buffer, sizeof(buffer) - 1);
-                                if (n <= 0) return -1;
-                                buffer[n] = '\0';
-                                request += buffer;
-                            }
-                            break;
-                        }
-                    }
-
-                    auto query =  HttpRequestParser::parse(request);
-
-                    HttpResponse res;
-                    try 
-                    {
-                        if (!Router::getInstance().route(query, res))
-                        {
-                            res.setStatus(HttpStatus::NotFound);
-                            res.setBody("404 Not Found");
-                        }
-                    } 
-                    catch (const std::exception& e) 
-                    {
-                        LOG_ERROR(std::format("处理请求时发生错误: {}", e.what()));
-                        res.setStatus(HttpStatus::InternalServerError);
-                        res.setBody("500 Internal Server Error");
-                    }
-
-                    std::string responseStr = HttpResponseBuilder::build(res);
-                    server.sendAll(client, responseStr.c_str(), responseStr.size());
+        AssetCache::getInstance().start(config.assets_dir, config.asset_cache_mb * 1024 * 1024);
+    }
 
-                    return 0;
-                }).detach();
-        }
+    HttpServer& server = HttpServer::getInstance();
+    if (!server.start(config))
+    {
+        return -1;
     }
 
-    server.stop();
+    server.run();
 
     return 0;
 }
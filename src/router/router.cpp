@@ -1,7 +1,243 @@
 ﻿/**
-* @file router.h
+* @file router.cpp
 * @brief  路由注册
 * @author liushisheng
 * @date 2025-08-15
 */
 
+#include "router.h"
+#include <algorithm>
+
+bool Router::registerRoute(const std::string& method, const std::string& path, Handler handler, BodyStreamFactory body_stream)
+{
+    if (m_frozen)
+    {
+        LOG_ERROR(std::format("Router is frozen, ignoring route: {} {}", method, path));
+        return false;
+    }
+    if (path.empty() || path[0] != '/')
+    {
+        LOG_ERROR(std::format("Route must start with '/': {} {}", method, path));
+        return false;
+    }
+    size_t param_count = std::count(path.begin(), path.end(), ':') + std::count(path.begin(), path.end(), '*');
+    if (param_count > RouteParams::MAX_PARAMS)
+    {
+        LOG_ERROR(std::format("Route has more than {} parameters: {} {}", RouteParams::MAX_PARAMS, method, path));
+        return false;
+    }
+    LOG_INFO(std::format("Registering route: {} {}", method, path));
+
+    Tree* tree = nullptr;
+    for (Tree& t : m_trees)
+    {
+        if (t.method == method) tree = &t;
+    }
+    if (!tree)
+    {
+        m_trees.push_back(Tree{ method, std::make_unique<Node>() });
+        tree = &m_trees.back();
+    }
+
+    Node* node = tree->root.get();
+    std::string_view pattern = path;
+    while (!pattern.empty())
+    {
+        if (pattern[0] == ':')
+        {
+            size_t end = pattern.find('/');
+            std::string_view name = pattern.substr(1, end == std::string_view::npos ? end : end - 1);
+            if (name.empty())
+            {
+                LOG_ERROR(std::format("Route has an unnamed parameter: {} {}", method, path));
+                return false;
+            }
+            if (!node->param)
+            {
+                node->param = std::make_unique<Node>();
+                node->param->param_name = name;
+            }
+            else if (node->param->param_name != name)
+            {
+                LOG_ERROR(std::format("Route parameter :{} conflicts with :{}: {} {}", name, node->param->param_name, method, path));
+                return false;
+            }
+            node = node->param.get();
+            pattern = end == std::string_view::npos ? std::string_view() : pattern.substr(end);
+        }
+        else if (pattern[0] == '*')
+        {
+            std::string_view name = pattern.substr(1);
+            if (name.empty() || name.find('/') != std::string_view::npos)
+            {
+                LOG_ERROR(std::format("Wildcard must be named and come last: {} {}", method, path));
+                return false;
+            }
+            if (!node->wildcard)
+            {
+                node->wildcard = std::make_unique<Node>();
+                node->wildcard->param_name = name;
+            }
+            else if (node->wildcard->param_name != name)
+            {
+                LOG_ERROR(std::format("Route wildcard *{} conflicts with *{}: {} {}", name, node->wildcard->param_name, method, path));
+                return false;
+            }
+            node = node->wildcard.get();
+            pattern = {};
+        }
+        else
+        {
+            size_t end = pattern.find_first_of(":*");
+            node = insertStatic(node, pattern.substr(0, end));
+            pattern = end == std::string_view::npos ? std::string_view() : pattern.substr(end);
+        }
+    }
+
+    if (node->handler)
+    {
+        LOG_WARN(std::format("Route registered twice, replacing: {} {}", method, path));
+    }
+    node->handler = std::move(handler);
+    node->body_stream = std::move(body_stream);
+    return true;
+}
+
+// 把 label 挂到 node 下，和已有子节点有公共前缀时拆开那条边
+Router::Node* Router::insertStatic(Node* node, std::string_view label)
+{
+    while (!label.empty())
+    {
+        size_t index = node->indices.find(label[0]);
+        if (index == std::string::npos)
+        {
+            auto child = std::make_unique<Node>();
+            child->label = label;
+            node->indices += label[0];
+            node->children.push_back(std::move(child));
+            return node->children.back().get();
+        }
+
+        Node* child = node->children[index].get();
+        size_t common = 0;
+        while (common < child->label.size() && common < label.size() && child->label[common] == label[common])
+        {
+            ++common;
+        }
+
+        if (common < child->label.size())
+        {
+            // child 的 label 只有前 common 个字符是共用的，后半截连同它的子树下移一层
+            auto split = std::make_unique<Node>();
+            split->label = child->label.substr(common);
+            split->indices = std::move(child->indices);
+            split->children = std::move(child->children);
+            split->param = std::move(child->param);
+            split->wildcard = std::move(child->wildcard);
+            split->handler = std::move(child->handler);
+            split->body_stream = std::move(child->body_stream);
+
+            child->label.resize(common);
+            child->indices = std::string(1, split->label[0]);
+            child->children.clear();
+            child->children.push_back(std::move(split));
+            child->handler = nullptr;
+            child->body_stream = nullptr;
+        }
+
+        node = child;
+        label = label.substr(common);
+    }
+    return node;
+}
+
+void Router::freeze()
+{
+    m_frozen = true;
+    LOG_INFO(std::format("Router frozen with {} method trees", m_trees.size()));
+}
+
+// node 自己的 label 已经匹配掉了，path 是剩下的部分
+const Router::Node* Router::match(const Node* node, std::string_view path, RouteParams& params) const
+{
+    if (path.empty())
+    {
+        if (node->handler)
+        {
+            return node;
+        }
+        if (node->wildcard && node->wildcard->handler)
+        {
+            params.items[params.count++] = { node->wildcard->param_name, path };
+            return node->wildcard.get();
+        }
+        return nullptr;
+    }
+
+    size_t index = node->indices.find(path[0]);
+    if (index != std::string::npos)
+    {
+        const Node* child = node->children[index].get();
+        if (path.starts_with(child->label))
+        {
+            if (const Node* found = match(child, path.substr(child->label.size()), params))
+            {
+                return found;
+            }
+        }
+    }
+
+    if (node->param)
+    {
+        size_t end = path.find('/');
+        std::string_view segment = path.substr(0, end);
+        if (!segment.empty())
+        {
+            params.items[params.count++] = { node->param->param_name, segment };
+            if (const Node* found = match(node->param.get(), path.substr(segment.size()), params))
+            {
+                return found;
+            }
+            --params.count;
+        }
+    }
+
+    if (node->wildcard && node->wildcard->handler)
+    {
+        params.items[params.count++] = { node->wildcard->param_name, path };
+        return node->wildcard.get();
+    }
+    return nullptr;
+}
+
+const Router::Node* Router::find(HttpRequest& req) const
+{
+    for (const Tree& tree : m_trees)
+    {
+        if (tree.method != req.method)
+        {
+            continue;
+        }
+
+        req.params.count = 0;
+        return match(tree.root.get(), req.path, req.params);
+    }
+    return nullptr;
+}
+
+bool Router::route(HttpRequest& req, HttpResponse& res) const
+{
+    const Node* node = find(req);
+    if (!node)
+    {
+        return false;
+    }
+    node->handler(req, res);
+    return true;
+}
+
+const BodyStreamFactory* Router::bodyStream(HttpRequest& req) const
+{
+    const Node* node = find(req);
+    return node && node->body_stream ? &node->body_stream : nullptr;
+}
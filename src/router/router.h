@@ -10,12 +10,21 @@
 
 #include "http/http_request_parser.h"
 #include "http/http_response_builder.h"
+#include "http/http_body.h"
 #include <functional>
 #include <format>
+#include <memory>
+#include <vector>
 #include "comm/log.h"
 
 using Handler = std::function<void(const HttpRequest&, HttpResponse&)>;
 
+// 按方法分开的压缩前缀树（radix tree）。路由模式支持：
+//   /diary/:name    命名参数，匹配一个路径段（不含 '/'）
+//   /assets/*path   通配，匹配剩下的全部路径（可以为空），只能放在最后
+// 匹配优先级：静态 > 参数 > 通配。路由都在启动时由 RouteRegister 注册，
+// 服务开始前调用 freeze，之后树不再改变，匹配时不分配内存，参数写进 req.params。
+// 注册时可以带一个 BodyStreamFactory，这条路由的正文就不整个缓冲，而是边收边交给它创建的接收器
 class Router
 {
 public:
@@ -25,43 +34,15 @@ public:
         return router;
     }
 
-    inline void registerRoute(const std::string& method, const std::string& path, Handler handler)
-    {
-        LOG_INFO(std::format("Registering route: {} {}", method, path));
-        routes[method + ':' + path] = handler; 
-    }
-
-    inline bool route(const HttpRequest& req, HttpResponse& res) const
-    {
-        std::string key = req.method + ':';
-        std::string path = req.path;
-
-        for (std::string current = path; !current.empty();)
-        {
-            auto it = routes.find(key + current);
-            if(it != routes.end())
-            {
-                it->second(req, res);
-                return true;
-            }
+    bool registerRoute(const std::string& method, const std::string& path, Handler handler, BodyStreamFactory body_stream = {});
 
-            auto pos = current.find_last_of('/');
-            if(pos == std::string::npos || pos == 0)
-            {
-                break;
-            }
-            current = current.substr(0, pos);
-        }
+    // 之后不再接受注册，多个 IO 线程、工作线程可以并发匹配
+    void freeze();
 
-        auto it = routes.find(key + '/');
-        if(it != routes.end())
-        {
-            it->second(req, res);
-            return true;
-        }
+    bool route(HttpRequest& req, HttpResponse& res) const;
 
-        return false;
-    }
+    // 头部解析完时调用：匹配到的路由要流式接收正文就返回它的工厂，否则返回空
+    const BodyStreamFactory* bodyStream(HttpRequest& req) const;
 
 private:
     Router() = default;
@@ -69,16 +50,39 @@ private:
     Router(const Router&) = delete;
     Router& operator=(const Router&) = delete;
 
-    std::unordered_map<std::string, Handler> routes;
+    struct Node
+    {
+        std::string label;                          // 这条边上的静态字符
+        std::string indices;                        // 每个静态子节点 label 的首字符，和 children 一一对应
+        std::vector<std::unique_ptr<Node>> children;
+        std::unique_ptr<Node> param;                // ":name" 子节点
+        std::unique_ptr<Node> wildcard;             // "*name" 子节点
+        std::string param_name;                     // param / wildcard 节点自己的参数名
+        Handler handler;
+        BodyStreamFactory body_stream;
+    };
+
+    struct Tree
+    {
+        std::string method;
+        std::unique_ptr<Node> root;
+    };
+
+    Node* insertStatic(Node* node, std::string_view label);
+    const Node* find(HttpRequest& req) const;
+    const Node* match(const Node* node, std::string_view path, RouteParams& params) const;
+
+    std::vector<Tree> m_trees;
+    bool m_frozen = false;
 };
 
 class RouteRegister
 {
 public:
     RouteRegister(const std::string& path, const std::string& method,
-        std::function<void(const HttpRequest&, HttpResponse&)> handler)
+        std::function<void(const HttpRequest&, HttpResponse&)> handler, BodyStreamFactory body_stream = {})
     {
-        Router::getInstance().registerRoute(method, path, handler);
+        Router::getInstance().registerRoute(method, path, handler, std::move(body_stream));
     }
 };
 
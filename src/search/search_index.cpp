@@ -0,0 +1,785 @@
+﻿/**
+* @file search_index.cpp
+* @brief 日记全文检索：常驻内存的倒排索引，中文按字和相邻两字切分，倒排表差值压缩，定期存盘
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "search_index.h"
+#include "comm/log.h"
+#include <algorithm>
+#include <chrono>
+#include <cmath>
+#include <cstring>
+#include <filesystem>
+#include <format>
+#include <fstream>
+#include <sstream>
+
+static constexpr char INDEX_FILE[] = ".search-index";
+static constexpr char INDEX_MAGIC[] = "FPSEARCH";
+static constexpr uint32_t INDEX_VERSION = 1;
+static constexpr size_t MAX_WORD_BYTES = 64;
+static constexpr auto SAVE_DELAY = std::chrono::seconds(5);
+
+// BM25 的常用参数
+static constexpr double BM25_K1 = 1.2;
+static constexpr double BM25_B = 0.75;
+
+static void putVarint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+static bool getVarint(std::string_view& in, uint64_t& value)
+{
+    value = 0;
+    for (int shift = 0; shift < 64 && !in.empty(); shift += 7)
+    {
+        uint8_t byte = static_cast<uint8_t>(in.front());
+        in.remove_prefix(1);
+        value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+        if (!(byte & 0x80))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+static void putString(std::string& out, std::string_view s)
+{
+    putVarint(out, s.size());
+    out.append(s);
+}
+
+static bool getString(std::string_view& in, std::string& s)
+{
+    uint64_t size = 0;
+    if (!getVarint(in, size) || size > in.size())
+    {
+        return false;
+    }
+    s.assign(in.substr(0, size));
+    in.remove_prefix(size);
+    return true;
+}
+
+// 倒排表逐条解一遍：文档号严格递增且都小于 doc_count，词频不为 0，
+// 最后一条是 last，正好用完全部字节。检索和压缩解码时不再检查，坏文件必须在这里挡住
+static bool validPostings(std::string_view in, uint64_t count, uint64_t last, uint64_t doc_count)
+{
+    // 每条至少两个字节，条数比这还多就不用解了
+    if (count == 0 || count > doc_count || count > in.size() / 2)
+    {
+        return false;
+    }
+    uint64_t doc = 0;
+    for (uint64_t i = 0; i < count; ++i)
+    {
+        uint64_t delta = 0;
+        uint64_t tf = 0;
+        if (!getVarint(in, delta) || !getVarint(in, tf) || tf == 0 || tf > UINT32_MAX)
+        {
+            return false;
+        }
+        // doc 已经小于 doc_count，拿差值和剩下的余量比，加法不会溢出
+        if (i == 0 ? delta >= doc_count : delta == 0 || delta >= doc_count - doc)
+        {
+            return false;
+        }
+        doc = i == 0 ? delta : doc + delta;
+    }
+    return doc == last && in.empty();
+}
+
+// 解出一个 UTF-8 字符，返回字节数；不合法的字节当成单字节的分隔符
+static size_t decodeUtf8(std::string_view text, size_t pos, char32_t& c)
+{
+    unsigned char lead = text[pos];
+    size_t length = lead < 0x80 ? 1 : (lead & 0xE0) == 0xC0 ? 2 : (lead & 0xF0) == 0xE0 ? 3 : (lead & 0xF8) == 0xF0 ? 4 : 0;
+    if (length == 0 || pos + length > text.size())
+    {
+        c = 0xFFFD;
+        return 1;
+    }
+    c = length == 1 ? lead : lead & (0xFF >> (length + 1));
+    for (size_t i = 1; i < length; ++i)
+    {
+        unsigned char next = text[pos + i];
+        if ((next & 0xC0) != 0x80)
+        {
+            c = 0xFFFD;
+            return 1;
+        }
+        c = (c << 6) | (next & 0x3F);
+    }
+    return length;
+}
+
+// 中日韩文字，按字切
+static bool isCjk(char32_t c)
+{
+    return (c >= 0x3040 && c <= 0x30FF)     // 平假名、片假名
+        || (c >= 0x3400 && c <= 0x4DBF)     // 扩展 A
+        || (c >= 0x4E00 && c <= 0x9FFF)     // 基本汉字
+        || (c >= 0xAC00 && c <= 0xD7AF)     // 韩文音节
+        || (c >= 0xF900 && c <= 0xFAFF)     // 兼容汉字
+        || (c >= 0x20000 && c <= 0x2FFFF);  // 扩展 B 以后
+}
+
+// 组成单词的字符：ASCII 字母数字，以及除标点、符号、全角形式以外的其他文字
+static bool isWordChar(char32_t c)
+{
+    if (c < 0x80)
+    {
+        return (c >= '0' && c <= '9') || (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z');
+    }
+    return c != 0xFFFD && c >= 0xC0
+        && !(c >= 0x2000 && c <= 0x2BFF)    // 通用标点、符号、箭头、制表符等
+        && !(c >= 0x3000 && c <= 0x303F)    // 中文标点
+        && !(c >= 0xFE30 && c <= 0xFE4F)
+        && !(c >= 0xFF00 && c <= 0xFFEF);   // 全角标点
+}
+
+SearchIndex& SearchIndex::getInstance()
+{
+    static SearchIndex instance;
+    return instance;
+}
+
+SearchIndex::~SearchIndex()
+{
+    stop();
+}
+
+void SearchIndex::tokenize(std::string_view text, TokenMode mode, const std::function<void(std::string_view)>& emit)
+{
+    std::string word;
+    size_t run_start = 0;       // 当前中文串的起点
+    size_t run_chars = 0;
+    size_t prev = 0;            // 上一个中文字的起点
+    auto endRun = [&](size_t end)
+        {
+            // 查询里单独一个中文字，没有两字词可用，只能按单字找
+            if (mode == TokenMode::Query && run_chars == 1)
+            {
+                emit(text.substr(run_start, end - run_start));
+            }
+            run_chars = 0;
+        };
+    auto endWord = [&]()
+        {
+            if (!word.empty())
+            {
+                emit(word);
+                word.clear();
+            }
+        };
+
+    size_t pos = 0;
+    while (pos < text.size())
+    {
+        char32_t c = 0;
+        size_t length = decodeUtf8(text, pos, c);
+        if (isCjk(c))
+        {
+            endWord();
+            if (mode == TokenMode::Index)
+            {
+                emit(text.substr(pos, length));
+            }
+            if (run_chars > 0)
+            {
+                emit(text.substr(prev, pos + length - prev));
+            }
+            else
+            {
+                run_start = pos;
+            }
+            prev = pos;
+            ++run_chars;
+        }
+        else
+        {
+            endRun(pos);
+            if (isWordChar(c))
+            {
+                if (word.size() + length <= MAX_WORD_BYTES)
+                {
+                    for (size_t i = 0; i < length; ++i)
+                    {
+                        char ch = text[pos + i];
+                        word += ch >= 'A' && ch <= 'Z' ? static_cast<char>(ch - 'A' + 'a') : ch;
+                    }
+                }
+            }
+            else
+            {
+                endWord();
+            }
+        }
+        pos += length;
+    }
+    endRun(pos);
+    endWord();
+}
+
+bool SearchIndex::start(const std::string& directory, const DiaryStore& store)
+{
+    std::vector<std::string> filenames = store.list();
+    {
+        std::unique_lock lock(m_mutex);
+        clearLocked();
+        m_store = &store;
+        m_directory = directory;
+        m_path = (std::filesystem::path(directory) / INDEX_FILE).string();
+
+        std::ifstream ifs(m_path, std::ios::binary);
+        if (ifs)
+        {
+            std::ostringstream oss;
+            oss << ifs.rdbuf();
+            if (!deserialize(oss.str()))
+            {
+                LOG_WARN(std::format("Search index {} is unreadable, rebuilding it", m_path));
+                clearLocked();
+            }
+        }
+    }
+
+    // 保存之后删掉或者在服务器之外改过的日记，按现在的目录补上
+    std::unordered_map<std::string, bool> present;
+    for (const std::string& filename : filenames)
+    {
+        present[filename] = true;
+        update(filename);
+    }
+    std::vector<std::string> stale;
+    {
+        std::shared_lock lock(m_mutex);
+        for (const auto& [filename, id] : m_doc_ids)
+        {
+            if (!present.count(filename))
+            {
+                stale.push_back(filename);
+            }
+        }
+    }
+    for (const std::string& filename : stale)
+    {
+        remove(filename);
+    }
+
+    {
+        std::shared_lock lock(m_mutex);
+        LOG_INFO(std::format("Search index ready: {} diaries, {} terms", m_doc_ids.size(), m_terms.size()));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_save_mutex);
+        m_stopping = false;
+    }
+    m_saver = std::thread(&SearchIndex::saverLoop, this);
+    return true;
+}
+
+void SearchIndex::stop()
+{
+    {
+        std::lock_guard<std::mutex> lock(m_save_mutex);
+        m_stopping = true;
+    }
+    m_save_cv.notify_all();
+    if (m_saver.joinable())
+    {
+        m_saver.join();
+    }
+}
+
+void SearchIndex::saverLoop()
+{
+    std::unique_lock<std::mutex> lock(m_save_mutex);
+    while (true)
+    {
+        m_save_cv.wait(lock, [this]() { return m_dirty || m_stopping; });
+        if (!m_stopping)
+        {
+            // 连着写好几篇时只存一次
+            m_save_cv.wait_for(lock, SAVE_DELAY, [this]() { return m_stopping; });
+        }
+        if (m_dirty)
+        {
+            m_dirty = false;
+            lock.unlock();
+            save();
+            lock.lock();
+        }
+        if (m_stopping)
+        {
+            return;
+        }
+    }
+}
+
+void SearchIndex::update(const std::string& filename)
+{
+    if (filename.empty() || filename[0] == '.')
+    {
+        return;
+    }
+
+    const DiaryStore* store = nullptr;
+    {
+        std::shared_lock lock(m_mutex);
+        store = m_store;
+    }
+    if (!store)
+    {
+        return; // 还没 start，start 时会全部对一遍
+    }
+
+    Document document;
+    document.filename = filename;
+    DiaryStat stat;
+    if (!store->stat(filename, stat))
+    {
+        remove(filename);
+        return;
+    }
+    document.size = stat.size;
+    document.mtime = stat.mtime;
+
+    {
+        std::shared_lock lock(m_mutex);
+        auto it = m_doc_ids.find(filename);
+        if (it != m_doc_ids.end() && m_docs[it->second].mtime == document.mtime && m_docs[it->second].size == document.size)
+        {
+            return;
+        }
+    }
+
+    // 读文件和切词不持锁，检索照常进行
+    std::string text;
+    if (!store->read(filename, text))
+    {
+        return;
+    }
+    std::string_view body = text;
+    size_t eol = body.find('\n');
+    std::string_view title = body.substr(0, eol);
+    body = eol == std::string_view::npos ? std::string_view() : body.substr(eol + 1);
+    document.title = title;
+
+    std::unordered_map<std::string, uint32_t> terms;
+    uint32_t length = 0;
+    tokenize(title, TokenMode::Index, [&](std::string_view term)
+        {
+            terms[std::string(term)] += TITLE_WEIGHT;
+            ++length;
+        });
+    tokenize(body, TokenMode::Index, [&](std::string_view term)
+        {
+            ++terms[std::string(term)];
+            ++length;
+        });
+    document.length = length;
+
+    {
+        std::unique_lock lock(m_mutex);
+        removeLocked(filename);
+        addLocked(std::move(document), terms);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_save_mutex);
+        m_dirty = true;
+    }
+    m_save_cv.notify_all();
+}
+
+void SearchIndex::remove(const std::string& filename)
+{
+    {
+        std::unique_lock lock(m_mutex);
+        if (!m_doc_ids.count(filename))
+        {
+            return;
+        }
+        removeLocked(filename);
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_save_mutex);
+        m_dirty = true;
+    }
+    m_save_cv.notify_all();
+}
+
+void SearchIndex::removeLocked(const std::string& filename)
+{
+    auto it = m_doc_ids.find(filename);
+    if (it == m_doc_ids.end())
+    {
+        return;
+    }
+    // 倒排表里的文档号先留着，检索时跳过，攒多了整体压缩
+    Document& document = m_docs[it->second];
+    document.live = false;
+    m_total_length -= document.length;
+    m_doc_ids.erase(it);
+    ++m_dead;
+
+    if (m_dead > 1024 && m_dead > m_doc_ids.size())
+    {
+        compactLocked();
+    }
+}
+
+void SearchIndex::addLocked(Document document, const std::unordered_map<std::string, uint32_t>& terms)
+{
+    uint32_t id = static_cast<uint32_t>(m_docs.size());
+    for (const auto& [term, tf] : terms)
+    {
+        Postings& postings = m_terms[term];
+        putVarint(postings.bytes, postings.count == 0 ? id : id - postings.last_doc);
+        putVarint(postings.bytes, tf);
+        postings.last_doc = id;
+        ++postings.count;
+    }
+    m_total_length += document.length;
+    m_doc_ids[document.filename] = id;
+    m_docs.push_back(std::move(document));
+}
+
+void SearchIndex::clearLocked()
+{
+    m_docs.clear();
+    m_doc_ids.clear();
+    m_terms.clear();
+    m_total_length = 0;
+    m_dead = 0;
+}
+
+void SearchIndex::compactLocked()
+{
+    // 有效文档重新连续编号，倒排表按新号重新编码，去掉已删除的
+    std::vector<uint32_t> remap(m_docs.size(), UINT32_MAX);
+    std::vector<Document> docs;
+    docs.reserve(m_doc_ids.size());
+    for (uint32_t id = 0; id < m_docs.size(); ++id)
+    {
+        if (m_docs[id].live)
+        {
+            remap[id] = static_cast<uint32_t>(docs.size());
+            m_doc_ids[m_docs[id].filename] = remap[id];
+            docs.push_back(std::move(m_docs[id]));
+        }
+    }
+
+    for (auto it = m_terms.begin(); it != m_terms.end();)
+    {
+        Postings compacted;
+        std::string_view in = it->second.bytes;
+        uint64_t doc = 0;
+        for (uint32_t i = 0; i < it->second.count; ++i)
+        {
+            uint64_t delta = 0;
+            uint64_t tf = 0;
+            getVarint(in, delta);
+            getVarint(in, tf);
+            doc = i == 0 ? delta : doc + delta;
+            uint32_t id = remap[doc];
+            if (id != UINT32_MAX)
+            {
+                putVarint(compacted.bytes, compacted.count == 0 ? id : id - compacted.last_doc);
+                putVarint(compacted.bytes, tf);
+                compacted.last_doc = id;
+                ++compacted.count;
+            }
+        }
+
+        if (compacted.count == 0)
+        {
+            it = m_terms.erase(it);
+        }
+        else
+        {
+            compacted.bytes.shrink_to_fit();
+            it->second = std::move(compacted);
+            ++it;
+        }
+    }
+
+    LOG_INFO(std::format("Search index compacted: {} -> {} documents", m_docs.size(), docs.size()));
+    m_docs = std::move(docs);
+    m_dead = 0;
+}
+
+std::vector<SearchHit> SearchIndex::search(std::string_view query, size_t limit, size_t& total) const
+{
+    total = 0;
+    std::vector<std::string> words;
+    tokenize(query, TokenMode::Query, [&](std::string_view term)
+        {
+            if (words.size() < MAX_QUERY_TERMS && std::find(words.begin(), words.end(), term) == words.end())
+            {
+                words.emplace_back(term);
+            }
+        });
+    if (words.empty())
+    {
+        return {};
+    }
+
+    std::shared_lock lock(m_mutex);
+    std::vector<const Postings*> lists;
+    for (const std::string& word : words)
+    {
+        auto it = m_terms.find(word);
+        if (it == m_terms.end())
+        {
+            return {};
+        }
+        lists.push_back(&it->second);
+    }
+    // 从最短的倒排表开始求交，候选集一开始就最小
+    std::sort(lists.begin(), lists.end(), [](const Postings* a, const Postings* b) { return a->count < b->count; });
+
+    size_t live = m_doc_ids.size();
+    double average = live ? static_cast<double>(m_total_length) / live : 1;
+    std::vector<std::pair<uint32_t, double>> candidates;    // 文档号，累计得分
+    for (size_t n = 0; n < lists.size(); ++n)
+    {
+        const Postings& postings = *lists[n];
+        double idf = std::log(1 + (live - std::min<double>(postings.count, live) + 0.5) / (postings.count + 0.5));
+
+        std::vector<std::pair<uint32_t, double>> next;
+        auto candidate = candidates.begin();
+        std::string_view in = postings.bytes;
+        uint64_t doc = 0;
+        for (uint32_t i = 0; i < postings.count; ++i)
+        {
+            uint64_t delta = 0;
+            uint64_t tf = 0;
+            getVarint(in, delta);
+            getVarint(in, tf);
+            doc = i == 0 ? delta : doc + delta;
+
+            const Document& document = m_docs[doc];
+            if (!document.live)
+            {
+                continue;
+            }
+            double score = 0;
+            if (n > 0)
+            {
+                // 两边都按文档号升序，归并求交
+                while (candidate != candidates.end() && candidate->first < doc)
+                {
+                    ++candidate;
+                }
+                if (candidate == candidates.end())
+                {
+                    break;
+                }
+                if (candidate->first != doc)
+                {
+                    continue;
+                }
+                score = candidate->second;
+            }
+            double norm = BM25_K1 * (1 - BM25_B + BM25_B * document.length / average);
+            score += idf * (tf * (BM25_K1 + 1)) / (tf + norm);
+            next.emplace_back(static_cast<uint32_t>(doc), score);
+        }
+        candidates = std::move(next);
+        if (candidates.empty())
+        {
+            return {};
+        }
+    }
+
+    total = candidates.size();
+    limit = std::min(limit, candidates.size());
+    std::partial_sort(candidates.begin(), candidates.begin() + limit, candidates.end(),
+        [](const auto& a, const auto& b) { return a.second > b.second; });
+
+    std::vector<SearchHit> hits;
+    hits.reserve(limit);
+    for (size_t i = 0; i < limit; ++i)
+    {
+        const Document& document = m_docs[candidates[i].first];
+        hits.push_back({ document.filename, document.title, candidates[i].second });
+    }
+    return hits;
+}
+
+std::string SearchIndex::serialize() const
+{
+    std::string out(INDEX_MAGIC);
+    putVarint(out, INDEX_VERSION);
+
+    // 只存有效文档，顺带压缩掉已删除的文档号
+    std::vector<uint32_t> remap(m_docs.size(), UINT32_MAX);
+    uint32_t next = 0;
+    putVarint(out, m_doc_ids.size());
+    for (uint32_t id = 0; id < m_docs.size(); ++id)
+    {
+        const Document& document = m_docs[id];
+        if (!document.live)
+        {
+            continue;
+        }
+        remap[id] = next++;
+        putString(out, document.filename);
+        putString(out, document.title);
+        putVarint(out, static_cast<uint64_t>(document.mtime));
+        putVarint(out, document.size);
+        putVarint(out, document.length);
+    }
+
+    std::string terms;
+    size_t term_count = 0;
+    for (const auto& [term, postings] : m_terms)
+    {
+        std::string bytes;
+        uint32_t count = 0;
+        uint32_t last = 0;
+        std::string_view in = postings.bytes;
+        uint64_t doc = 0;
+        for (uint32_t i = 0; i < postings.count; ++i)
+        {
+            uint64_t delta = 0;
+            uint64_t tf = 0;
+            getVarint(in, delta);
+            getVarint(in, tf);
+            doc = i == 0 ? delta : doc + delta;
+            if (remap[doc] != UINT32_MAX)
+            {
+                putVarint(bytes, count == 0 ? remap[doc] : remap[doc] - last);
+                putVarint(bytes, tf);
+                last = remap[doc];
+                ++count;
+            }
+        }
+        if (count == 0)
+        {
+            continue;   // 只出现在已删除文档里的词
+        }
+        putString(terms, term);
+        putVarint(terms, count);
+        putVarint(terms, last);
+        putString(terms, bytes);
+        ++term_count;
+    }
+    putVarint(out, term_count);
+    out.append(terms);
+    return out;
+}
+
+bool SearchIndex::deserialize(std::string_view in)
+{
+    uint64_t version = 0;
+    if (!in.starts_with(INDEX_MAGIC))
+    {
+        return false;
+    }
+    in.remove_prefix(std::strlen(INDEX_MAGIC));
+    if (!getVarint(in, version) || version != INDEX_VERSION)
+    {
+        return false;
+    }
+
+    // 每篇文档、每个词至少占 5 个字节，数目比剩下的字节还多的文件不用往下读
+    uint64_t doc_count = 0;
+    if (!getVarint(in, doc_count) || doc_count > in.size() / 5 || doc_count > UINT32_MAX)
+    {
+        return false;
+    }
+    for (uint64_t id = 0; id < doc_count; ++id)
+    {
+        Document document;
+        uint64_t mtime = 0;
+        uint64_t length = 0;
+        if (!getString(in, document.filename) || !getString(in, document.title) ||
+            !getVarint(in, mtime) || !getVarint(in, document.size) || !getVarint(in, length) ||
+            length > UINT32_MAX || !isValidDiaryName(document.filename) || m_doc_ids.count(document.filename))
+        {
+            return false;
+        }
+        document.mtime = static_cast<time_t>(mtime);
+        document.length = static_cast<uint32_t>(length);
+        m_total_length += document.length;
+        m_doc_ids[document.filename] = static_cast<uint32_t>(id);
+        m_docs.push_back(std::move(document));
+    }
+
+    uint64_t term_count = 0;
+    if (!getVarint(in, term_count) || term_count > in.size() / 5)
+    {
+        return false;
+    }
+    for (uint64_t i = 0; i < term_count; ++i)
+    {
+        std::string term;
+        uint64_t count = 0;
+        uint64_t last = 0;
+        Postings postings;
+        if (!getString(in, term) || term.empty() || !getVarint(in, count) || !getVarint(in, last) ||
+            !getString(in, postings.bytes) || !validPostings(postings.bytes, count, last, doc_count))
+        {
+            return false;
+        }
+        postings.count = static_cast<uint32_t>(count);
+        postings.last_doc = static_cast<uint32_t>(last);
+        if (!m_terms.emplace(std::move(term), std::move(postings)).second)
+        {
+            return false;
+        }
+    }
+    return in.empty();
+}
+
+bool SearchIndex::save()
+{
+    std::string data;
+    {
+        std::shared_lock lock(m_mutex);
+        data = serialize();
+    }
+
+    // 先写临时文件再改名，中途崩溃也不会留下半个索引
+    std::string tmp = m_path + ".tmp";
+    {
+        std::ofstream ofs(tmp, std::ios::binary | std::ios::trunc);
+        ofs.write(data.data(), static_cast<std::streamsize>(data.size()));
+        if (!ofs)
+        {
+            LOG_ERROR(std::format("Failed to write search index {}", tmp));
+            return false;
+        }
+    }
+    std::error_code ec;
+    std::filesystem::rename(tmp, m_path, ec);
+    if (ec)
+    {
+        LOG_ERROR(std::format("Failed to save search index {}: {}", m_path, ec.message()));
+        return false;
+    }
+    LOG_DEBUG(std::format("Search index saved, {} bytes", data.size()));
+    return true;
+}
+
+std::string SearchIndex::statusText() const
+{
+    std::shared_lock lock(m_mutex);
+    size_t bytes = 0;
+    for (const auto& [term, postings] : m_terms)
+    {
+        bytes += postings.bytes.size();
+    }
+    return std::format("search index: {} diaries, {} terms, {} posting bytes\n", m_doc_ids.size(), m_terms.size(), bytes);
+}
@@ -0,0 +1,119 @@
+﻿/**
+* @file search_index.h
+* @brief 日记全文检索：常驻内存的倒排索引，中文按字和相邻两字切分，倒排表差值压缩，定期存盘
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef SEARCH_INDEX_H
+#define SEARCH_INDEX_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include <shared_mutex>
+#include <mutex>
+#include <condition_variable>
+#include <thread>
+#include <cstdint>
+#include <ctime>
+#include "diary/diary_store.h"
+
+struct SearchHit
+{
+    std::string filename;
+    std::string title;
+    double score = 0;
+};
+
+// 查询的所有词都出现的日记才算命中，按 BM25 打分，标题里的词权重更高。
+// 每篇日记一个递增的文档号，新增只在倒排表末尾追加；修改是删了再加，删掉的文档号积累多了整体压缩一次。
+// 索引存在日记目录下的 .search-index，重启后只重新切分变过的日记
+class SearchIndex
+{
+public:
+    static constexpr size_t MAX_QUERY_TERMS = 32;
+    static constexpr uint32_t TITLE_WEIGHT = 3;     // 标题里的词按出现这么多次计
+
+    enum class TokenMode
+    {
+        Index,  // 中文每个字和每两个相邻的字都是词，单字也能搜到
+        Query   // 连续的中文只取两字词，短语更准；只有一个字时取单字
+    };
+
+    static SearchIndex& getInstance();
+
+    // 切词：英文数字按单词（转小写），中文、日文、韩文按字；标点和空白是分隔
+    static void tokenize(std::string_view text, TokenMode mode, const std::function<void(std::string_view)>& emit);
+
+    // 读入 directory 下上次保存的索引，再和 store 里现有的日记对一遍，只重新切分修改时间或大小变了的
+    bool start(const std::string& directory, const DiaryStore& store);
+    void stop();
+
+    // 日记新建、修改（内容没变时什么都不做）或删除之后调用
+    void update(const std::string& filename);
+    void remove(const std::string& filename);
+
+    // 返回得分最高的 limit 条，total 是命中总数
+    std::vector<SearchHit> search(std::string_view query, size_t limit, size_t& total) const;
+
+    std::string statusText() const;
+
+private:
+    SearchIndex() = default;
+    ~SearchIndex();
+    SearchIndex(const SearchIndex&) = delete;
+    SearchIndex& operator=(const SearchIndex&) = delete;
+
+    struct Document
+    {
+        std::string filename;
+        std::string title;
+        time_t mtime = 0;
+        uint64_t size = 0;
+        uint32_t length = 0;    // 词数，BM25 按它做长度归一
+        bool live = true;
+    };
+
+    // 文档号升序，每条是 varint(和上一条的文档号差) varint(词频)
+    struct Postings
+    {
+        std::string bytes;
+        uint32_t last_doc = 0;
+        uint32_t count = 0;
+    };
+
+    // 调用方持有写锁
+    void removeLocked(const std::string& filename);
+    void addLocked(Document document, const std::unordered_map<std::string, uint32_t>& terms);
+    void compactLocked();
+    void clearLocked();
+
+    std::string serialize() const;
+    bool deserialize(std::string_view data);
+    bool save();
+    void saverLoop();
+
+private:
+    std::string m_directory;
+    std::string m_path;     // 索引文件
+    const DiaryStore* m_store = nullptr;
+
+    mutable std::shared_mutex m_mutex;  // 检索共享，更新独占
+    std::vector<Document> m_docs;       // 下标就是文档号
+    std::unordered_map<std::string, uint32_t> m_doc_ids;    // 文件名 -> 现在有效的文档号
+    std::unordered_map<std::string, Postings> m_terms;
+    uint64_t m_total_length = 0;        // 有效文档的总词数
+    size_t m_dead = 0;                  // 已删除还占着文档号的文档数
+
+    // 改动后不马上写盘，后台线程攒一会儿再存一次
+    std::mutex m_save_mutex;
+    std::condition_variable m_save_cv;
+    bool m_dirty = false;
+    bool m_stopping = false;
+    std::thread m_saver;
+};
+
+#endif // !SEARCH_INDEX_H
@@ -0,0 +1,196 @@
+﻿/**
+* @file io_uring.cpp
+* @brief io_uring 的最小封装，直接走系统调用，不依赖 liburing
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef _WIN32
+
+#include "io_uring.h"
+#include "comm/log.h"
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/utsname.h>
+#include <unistd.h>
+#include <cstring>
+#include <cstdio>
+#include <cerrno>
+#include <format>
+#include <algorithm>
+
+static int sysSetup(unsigned entries, io_uring_params* params)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, params));
+}
+
+static int sysEnter(int fd, unsigned to_submit, unsigned min_complete, unsigned flags)
+{
+    return static_cast<int>(syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, nullptr, 0));
+}
+
+IoUring::IoUring()
+    : m_ring_fd(-1),
+    m_sq_ptr(MAP_FAILED), m_sq_size(0),
+    m_cq_ptr(MAP_FAILED), m_cq_size(0),
+    m_sqes(nullptr), m_sqes_size(0),
+    m_sq_head(nullptr), m_sq_tail(nullptr), m_sq_array(nullptr),
+    m_sq_mask(0), m_sq_entries(0), m_sqe_tail(0),
+    m_cq_head(nullptr), m_cq_tail(nullptr), m_cq_mask(0), m_cqes(nullptr),
+    m_buffers(nullptr),
+    m_buffer_count(0), m_buffer_size(0), m_buffer_group(0)
+{
+}
+
+IoUring::~IoUring()
+{
+    if (m_buffers) delete[] m_buffers;
+    if (m_sqes) munmap(m_sqes, m_sqes_size);
+    if (m_cq_ptr != MAP_FAILED && m_cq_ptr != m_sq_ptr) munmap(m_cq_ptr, m_cq_size);
+    if (m_sq_ptr != MAP_FAILED) munmap(m_sq_ptr, m_sq_size);
+    if (m_ring_fd >= 0) ::close(m_ring_fd);
+}
+
+bool IoUring::isSupported()
+{
+    utsname name{};
+    if (uname(&name) != 0) return false;
+
+    int major = 0;
+    int minor = 0;
+    if (std::sscanf(name.release, "%d.%d", &major, &minor) != 2) return false;
+    return major > 6 || (major == 6 && minor >= 0);
+}
+
+bool IoUring::init(unsigned entries)
+{
+    io_uring_params params{};
+    m_ring_fd = sysSetup(entries, &params);
+    if (m_ring_fd < 0)
+    {
+        LOG_WARN(std::format("io_uring_setup failed: {}", strerror(errno)));
+        return false;
+    }
+
+    m_sq_size = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+    m_cq_size = params.cq_off.cqes + params.cq_entries * sizeof(io_uring_cqe);
+    bool single_mmap = params.features & IORING_FEAT_SINGLE_MMAP;
+    if (single_mmap)
+    {
+        m_sq_size = m_cq_size = std::max(m_sq_size, m_cq_size);
+    }
+
+    m_sq_ptr = mmap(nullptr, m_sq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQ_RING);
+    if (m_sq_ptr == MAP_FAILED) return false;
+
+    m_cq_ptr = single_mmap ? m_sq_ptr
+        : mmap(nullptr, m_cq_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_CQ_RING);
+    if (m_cq_ptr == MAP_FAILED) return false;
+
+    m_sqes_size = params.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, m_sqes_size, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, m_ring_fd, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) return false;
+    m_sqes = static_cast<io_uring_sqe*>(sqes);
+
+    char* sq = static_cast<char*>(m_sq_ptr);
+    m_sq_head = reinterpret_cast<unsigned*>(sq + params.sq_off.head);
+    m_sq_tail = reinterpret_cast<unsigned*>(sq + params.sq_off.tail);
+    m_sq_array = reinterpret_cast<unsigned*>(sq + params.sq_off.array);
+    m_sq_mask = *reinterpret_cast<unsigned*>(sq + params.sq_off.ring_mask);
+    m_sq_entries = params.sq_entries;
+    m_sqe_tail = *m_sq_tail;
+
+    char* cq = static_cast<char*>(m_cq_ptr);
+    m_cq_head = reinterpret_cast<unsigned*>(cq + params.cq_off.head);
+    m_cq_tail = reinterpret_cast<unsigned*>(cq + params.cq_off.tail);
+    m_cq_mask = *reinterpret_cast<unsigned*>(cq + params.cq_off.ring_mask);
+    m_cqes = reinterpret_cast<io_uring_cqe*>(cq + params.cq_off.cqes);
+
+    LOG_INFO(std::format("io_uring ready: sq {} entries, cq {} entries", params.sq_entries, params.cq_entries));
+    return true;
+}
+
+io_uring_sqe* IoUring::getSqe()
+{
+    unsigned head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+    if (m_sqe_tail - head >= m_sq_entries)
+    {
+        submitAndWait(0);
+        head = __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+        if (m_sqe_tail - head >= m_sq_entries) return nullptr;
+    }
+
+    io_uring_sqe* sqe = &m_sqes[m_sqe_tail & m_sq_mask];
+    std::memset(sqe, 0, sizeof(*sqe));
+    ++m_sqe_tail;
+    return sqe;
+}
+
+int IoUring::submitAndWait(unsigned wait_nr)
+{
+    // 把本地填好的提交项发布到共享的 sq 数组
+    unsigned tail = *m_sq_tail;
+    for (; tail != m_sqe_tail; ++tail)
+    {
+        m_sq_array[tail & m_sq_mask] = tail & m_sq_mask;
+    }
+    __atomic_store_n(m_sq_tail, m_sqe_tail, __ATOMIC_RELEASE);
+
+    unsigned to_submit = m_sqe_tail - __atomic_load_n(m_sq_head, __ATOMIC_ACQUIRE);
+    unsigned flags = wait_nr > 0 ? IORING_ENTER_GETEVENTS : 0;
+    int ret = sysEnter(m_ring_fd, to_submit, wait_nr, flags);
+    if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+    {
+        LOG_ERROR(std::format("io_uring_enter failed: {}", strerror(errno)));
+    }
+    return ret;
+}
+
+bool IoUring::provideBuffers(uint16_t group, unsigned count, unsigned size)
+{
+    m_buffer_group = group;
+    m_buffer_count = count;
+    m_buffer_size = size;
+    m_buffers = new char[static_cast<size_t>(count) * size];
+
+    io_uring_sqe* sqe = getSqe();
+    if (!sqe) return false;
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(count);
+    sqe->addr = reinterpret_cast<uint64_t>(m_buffers);
+    sqe->len = size;
+    sqe->buf_group = group;
+    sqe->off = 0; // 起始 bid
+    sqe->user_data = 0;
+
+    // 同步等这一个完成项，确认内核支持
+    if (submitAndWait(1) < 0) return false;
+    int res = -1;
+    forEachCqe([&res](const io_uring_cqe& cqe) { res = cqe.res; });
+    if (res < 0)
+    {
+        LOG_WARN(std::format("io_uring provide buffers failed: {}", strerror(-res)));
+        return false;
+    }
+    return true;
+}
+
+void IoUring::recycleBuffer(uint16_t bid)
+{
+    io_uring_sqe* sqe = getSqe();
+    if (!sqe)
+    {
+        LOG_ERROR(std::format("io_uring submission queue full, buffer {} lost", bid));
+        return;
+    }
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = 1;
+    sqe->addr = reinterpret_cast<uint64_t>(buffer(bid));
+    sqe->len = m_buffer_size;
+    sqe->buf_group = m_buffer_group;
+    sqe->off = bid;
+    sqe->flags = IOSQE_CQE_SKIP_SUCCESS;
+    sqe->user_data = 0;
+}
+
+#endif // !_WIN32
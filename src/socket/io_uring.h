@@ -0,0 +1,90 @@
+﻿/**
+* @file io_uring.h
+* @brief io_uring 的最小封装，直接走系统调用，不依赖 liburing
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef IO_URING_H
+#define IO_URING_H
+
+#ifndef _WIN32
+
+#include <linux/io_uring.h>
+#include <cstdint>
+#include <cstddef>
+
+class IoUring
+{
+public:
+    IoUring();
+    ~IoUring();
+    IoUring(const IoUring&) = delete;
+    IoUring& operator=(const IoUring&) = delete;
+
+    // 内核是否支持这里用到的特性（多发 accept/recv、跳过成功完成项），要求 6.0 以上
+    static bool isSupported();
+
+    bool init(unsigned entries);
+
+    // 取一个空闲的提交项，队列满时先提交一次
+    io_uring_sqe* getSqe();
+    // 提交所有排队的提交项，并至少等待 wait_nr 个完成项
+    int submitAndWait(unsigned wait_nr);
+
+    // 依次处理所有已到达的完成项
+    template <typename Func>
+    void forEachCqe(Func&& func)
+    {
+        unsigned head = *m_cq_head;
+        unsigned tail = __atomic_load_n(m_cq_tail, __ATOMIC_ACQUIRE);
+        for (; head != tail; ++head)
+        {
+            io_uring_cqe cqe = m_cqes[head & m_cq_mask];
+            __atomic_store_n(m_cq_head, head + 1, __ATOMIC_RELEASE);
+            func(cqe);
+        }
+    }
+
+    // 向内核提供 count 个 size 大小的接收缓冲区（IORING_OP_PROVIDE_BUFFERS），
+    // recv 带 IOSQE_BUFFER_SELECT 时由内核从这组里挑一个
+    bool provideBuffers(uint16_t group, unsigned count, unsigned size);
+    char* buffer(uint16_t bid) const { return m_buffers + static_cast<size_t>(bid) * m_buffer_size; }
+    // 数据取走后把缓冲区还给内核，提交项随下一次 submitAndWait 一起提交，成功时不产生完成项
+    void recycleBuffer(uint16_t bid);
+
+private:
+    int m_ring_fd;
+
+    void* m_sq_ptr;
+    size_t m_sq_size;
+    void* m_cq_ptr;
+    size_t m_cq_size;
+    io_uring_sqe* m_sqes;
+    size_t m_sqes_size;
+
+    unsigned* m_sq_head;
+    unsigned* m_sq_tail;
+    unsigned* m_sq_array;
+    unsigned m_sq_mask;
+    unsigned m_sq_entries;
+    unsigned m_sqe_tail;        // 本地已填好、尚未发布给内核的尾部
+
+    unsigned* m_cq_head;
+    unsigned* m_cq_tail;
+    unsigned m_cq_mask;
+    io_uring_cqe* m_cqes;
+
+    char* m_buffers;
+    unsigned m_buffer_count;
+    unsigned m_buffer_size;
+    uint16_t m_buffer_group;
+};
+
+#else
+
+class IoUring {}; // Windows 下没有 io_uring
+
+#endif // !_WIN32
+
+#endif // IO_URING_H
@@ -0,0 +1,196 @@
+﻿/**
+* @file output_buffer.cpp
+* @brief 连接的发送队列，内存数据和文件区间按顺序排队，文件区间用 sendfile 发送
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "output_buffer.h"
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <algorithm>
+
+#ifdef _WIN32
+#include <io.h>
+#else
+#include <unistd.h>
+#endif
+
+std::shared_ptr<FileRegion> FileRegion::open(const std::string& path)
+{
+#ifdef _WIN32
+    int fd = ::_open(path.c_str(), _O_RDONLY | _O_BINARY);
+#else
+    int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+#endif
+    if (fd < 0) return nullptr;
+
+    auto region = std::make_shared<FileRegion>();
+    region->fd = fd;
+
+    struct stat st {};
+    if (::fstat(fd, &st) != 0 || !S_ISREG(st.st_mode))
+    {
+        return nullptr;
+    }
+    region->length = static_cast<size_t>(st.st_size);
+    return region;
+}
+
+std::shared_ptr<FileRegion> FileRegion::slice(const std::shared_ptr<FileRegion>& region, int64_t offset, size_t length)
+{
+    auto part = std::make_shared<FileRegion>();
+    part->fd = region->fd;
+    part->offset = region->offset + offset;
+    part->length = length;
+    part->base = region->base ? region->base : region;
+    return part;
+}
+
+bool FileRegion::readAll(std::string& out) const
+{
+    out.resize(length);
+    size_t done = 0;
+    while (done < length)
+    {
+#ifdef _WIN32
+        ::_lseeki64(fd, offset + done, SEEK_SET);
+        int n = ::_read(fd, out.data() + done, static_cast<unsigned>(length - done));
+#else
+        ssize_t n = ::pread(fd, out.data() + done, length - done, offset + done);
+#endif
+        if (n <= 0) return false;
+        done += n;
+    }
+    return true;
+}
+
+FileRegion::~FileRegion()
+{
+    if (fd >= 0 && !base)
+    {
+#ifdef _WIN32
+        ::_close(fd);
+#else
+        ::close(fd);
+#endif
+    }
+}
+
+void OutputBuffer::append(std::string_view data)
+{
+    if (data.empty()) return;
+    if (m_chunks.empty() || m_chunks.back().file || m_chunks.back().shared.owner)
+    {
+        m_chunks.emplace_back();
+    }
+    m_chunks.back().data.append(data);
+    m_size += data.size();
+}
+
+void OutputBuffer::append(std::string&& data)
+{
+    if (data.empty()) return;
+    m_size += data.size();
+    m_chunks.emplace_back();
+    m_chunks.back().data = std::move(data);
+}
+
+void OutputBuffer::appendFile(std::shared_ptr<FileRegion> file)
+{
+    if (!file || file->length == 0) return;
+    m_size += file->length;
+    m_chunks.emplace_back();
+    m_chunks.back().file = std::move(file);
+}
+
+void OutputBuffer::appendShared(SharedBuffer buffer)
+{
+    if (!buffer.owner || buffer.bytes.empty()) return;
+    m_size += buffer.bytes.size();
+    m_chunks.emplace_back();
+    m_chunks.back().shared = std::move(buffer);
+}
+
+void OutputBuffer::append(OutputChunk&& chunk)
+{
+    if (chunk.remaining() == 0) return;
+    m_size += chunk.remaining();
+    m_chunks.push_back(std::move(chunk));
+}
+
+void OutputBuffer::append(OutputBuffer&& other)
+{
+    for (auto& chunk : other.m_chunks)
+    {
+        append(std::move(chunk));
+    }
+    other.clear();
+}
+
+void OutputBuffer::consume(size_t n)
+{
+    m_size -= n;
+    while (n > 0 && !m_chunks.empty())
+    {
+        OutputChunk& chunk = m_chunks.front();
+        size_t step = std::min(n, chunk.remaining());
+        chunk.sent += step;
+        n -= step;
+        if (chunk.remaining() == 0)
+        {
+            if (!chunk.file && !chunk.shared.owner)
+            {
+                recycle(std::move(chunk.data));
+            }
+            m_chunks.pop_front();
+        }
+    }
+}
+
+#ifndef _WIN32
+size_t OutputBuffer::gather(iovec* iov, size_t max_iov) const
+{
+    size_t count = 0;
+    for (const auto& chunk : m_chunks)
+    {
+        if (chunk.file || count == max_iov) break;
+        iov[count].iov_base = const_cast<char*>(chunk.memory().data() + chunk.sent);
+        iov[count].iov_len = chunk.remaining();
+        ++count;
+    }
+    return count;
+}
+#endif
+
+std::string OutputBuffer::takeSpare()
+{
+    std::string spare = std::move(m_spare);
+    m_spare = std::string();
+    spare.clear();
+    return spare;
+}
+
+void OutputBuffer::recycle(std::string&& buffer)
+{
+    // 只留响应头大小的缓冲，大块正文直接释放
+    static constexpr size_t SPARE_MAX = 4096;
+    if (buffer.capacity() <= SPARE_MAX && buffer.capacity() > m_spare.capacity())
+    {
+        m_spare = std::move(buffer);
+    }
+}
+
+OutputChunk OutputBuffer::takeFront()
+{
+    OutputChunk chunk = std::move(m_chunks.front());
+    m_chunks.pop_front();
+    m_size -= chunk.remaining();
+    return chunk;
+}
+
+void OutputBuffer::clear()
+{
+    m_chunks.clear();
+    m_size = 0;
+}
@@ -0,0 +1,103 @@
+﻿/**
+* @file output_buffer.h
+* @brief 连接的发送队列，内存数据和文件区间按顺序排队，文件区间用 sendfile 发送
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef OUTPUT_BUFFER_H
+#define OUTPUT_BUFFER_H
+
+#include <string>
+#include <string_view>
+#include <deque>
+#include <memory>
+#include <cstdint>
+
+#ifndef _WIN32
+#include <sys/uio.h>
+#endif
+
+// 文件的一段，析构时关闭 fd
+struct FileRegion
+{
+    int fd = -1;
+    int64_t offset = 0;
+    size_t length = 0;
+    std::shared_ptr<FileRegion> base;   // 切出来的一段：fd 归 base 所有，这里不关闭
+
+    // 打开整个文件，失败返回空
+    static std::shared_ptr<FileRegion> open(const std::string& path);
+    // 从 region 里切出 [offset, offset + length)，共用同一个 fd，不再打开文件
+    static std::shared_ptr<FileRegion> slice(const std::shared_ptr<FileRegion>& region, int64_t offset, size_t length);
+    // 不支持 sendfile 的平台上把内容读出来
+    bool readAll(std::string& out) const;
+
+    FileRegion() = default;
+    ~FileRegion();
+    FileRegion(const FileRegion&) = delete;
+    FileRegion& operator=(const FileRegion&) = delete;
+};
+
+// 别处持有的只读内存（比如资源缓存里 mmap 的文件），发送时直接引用，不拷贝
+struct SharedBuffer
+{
+    std::shared_ptr<const void> owner;  // 发送完之前保证 bytes 有效
+    std::string_view bytes;
+};
+
+// 一段待发送的数据：file 非空时发送文件区间，shared 非空时发送共享内存，否则发送 data
+struct OutputChunk
+{
+    std::string data;
+    std::shared_ptr<FileRegion> file;
+    SharedBuffer shared;
+    size_t sent = 0;            // 本段已发送的字节数
+
+    size_t size() const { return file ? file->length : shared.owner ? shared.bytes.size() : data.size(); }
+    size_t remaining() const { return size() - sent; }
+    // 内存段的全部内容，文件区间没有意义
+    std::string_view memory() const { return shared.owner ? shared.bytes : std::string_view(data); }
+};
+
+class OutputBuffer
+{
+public:
+    // 拷贝：接到最后一段内存数据后面，减少分段
+    void append(std::string_view data);
+    // 移动：单独成段，不拷贝，发送时和前后的段一起 writev
+    void append(std::string&& data);
+    void appendFile(std::shared_ptr<FileRegion> file);
+    void appendShared(SharedBuffer buffer);
+    // 整段接上，保留已发送的进度
+    void append(OutputChunk&& chunk);
+    void append(OutputBuffer&& other);
+
+    bool empty() const { return m_chunks.empty(); }
+    size_t size() const { return m_size; }          // 剩余未发送的字节数
+
+    OutputChunk& front() { return m_chunks.front(); }
+    const std::deque<OutputChunk>& chunks() const { return m_chunks; }
+
+    // 标记已发送 n 个字节，可以跨越多段
+    void consume(size_t n);
+    // 整段取走，交给内核异步发送时用
+    OutputChunk takeFront();
+    void clear();
+
+#ifndef _WIN32
+    // 把开头连续的内存段填进 iov，遇到文件区间停下，返回填了几个
+    size_t gather(iovec* iov, size_t max_iov) const;
+#endif
+
+    // 发完的小段留下一个字符串的容量，下一次构造响应头时复用，避免每个响应都分配
+    std::string takeSpare();
+    void recycle(std::string&& buffer);
+
+private:
+    std::deque<OutputChunk> m_chunks;
+    size_t m_size = 0;
+    std::string m_spare;
+};
+
+#endif // OUTPUT_BUFFER_H
@@ -6,10 +6,23 @@
 */
 
 #include "socket_server.h"
+#include "io_uring.h"
 #include "comm/log.h"
 #include <format>
 #include <cstring>
 
+#ifndef _WIN32
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/sendfile.h>
+#include <fcntl.h>
+#endif
+
+// 一次 epoll_wait 最多取回的事件数
+static constexpr int MAX_EVENTS = 256;
+// 一次 writev 最多带的段数
+static constexpr size_t MAX_IOV = 64;
+
 // 获取最后的错误信息
 static std::string getLastErrorMsg()
 {
@@ -20,9 +33,16 @@ static std::string getLastErrorMsg()
 #endif
 }
 
-SocketServer::SocketServer(int port) 
+SocketServer::SocketServer(int port, bool reuse_port) 
     : m_port(port),
-    m_listen_fd(INVALID_SOCKET)
+    m_reuse_port(reuse_port),
+    m_listen_fd(INVALID_SOCKET),
+    m_epoll_fd(-1),
+    m_next_conn_id(0),
+    m_idle_timeout(15),
+    m_use_io_uring(false),
+    m_wakeup_value(0),
+    m_wakeup_fd(-1)
 #ifdef _WIN32
     , m_wsa_started(false)
 #endif
@@ -90,6 +110,27 @@ bool SocketServer::start()
 
 void SocketServer::stop()
 {
+    for (auto& [fd, conn] : m_connections)
+    {
+        closeSocket(conn.fd);
+    }
+    m_connections.clear();
+    m_idle_list.clear();
+
+#ifndef _WIN32
+    if (m_epoll_fd >= 0)
+    {
+        ::close(m_epoll_fd);
+        m_epoll_fd = -1;
+    }
+    if (m_wakeup_fd >= 0)
+    {
+        ::close(m_wakeup_fd);
+        m_wakeup_fd = -1;
+    }
+    m_uring.reset();
+#endif
+
     if (m_listen_fd != INVALID_SOCKET)
     {
         closeSocket(m_listen_fd);
@@ -211,6 +252,14 @@ sock_t SocketServer::createSocket()
 #else
     // Linux/Unix 下直接传 int* 就行
     setsockopt(sock, SOL_SOCKET, SO_REUSEADDR, &opt, sizeof(opt));
+
+    // 多个 reactor 各自监听同一端口，内核按四元组哈希把连接分给它们
+    if (m_reuse_port && setsockopt(sock, SOL_SOCKET, SO_REUSEPORT, &opt, sizeof(opt)) < 0)
+    {
+        LOG_WARN(std::format("Failed to set SO_REUSEPORT: {}", getLastErrorMsg()));
+        closeSocket(sock);
+        return INVALID_SOCKET;
+    }
 #endif
 
     // 将 socket 绑定到指定的 IP 和端口
@@ -248,3 +297,484 @@ void SocketServer::closeSocket(sock_t& sock)
     }
     sock = INVALID_SOCKET;
 }
+
+void SocketServer::post(std::function<void()> task)
+{
+    {
+        std::lock_guard<std::mutex> lock(m_task_mutex);
+        m_tasks.push_back(std::move(task));
+    }
+#ifdef _WIN32
+    m_task_cv.notify_one();
+#else
+    uint64_t one = 1;
+    if (::write(m_wakeup_fd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    {
+        LOG_WARN(std::format("wakeup eventfd write failed: {}", getLastErrorMsg()));
+    }
+#endif
+}
+
+void SocketServer::runPostedTasks()
+{
+    std::vector<std::function<void()>> tasks;
+    {
+        std::lock_guard<std::mutex> lock(m_task_mutex);
+        tasks.swap(m_tasks);
+    }
+    for (auto& task : tasks)
+    {
+        task();
+    }
+}
+
+void SocketServer::sendTo(sock_t fd, uint64_t id, OutputBuffer data, bool close_after_write)
+{
+    auto it = m_connections.find(fd);
+    if (it == m_connections.end() || it->second.id != id || it->second.closing)
+    {
+        LOG_DEBUG(std::format("Drop response for closed connection: socket {}", fd));
+        return;
+    }
+
+    Connection& conn = it->second;
+    conn.pending = false;
+    conn.output.append(std::move(data));
+    conn.close_after_write = conn.close_after_write || close_after_write;
+    serviceConnection(conn);
+}
+
+void SocketServer::setIdleTimeout(int seconds)
+{
+    m_idle_timeout = std::chrono::seconds(seconds);
+}
+
+void SocketServer::setUseIoUring(bool use_io_uring)
+{
+    m_use_io_uring = use_io_uring;
+}
+
+#ifdef _WIN32
+
+bool SocketServer::setNonBlocking(sock_t sock)
+{
+    u_long mode = 1;
+    return ioctlsocket(sock, FIONBIO, &mode) == 0;
+}
+
+// Windows 下没有 epoll，逐个连接阻塞处理，只用于本地调试
+bool SocketServer::run(const MessageCallback& on_message)
+{
+    m_on_message = on_message;
+    char buffer[4096];
+    while (m_listen_fd != INVALID_SOCKET)
+    {
+        sock_t fd = accept();
+        if (fd == INVALID_SOCKET) continue;
+
+        Connection& conn = m_connections[fd];
+        conn.fd = fd;
+        conn.id = ++m_next_conn_id;
+
+        int n = 0;
+        while (!conn.close_after_write && (n = recvData(conn.fd, buffer, sizeof(buffer) - 1)) > 0)
+        {
+            conn.read_buf.append(buffer, n);
+            size_t unread = 0;
+            do
+            {
+                unread = conn.read_buf.size();
+                m_on_message(conn);
+
+                // 等工作线程把响应投递回来
+                while (conn.pending)
+                {
+                    std::unique_lock<std::mutex> lock(m_task_mutex);
+                    m_task_cv.wait(lock, [this]() { return !m_tasks.empty(); });
+                    lock.unlock();
+                    runPostedTasks();
+                }
+
+                for (const auto& chunk : conn.output.chunks())
+                {
+                    std::string file_data;
+                    if (chunk.file && !chunk.file->readAll(file_data))
+                    {
+                        conn.close_after_write = true;
+                        break;
+                    }
+                    std::string_view data = chunk.file ? std::string_view(file_data) : chunk.memory();
+                    if (sendAll(conn.fd, data.data(), (int)data.size()) < 0)
+                    {
+                        conn.close_after_write = true;
+                        break;
+                    }
+                }
+                conn.output.clear();
+            } while (!conn.close_after_write && !conn.read_buf.empty() && conn.read_buf.size() != unread);
+        }
+        closeSocket(conn.fd);
+        m_connections.clear();
+    }
+    return true;
+}
+
+void SocketServer::handleAccept() {}
+bool SocketServer::handleRead(Connection&) { return true; }
+void SocketServer::closeConnection(sock_t) {}
+void SocketServer::touchConnection(Connection&) {}
+void SocketServer::closeIdleConnections() {}
+
+// 阻塞模式下由 run 统一发送
+bool SocketServer::handleWrite(Connection&) { return true; }
+bool SocketServer::serviceConnection(Connection&) { return true; }
+bool SocketServer::resumeRead(Connection&) { return true; }
+
+#else
+
+bool SocketServer::setNonBlocking(sock_t sock)
+{
+    int flags = fcntl(sock, F_GETFL, 0);
+    if (flags < 0) return false;
+    return fcntl(sock, F_SETFL, flags | O_NONBLOCK) == 0;
+}
+
+bool SocketServer::run(const MessageCallback& on_message)
+{
+    m_on_message = on_message;
+
+    if (m_use_io_uring)
+    {
+        if (initIoUring())
+        {
+            return runIoUring();
+        }
+        LOG_WARN("io_uring is not available, falling back to epoll");
+    }
+    return runEpoll();
+}
+
+bool SocketServer::runEpoll()
+{
+    m_epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (m_epoll_fd < 0)
+    {
+        LOG_ERROR(std::format("epoll_create1 failed: {}", getLastErrorMsg()));
+        return false;
+    }
+
+    if (!setNonBlocking(m_listen_fd))
+    {
+        LOG_ERROR(std::format("Failed to set listen socket non-blocking: {}", getLastErrorMsg()));
+        return false;
+    }
+
+    epoll_event ev{};
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = m_listen_fd;
+    if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_listen_fd, &ev) < 0)
+    {
+        LOG_ERROR(std::format("epoll_ctl add listen fd failed: {}", getLastErrorMsg()));
+        return false;
+    }
+
+    m_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    ev.events = EPOLLIN | EPOLLET;
+    ev.data.fd = m_wakeup_fd;
+    if (m_wakeup_fd < 0 || epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, m_wakeup_fd, &ev) < 0)
+    {
+        LOG_ERROR(std::format("Failed to set up wakeup eventfd: {}", getLastErrorMsg()));
+        return false;
+    }
+
+    epoll_event events[MAX_EVENTS];
+    while (m_listen_fd != INVALID_SOCKET)
+    {
+        // 超时用于定期清理空闲连接
+        int n = epoll_wait(m_epoll_fd, events, MAX_EVENTS, 1000);
+        if (n < 0)
+        {
+            if (errno == EINTR) continue;
+            LOG_ERROR(std::format("epoll_wait failed: {}", getLastErrorMsg()));
+            return false;
+        }
+
+        for (int i = 0; i < n; ++i)
+        {
+            sock_t fd = events[i].data.fd;
+            if (fd == m_listen_fd)
+            {
+                handleAccept();
+                continue;
+            }
+            if (fd == m_wakeup_fd)
+            {
+                uint64_t count = 0;
+                while (::read(m_wakeup_fd, &count, sizeof(count)) > 0) {}
+                runPostedTasks();
+                continue;
+            }
+
+            auto it = m_connections.find(fd);
+            if (it == m_connections.end()) continue;
+
+            if (events[i].events & (EPOLLERR | EPOLLHUP))
+            {
+                closeConnection(fd);
+                continue;
+            }
+            if (events[i].events & EPOLLOUT)
+            {
+                if (!serviceConnection(it->second)) continue;
+            }
+            if (events[i].events & (EPOLLIN | EPOLLRDHUP))
+            {
+                handleRead(it->second);
+            }
+        }
+
+        closeIdleConnections();
+    }
+    return true;
+}
+
+// 边缘触发，一次把等待队列里的连接全部取完
+void SocketServer::handleAccept()
+{
+    while (true)
+    {
+        sockaddr_in clientAddr{};
+        socklen_t addrLen = sizeof(clientAddr);
+        sock_t fd = ::accept4(m_listen_fd, (sockaddr*)&clientAddr, &addrLen, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd == INVALID_SOCKET)
+        {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK)
+            {
+                LOG_WARN(std::format("accept failed: {}", getLastErrorMsg()));
+            }
+            return;
+        }
+
+        epoll_event ev{};
+        ev.events = EPOLLIN | EPOLLOUT | EPOLLRDHUP | EPOLLET;
+        ev.data.fd = fd;
+        if (epoll_ctl(m_epoll_fd, EPOLL_CTL_ADD, fd, &ev) < 0)
+        {
+            LOG_WARN(std::format("epoll_ctl add client fd failed: {}", getLastErrorMsg()));
+            ::close(fd);
+            continue;
+        }
+
+        Connection& conn = m_connections[fd];
+        conn = Connection{};
+        conn.fd = fd;
+        conn.id = ++m_next_conn_id;
+        conn.idle_pos = m_idle_list.insert(m_idle_list.end(), fd);
+        conn.last_active = std::chrono::steady_clock::now();
+
+        LOG_INFO(std::format("Client connected: {}:{}, on socket {}",
+            inet_ntoa(clientAddr.sin_addr), ntohs(clientAddr.sin_port), fd));
+    }
+}
+
+// 边缘触发，必须读到 EAGAIN 为止。每读到一块就交给上层，流式接收的正文边收边交给接收器，不在读缓冲里攒；
+// 上层处理不过来、读缓冲又攒满了就停在这里，socket 里剩下的数据等 resumeRead 再读。返回 false 表示连接已关闭
+bool SocketServer::handleRead(Connection& conn)
+{
+    char buffer[16384];
+    conn.read_paused = false;
+    while (true)
+    {
+        if (conn.readBlocked())
+        {
+            conn.read_paused = true;
+            return true;
+        }
+
+        ssize_t n = ::recv(conn.fd, buffer, sizeof(buffer), 0);
+        if (n > 0)
+        {
+            conn.read_buf.append(buffer, n);
+            touchConnection(conn);
+            if (!serviceConnection(conn)) return false;
+            continue;
+        }
+        if (n == 0)
+        {
+            conn.peer_closed = true;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno == EAGAIN || errno == EWOULDBLOCK) break;
+
+        LOG_WARN(std::format("recv failed on socket {}: {}", conn.fd, getLastErrorMsg()));
+        closeConnection(conn.fd);
+        return false;
+    }
+
+    touchConnection(conn);
+    return serviceConnection(conn);
+}
+
+// 读被暂停过而现在上层又能处理了，接着读。epoll 下直接读到 EAGAIN，io_uring 下重新挂上多发 recv
+bool SocketServer::resumeRead(Connection& conn)
+{
+    if (!conn.read_paused || conn.readBlocked())
+    {
+        return true;
+    }
+    if (!m_uring)
+    {
+        return handleRead(conn);
+    }
+
+    conn.read_paused = false;
+    if (!conn.recv_armed && !conn.peer_closed)
+    {
+        return uringArmRecv(conn);
+    }
+    return true;
+}
+
+// 先把积压的响应发出去，再处理缓冲区里的请求，返回 false 表示连接已关闭
+bool SocketServer::serviceConnection(Connection& conn)
+{
+    if (!handleWrite(conn)) return false;
+
+    // 发送缓冲积压太多时先不处理新请求，等可写事件再来
+    if (conn.canProcess() && !conn.read_buf.empty())
+    {
+        m_on_message(conn);
+        if (!handleWrite(conn)) return false;
+    }
+
+    // 对端已关闭写方向，处理完已收到的请求后关闭
+    if (conn.peer_closed && !conn.pending && conn.output.empty() && !conn.send_inflight)
+    {
+        LOG_DEBUG(std::format("Client disconnected: socket {}", conn.fd));
+        closeConnection(conn.fd);
+        return false;
+    }
+    return resumeRead(conn);
+}
+
+// 返回 false 表示连接已关闭
+bool SocketServer::handleWrite(Connection& conn)
+{
+    if (m_uring) return uringSend(conn);
+
+    bool wrote = false;
+    while (!conn.output.empty())
+    {
+        long long n = writeOutput(conn.fd, conn.output);
+        if (n > 0)
+        {
+            conn.output.consume(static_cast<size_t>(n));
+            wrote = true;
+            continue;
+        }
+        if (n == 0) break;
+
+        LOG_WARN(std::format("send failed on socket {}: {}", conn.fd, getLastErrorMsg()));
+        closeConnection(conn.fd);
+        return false;
+    }
+
+    if (wrote)
+    {
+        touchConnection(conn);
+    }
+    if (conn.output.empty() && conn.close_after_write)
+    {
+        closeConnection(conn.fd);
+        return false;
+    }
+    return true;
+}
+
+// 开头连续的内存段（响应头、正文……）一次 sendmsg 聚合发送，
+// 文件区间用 sendfile 从页缓存直接写到 socket，不经过用户态
+long long SocketServer::writeOutput(sock_t fd, OutputBuffer& output)
+{
+    OutputChunk& front = output.front();
+    while (true)
+    {
+        ssize_t n = 0;
+        if (front.file)
+        {
+            off_t offset = front.file->offset + front.sent;
+            n = ::sendfile(fd, front.file->fd, &offset, front.remaining());
+        }
+        else
+        {
+            iovec iov[MAX_IOV];
+            msghdr msg{};
+            msg.msg_iov = iov;
+            msg.msg_iovlen = output.gather(iov, MAX_IOV);
+            n = ::sendmsg(fd, &msg, MSG_NOSIGNAL);
+        }
+
+        if (n > 0) return n;
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) return 0;
+        if (n == 0 && front.file)
+        {
+            errno = EIO; // 文件被截断了
+        }
+        return -1;
+    }
+}
+
+// 有读写活动，移到空闲链表尾部
+void SocketServer::touchConnection(Connection& conn)
+{
+    conn.last_active = std::chrono::steady_clock::now();
+    m_idle_list.splice(m_idle_list.end(), m_idle_list, conn.idle_pos);
+}
+
+// 空闲链表按最后活动时间排序，从头部开始关闭超时的连接
+void SocketServer::closeIdleConnections()
+{
+    auto now = std::chrono::steady_clock::now();
+    while (!m_idle_list.empty())
+    {
+        auto it = m_connections.find(m_idle_list.front());
+        if (it == m_connections.end())
+        {
+            m_idle_list.pop_front();
+            continue;
+        }
+
+        Connection& conn = it->second;
+        if (now - conn.last_active < m_idle_timeout) break;
+
+        if (conn.pending)
+        {
+            touchConnection(conn); // 还在等工作线程，不算空闲
+            continue;
+        }
+
+        LOG_DEBUG(std::format("Closing idle connection: socket {}", conn.fd));
+        closeConnection(conn.fd);
+    }
+}
+
+void SocketServer::closeConnection(sock_t fd)
+{
+    auto it = m_connections.find(fd);
+    if (it == m_connections.end()) return;
+
+    if (m_uring)
+    {
+        uringClose(it->second);
+        return;
+    }
+
+    epoll_ctl(m_epoll_fd, EPOLL_CTL_DEL, fd, nullptr);
+    m_idle_list.erase(it->second.idle_pos);
+    closeSocket(it->second.fd);
+    m_connections.erase(it);
+}
+
+#endif
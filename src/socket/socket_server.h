@@ -25,11 +25,74 @@ using sock_t = int;
 
 #include <string>
 #include <iostream>
+#include <functional>
+#include <unordered_map>
+#include <vector>
+#include <list>
+#include <chrono>
+#include <mutex>
+#include <condition_variable>
+#include <cstdint>
+#include <memory>
+#include <any>
+#include "output_buffer.h"
+
+class IoUring;
+struct io_uring_cqe;
+
+// 单个客户端连接的读写状态，由 SocketServer 的事件循环持有
+struct Connection
+{
+    // 发送缓冲积压超过这个值就暂停处理流水线里的后续请求
+    static constexpr size_t WRITE_HIGH_WATER = 4 * 1024 * 1024;
+    // 上层暂时处理不了时读缓冲最多攒这么多，再多就先不从 socket 读，让 TCP 窗口把对端压住
+    static constexpr size_t READ_HIGH_WATER = 64 * 1024;
+
+    sock_t fd = INVALID_SOCKET;
+    uint64_t id = 0;                    // 连接序号，fd 会被复用，跨线程投递时用它校验
+    std::string read_buf;               // 已收到、尚未处理的数据
+    OutputBuffer output;                // 等待发送的数据和文件区间
+    bool close_after_write = false;     // 发送完毕后关闭连接
+    bool pending = false;               // 有请求交给了工作线程，响应还没回来
+    bool peer_closed = false;           // 对端已关闭写方向
+    bool read_paused = false;           // 读缓冲积压，暂停从 socket 读，积压处理掉后由 resumeRead 恢复
+    std::chrono::steady_clock::time_point last_active;
+    std::list<sock_t>::iterator idle_pos;   // 在空闲链表中的位置
+    std::any context;                   // 上层协议挂在连接上的状态，比如 HTTP 的增量解析器
+
+    // 以下只有 io_uring 后端使用
+    OutputBuffer sending;               // 已提交给内核、正在发送的数据，发送期间不能改动
+#ifndef _WIN32
+    iovec send_iov[16];
+    msghdr send_msg{};
+#endif
+    bool send_inflight = false;         // 有 sendmsg 或等可写的 poll 在途
+    bool recv_armed = false;
+    int uring_ops = 0;                  // 未完成的提交项数，归零后才能真正关闭 fd
+    bool closing = false;
+
+    // 上层现在能接着处理读缓冲里的请求：没有请求在工作线程上，发送也没有积压
+    bool canProcess() const
+    {
+        return !pending && !close_after_write && output.size() < WRITE_HIGH_WATER;
+    }
+
+    // 上层处理不了而读缓冲已经攒到上限。能处理时不限制：解析器自己限制了头部和正文的大小
+    bool readBlocked() const
+    {
+        return !canProcess() && read_buf.size() >= READ_HIGH_WATER;
+    }
+};
+
+// 连接上有新数据时回调，回调从 read_buf 取走完整请求，把响应按顺序追加到 output
+// 设置 pending 表示请求已异步处理，响应回来之前不会再回调
+using MessageCallback = std::function<void(Connection&)>;
 
 class SocketServer
 {
 public:
-    SocketServer(int port);
+    // reuse_port 为 true 时监听套接字带 SO_REUSEPORT，多个实例可以绑定同一端口，由内核分发连接
+    SocketServer(int port, bool reuse_port = false);
     ~SocketServer();
 
     bool init();
@@ -45,14 +108,78 @@ public:
     int recvAll(sock_t sock, char* buffer, int len);
     int sendAll(sock_t sock, const char* buffer, int len);
 
+    // 事件循环，监听 fd 和所有客户端 fd 都在这里处理，正常情况下不返回
+    bool run(const MessageCallback& on_message);
+
+    // 线程安全，把任务投递到事件循环线程执行
+    void post(std::function<void()> task);
+    // 只能在事件循环线程调用，把异步处理完的响应写回连接，连接已关闭则丢弃
+    void sendTo(sock_t fd, uint64_t id, OutputBuffer data, bool close_after_write);
+
+    // 连接无读写活动超过这个时间就关闭
+    void setIdleTimeout(int seconds);
+
+    // 使用 io_uring 后端，内核不支持时 run 会自动退回 epoll
+    void setUseIoUring(bool use_io_uring);
+
 private:
     sock_t createSocket();
     void closeSocket(sock_t& sock);
 
+    bool setNonBlocking(sock_t sock);
+    void handleAccept();
+    bool handleRead(Connection& conn);
+    bool handleWrite(Connection& conn);
+    bool serviceConnection(Connection& conn);
+    bool resumeRead(Connection& conn);
+    void touchConnection(Connection& conn);
+    void closeIdleConnections();
+    void closeConnection(sock_t fd);
+    void runPostedTasks();
+
+    bool runEpoll();
+    // 非阻塞地发送队首的数据，返回发送的字节数，0 表示暂时不可写，-1 表示出错
+    static long long writeOutput(sock_t fd, OutputBuffer& output);
+
+    // io_uring 后端，见 socket_server_uring.cpp
+    bool initIoUring();
+    bool runIoUring();
+    void uringArmAccept();
+    bool uringArmRecv(Connection& conn);
+    void uringCancelRecv(Connection& conn);
+    void uringArmWakeup();
+    void uringArmTimer();
+    void uringHandleCqe(const io_uring_cqe& cqe);
+    void uringHandleAccept(const io_uring_cqe& cqe);
+    void uringHandleRecv(Connection& conn, const io_uring_cqe& cqe);
+    void uringHandleSend(Connection& conn, const io_uring_cqe& cqe);
+    void uringHandlePollOut(Connection& conn, const io_uring_cqe& cqe);
+    void uringSubmitSending(Connection& conn);
+    bool uringSend(Connection& conn);
+    void uringClose(Connection& conn);
+    void uringFinishClose(Connection& conn);
+
 private:
     int m_port;
+    bool m_reuse_port;
     sock_t m_listen_fd;
 
+    int m_epoll_fd;
+    MessageCallback m_on_message;
+    std::unordered_map<sock_t, Connection> m_connections;
+    uint64_t m_next_conn_id;
+    std::list<sock_t> m_idle_list;              // 按最后活动时间排序，头部最久
+    std::chrono::seconds m_idle_timeout;
+
+    bool m_use_io_uring;
+    std::unique_ptr<IoUring> m_uring;           // 为空时使用 epoll
+    uint64_t m_wakeup_value;                    // io_uring 读 eventfd 的目标
+
+    int m_wakeup_fd;                            // eventfd，post 时唤醒事件循环
+    std::mutex m_task_mutex;
+    std::condition_variable m_task_cv;
+    std::vector<std::function<void()>> m_tasks;
+
 #ifdef _WIN32
     bool m_wsa_started;
 #endif
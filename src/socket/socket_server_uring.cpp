@@ -0,0 +1,452 @@
+﻿/**
+* @file socket_server_uring.cpp
+* @brief socket 服务的 io_uring 后端：多发 accept、内核挑选缓冲区的多发 recv、批量提交 send
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef _WIN32
+
+#include "socket_server.h"
+#include "io_uring.h"
+#include "comm/log.h"
+#include <format>
+#include <cstring>
+#include <sys/eventfd.h>
+#include <poll.h>
+
+// 提交项的 user_data：高 32 位是操作类型，低 32 位是 fd
+// 连接在所有提交项完成前不会关闭 fd，所以 fd 不会被复用
+enum UringOp : uint64_t
+{
+    URING_INTERNAL = 0,     // IoUring 内部归还缓冲区，只有失败时才有完成项
+    URING_ACCEPT,
+    URING_RECV,
+    URING_SEND,
+    URING_POLLOUT,
+    URING_WAKEUP,
+    URING_TIMER,
+    URING_CANCEL            // 取消连接上的多发 recv，见 uringCancelRecv
+};
+
+static constexpr unsigned URING_ENTRIES = 4096;
+static constexpr uint16_t URING_BUFFER_GROUP = 0;
+static constexpr unsigned URING_BUFFER_COUNT = 512;
+static constexpr unsigned URING_BUFFER_SIZE = 16384;
+static constexpr size_t URING_MAX_IOV = sizeof(Connection::send_iov) / sizeof(iovec);
+
+// 定时器每秒触发一次，用来清理空闲连接
+static const __kernel_timespec URING_TICK = { 1, 0 };
+
+static uint64_t makeUserData(UringOp op, sock_t fd)
+{
+    return (static_cast<uint64_t>(op) << 32) | static_cast<uint32_t>(fd);
+}
+
+bool SocketServer::initIoUring()
+{
+    if (!IoUring::isSupported())
+    {
+        return false;
+    }
+
+    auto ring = std::make_unique<IoUring>();
+    if (!ring->init(URING_ENTRIES) ||
+        !ring->provideBuffers(URING_BUFFER_GROUP, URING_BUFFER_COUNT, URING_BUFFER_SIZE))
+    {
+        return false;
+    }
+
+    m_wakeup_fd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeup_fd < 0)
+    {
+        LOG_ERROR(std::format("Failed to create wakeup eventfd: {}", strerror(errno)));
+        return false;
+    }
+
+    m_uring = std::move(ring);
+    return true;
+}
+
+bool SocketServer::runIoUring()
+{
+    LOG_INFO(std::format("Event loop on port {} using io_uring", m_port));
+
+    uringArmAccept();
+    uringArmWakeup();
+    uringArmTimer();
+
+    while (m_listen_fd != INVALID_SOCKET)
+    {
+        // 一次系统调用提交上一轮攒下的所有 send/recv，并等待新的完成项
+        int ret = m_uring->submitAndWait(1);
+        if (ret < 0 && errno != EINTR && errno != EAGAIN && errno != EBUSY)
+        {
+            return false;
+        }
+
+        m_uring->forEachCqe([this](const io_uring_cqe& cqe) { uringHandleCqe(cqe); });
+    }
+    return true;
+}
+
+void SocketServer::uringArmAccept()
+{
+    io_uring_sqe* sqe = m_uring->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_ACCEPT;
+    sqe->fd = m_listen_fd;
+    sqe->ioprio = IORING_ACCEPT_MULTISHOT;
+    sqe->accept_flags = SOCK_NONBLOCK | SOCK_CLOEXEC;
+    sqe->user_data = makeUserData(URING_ACCEPT, m_listen_fd);
+}
+
+// 返回 false 表示提交队列满，连接已关闭
+bool SocketServer::uringArmRecv(Connection& conn)
+{
+    io_uring_sqe* sqe = m_uring->getSqe();
+    if (!sqe)
+    {
+        uringClose(conn);
+        return false;
+    }
+    sqe->opcode = IORING_OP_RECV;
+    sqe->fd = conn.fd;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = URING_BUFFER_GROUP;
+    sqe->user_data = makeUserData(URING_RECV, conn.fd);
+
+    conn.recv_armed = true;
+    ++conn.uring_ops;
+    return true;
+}
+
+// 读缓冲积压时停掉多发 recv。取消生效之前内核已经收进缓冲池的数据还会陆续完成（最多是整个缓冲池），
+// 最后一个完成项是 -ECANCELED，之后 recv_armed 才清掉；积压处理掉以后 resumeRead 重新挂上
+void SocketServer::uringCancelRecv(Connection& conn)
+{
+    io_uring_sqe* sqe = m_uring->getSqe();
+    if (!sqe)
+    {
+        uringClose(conn);
+        return;
+    }
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->fd = -1;
+    sqe->addr = makeUserData(URING_RECV, conn.fd);
+    sqe->user_data = makeUserData(URING_CANCEL, conn.fd);
+    ++conn.uring_ops;
+}
+
+void SocketServer::uringArmWakeup()
+{
+    io_uring_sqe* sqe = m_uring->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_READ;
+    sqe->fd = m_wakeup_fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&m_wakeup_value);
+    sqe->len = sizeof(m_wakeup_value);
+    sqe->user_data = makeUserData(URING_WAKEUP, m_wakeup_fd);
+}
+
+void SocketServer::uringArmTimer()
+{
+    io_uring_sqe* sqe = m_uring->getSqe();
+    if (!sqe) return;
+    sqe->opcode = IORING_OP_TIMEOUT;
+    sqe->fd = -1;
+    sqe->addr = reinterpret_cast<uint64_t>(&URING_TICK);
+    sqe->len = 1;
+    sqe->user_data = makeUserData(URING_TIMER, -1);
+}
+
+void SocketServer::uringHandleCqe(const io_uring_cqe& cqe)
+{
+    auto op = static_cast<UringOp>(cqe.user_data >> 32);
+    auto fd = static_cast<sock_t>(static_cast<uint32_t>(cqe.user_data));
+
+    switch (op)
+    {
+    case URING_INTERNAL:
+        LOG_WARN(std::format("io_uring buffer recycle failed: {}", strerror(-cqe.res)));
+        return;
+    case URING_ACCEPT:
+        uringHandleAccept(cqe);
+        return;
+    case URING_WAKEUP:
+        runPostedTasks();
+        uringArmWakeup();
+        return;
+    case URING_TIMER:
+        closeIdleConnections();
+        uringArmTimer();
+        return;
+    default:
+        break;
+    }
+
+    auto it = m_connections.find(fd);
+    if (it == m_connections.end())
+    {
+        LOG_WARN(std::format("io_uring completion for unknown socket {}", fd));
+        return;
+    }
+
+    Connection& conn = it->second;
+    if (op == URING_RECV)
+    {
+        uringHandleRecv(conn, cqe);
+    }
+    else if (op == URING_SEND)
+    {
+        uringHandleSend(conn, cqe);
+    }
+    else if (op == URING_POLLOUT)
+    {
+        uringHandlePollOut(conn, cqe);
+    }
+    else if (op == URING_CANCEL)
+    {
+        // 取消的结果不用管：recv 已经结束了（-ENOENT）也一样，recv 自己的完成项会清掉 recv_armed
+        --conn.uring_ops;
+        uringFinishClose(conn);
+    }
+}
+
+void SocketServer::uringHandleAccept(const io_uring_cqe& cqe)
+{
+    if (!(cqe.flags & IORING_CQE_F_MORE))
+    {
+        uringArmAccept(); // 多发 accept 被内核终止了，重新挂上
+    }
+
+    if (cqe.res < 0)
+    {
+        LOG_WARN(std::format("accept failed: {}", strerror(-cqe.res)));
+        return;
+    }
+
+    sock_t fd = cqe.res;
+    Connection& conn = m_connections[fd];
+    conn = Connection{};
+    conn.fd = fd;
+    conn.id = ++m_next_conn_id;
+    conn.idle_pos = m_idle_list.insert(m_idle_list.end(), fd);
+    conn.last_active = std::chrono::steady_clock::now();
+
+    LOG_INFO(std::format("Client connected on socket {}", fd));
+    uringArmRecv(conn);
+}
+
+void SocketServer::uringHandleRecv(Connection& conn, const io_uring_cqe& cqe)
+{
+    if (!(cqe.flags & IORING_CQE_F_MORE))
+    {
+        conn.recv_armed = false;
+        --conn.uring_ops;
+    }
+
+    if (cqe.flags & IORING_CQE_F_BUFFER)
+    {
+        auto bid = static_cast<uint16_t>(cqe.flags >> IORING_CQE_BUFFER_SHIFT);
+        if (cqe.res > 0 && !conn.closing)
+        {
+            conn.read_buf.append(m_uring->buffer(bid), cqe.res);
+        }
+        m_uring->recycleBuffer(bid);
+    }
+
+    if (conn.closing)
+    {
+        uringFinishClose(conn);
+        return;
+    }
+
+    if (cqe.res == 0)
+    {
+        conn.peer_closed = true;
+    }
+    else if (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED)
+    {
+        LOG_WARN(std::format("recv failed on socket {}: {}", conn.fd, strerror(-cqe.res)));
+        uringClose(conn);
+        return;
+    }
+
+    touchConnection(conn);
+    if (!serviceConnection(conn)) return;
+
+    // 上层处理不过来，读缓冲又攒满了：停掉 recv，不然内核收到多少就往读缓冲里塞多少
+    if (conn.readBlocked())
+    {
+        if (!conn.read_paused && conn.recv_armed)
+        {
+            uringCancelRecv(conn);
+        }
+        conn.read_paused = true;
+        return;
+    }
+
+    // 缓冲区暂时用完（-ENOBUFS）时多发 recv 会停下，数据已经取走，重新挂上
+    if (!conn.recv_armed && !conn.peer_closed && !conn.read_paused)
+    {
+        uringArmRecv(conn);
+    }
+}
+
+void SocketServer::uringHandleSend(Connection& conn, const io_uring_cqe& cqe)
+{
+    conn.send_inflight = false;
+    --conn.uring_ops;
+
+    if (conn.closing)
+    {
+        uringFinishClose(conn);
+        return;
+    }
+
+    if (cqe.res < 0)
+    {
+        LOG_WARN(std::format("send failed on socket {}: {}", conn.fd, strerror(-cqe.res)));
+        uringClose(conn);
+        return;
+    }
+
+    conn.sending.consume(static_cast<size_t>(cqe.res));
+    if (!conn.sending.empty())
+    {
+        uringSubmitSending(conn); // 只发出去一部分，继续发剩下的
+        return;
+    }
+
+    conn.output.recycle(conn.sending.takeSpare());
+    touchConnection(conn);
+    serviceConnection(conn);
+}
+
+void SocketServer::uringHandlePollOut(Connection& conn, const io_uring_cqe& cqe)
+{
+    conn.send_inflight = false;
+    --conn.uring_ops;
+
+    if (conn.closing)
+    {
+        uringFinishClose(conn);
+        return;
+    }
+    if (cqe.res < 0)
+    {
+        uringClose(conn);
+        return;
+    }
+    serviceConnection(conn);
+}
+
+void SocketServer::uringSubmitSending(Connection& conn)
+{
+    io_uring_sqe* sqe = m_uring->getSqe();
+    if (!sqe)
+    {
+        uringClose(conn);
+        return;
+    }
+
+    conn.send_msg = msghdr{};
+    conn.send_msg.msg_iov = conn.send_iov;
+    conn.send_msg.msg_iovlen = conn.sending.gather(conn.send_iov, URING_MAX_IOV);
+
+    sqe->opcode = IORING_OP_SENDMSG;
+    sqe->fd = conn.fd;
+    sqe->addr = reinterpret_cast<uint64_t>(&conn.send_msg);
+    sqe->len = 1;
+    sqe->msg_flags = MSG_NOSIGNAL;
+    sqe->user_data = makeUserData(URING_SEND, conn.fd);
+    conn.send_inflight = true;
+    ++conn.uring_ops;
+}
+
+// handleWrite 的 io_uring 版本：一个连接同时只有一个 sendmsg 在途，
+// 在途期间新产生的响应继续追加到 output，等这次发完再提交。
+// io_uring 没有 sendfile，文件区间直接调用非阻塞的 sendfile，写不动时挂一个 POLLOUT
+bool SocketServer::uringSend(Connection& conn)
+{
+    if (conn.closing) return false;
+    if (conn.send_inflight) return true;
+
+    while (!conn.output.empty())
+    {
+        if (!conn.output.front().file)
+        {
+            // 开头连续的内存段一起交给一次 sendmsg
+            while (!conn.output.empty() && !conn.output.front().file
+                && conn.sending.chunks().size() < URING_MAX_IOV)
+            {
+                conn.sending.append(conn.output.takeFront());
+            }
+            uringSubmitSending(conn);
+            return !conn.closing;
+        }
+
+        long long n = writeOutput(conn.fd, conn.output);
+        if (n > 0)
+        {
+            conn.output.consume(static_cast<size_t>(n));
+            touchConnection(conn);
+            continue;
+        }
+        if (n < 0)
+        {
+            LOG_WARN(std::format("sendfile failed on socket {}: {}", conn.fd, strerror(errno)));
+            uringClose(conn);
+            return false;
+        }
+
+        io_uring_sqe* sqe = m_uring->getSqe();
+        if (!sqe)
+        {
+            uringClose(conn);
+            return false;
+        }
+        sqe->opcode = IORING_OP_POLL_ADD;
+        sqe->fd = conn.fd;
+        sqe->poll32_events = POLLOUT;
+        sqe->user_data = makeUserData(URING_POLLOUT, conn.fd);
+        conn.send_inflight = true;
+        ++conn.uring_ops;
+        return true;
+    }
+
+    if (conn.close_after_write)
+    {
+        uringClose(conn);
+        return false;
+    }
+    return true;
+}
+
+// 先 shutdown 让在途的 recv/send 尽快完成，全部完成后再关闭 fd、释放连接
+void SocketServer::uringClose(Connection& conn)
+{
+    if (conn.closing) return;
+    conn.closing = true;
+    m_idle_list.erase(conn.idle_pos);
+
+    if (conn.uring_ops > 0)
+    {
+        ::shutdown(conn.fd, SHUT_RDWR);
+        return;
+    }
+    uringFinishClose(conn);
+}
+
+void SocketServer::uringFinishClose(Connection& conn)
+{
+    if (!conn.closing || conn.uring_ops > 0) return;
+
+    sock_t fd = conn.fd;
+    closeSocket(conn.fd);
+    m_connections.erase(fd);
+}
+
+#endif // !_WIN32
@@ -0,0 +1,165 @@
+﻿/**
+* @file html_template.cpp
+* @brief HTML 模板：只解析一次，拆成字面量和 {{NAME}} 占位符，渲染时一次分配到位；开发模式下文件修改后自动重新加载
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "html_template.h"
+#include "comm/log.h"
+#include "comm/config.h"
+#include "embed/embedded_assets.h"
+#include <fstream>
+#include <sstream>
+#include <format>
+
+HtmlTemplate::HtmlTemplate(std::string name)
+    : m_name(std::move(name))
+{
+}
+
+std::shared_ptr<const HtmlTemplate::Compiled> HtmlTemplate::compileEmbedded() const
+{
+    auto compiled = std::make_shared<Compiled>();
+    const EmbeddedAsset* asset = findEmbeddedAsset(m_name);
+    if (!asset)
+    {
+        LOG_ERROR(std::format("Template {} is not embedded", m_name));
+        return compiled;
+    }
+    compiled->source = asset->bytes();
+    parse(*compiled);
+    return compiled;
+}
+
+std::shared_ptr<const HtmlTemplate::Compiled> HtmlTemplate::compileFile(const std::filesystem::path& path) const
+{
+    auto compiled = std::make_shared<Compiled>();
+
+    std::error_code ec;
+    compiled->mtime = std::filesystem::last_write_time(path, ec);
+    std::ifstream ifs(path, std::ios::binary);
+    if (ec || !ifs)
+    {
+        LOG_ERROR(std::format("Failed to load template {}", path.string()));
+        return compiled;
+    }
+    std::stringstream ss;
+    ss << ifs.rdbuf();
+    compiled->storage = ss.str();
+    compiled->source = compiled->storage;
+    parse(*compiled);
+    return compiled;
+}
+
+void HtmlTemplate::parse(Compiled& compiled) const
+{
+    // 所有模板共用一个计数，起始值取启动时间，换了程序重启后版本号也不会和之前的重复
+    static std::atomic<uint64_t> next_version{ static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::system_clock::now().time_since_epoch()).count()) };
+    compiled.version = next_version++;
+
+    // 拆成 字面量 / 占位符 / 字面量 ……。占位符名只能是字母、数字、下划线，
+    // 其余的 "{{"（比如页面脚本里的）原样当字面量
+    auto isName = [](std::string_view name)
+        {
+            return !name.empty() && name.find_first_not_of(
+                "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_") == std::string_view::npos;
+        };
+
+    std::string_view rest = compiled.source;
+    size_t literal = 0;     // rest 开头已经确定是字面量的长度
+    while (true)
+    {
+        size_t open = rest.find("{{", literal);
+        size_t close = open == std::string_view::npos ? open : rest.find("}}", open + 2);
+        if (close == std::string_view::npos)
+        {
+            if (!rest.empty())
+            {
+                compiled.segments.push_back({ rest, false });
+            }
+            break;
+        }
+        if (!isName(rest.substr(open + 2, close - open - 2)))
+        {
+            literal = open + 2;
+            continue;
+        }
+        if (open > 0)
+        {
+            compiled.segments.push_back({ rest.substr(0, open), false });
+        }
+        compiled.segments.push_back({ rest.substr(open + 2, close - open - 2), true });
+        rest = rest.substr(close + 2);
+        literal = 0;
+    }
+
+    LOG_INFO(std::format("Compiled template {} into {} segments", m_name, compiled.segments.size()));
+}
+
+std::shared_ptr<const HtmlTemplate::Compiled> HtmlTemplate::current()
+{
+    std::lock_guard<std::mutex> lock(m_mutex);
+
+    // 嵌入的模板不会变，编译一次就够了
+    const std::string& assets_dir = Config::getInstance().assets_dir;
+    if (assets_dir.empty())
+    {
+        if (!m_compiled)
+        {
+            m_compiled = compileEmbedded();
+        }
+        return m_compiled;
+    }
+
+    auto now = std::chrono::steady_clock::now();
+    if (m_compiled && now < m_next_check)
+    {
+        return m_compiled;
+    }
+    m_next_check = now + CHECK_INTERVAL;
+
+    std::filesystem::path path = std::filesystem::path(assets_dir) / m_name;
+    std::error_code ec;
+    auto mtime = std::filesystem::last_write_time(path, ec);
+    if (!m_compiled || (!ec && mtime != m_compiled->mtime))
+    {
+        m_compiled = compileFile(path);
+    }
+    return m_compiled;
+}
+
+uint64_t HtmlTemplate::version()
+{
+    return current()->version;
+}
+
+std::string HtmlTemplate::render(TemplateValues values)
+{
+    std::shared_ptr<const Compiled> compiled = current();
+
+    auto lookup = [&values](std::string_view name) -> std::string_view
+        {
+            for (const auto& kv : values)
+            {
+                if (kv.first == name) return kv.second;
+            }
+            return {};
+        };
+
+    // 先算总长度，只分配一次，然后顺序拷贝
+    size_t length = 0;
+    for (const Segment& segment : compiled->segments)
+    {
+        length += segment.placeholder ? lookup(segment.text).size() : segment.text.size();
+    }
+
+    std::string out;
+    out.reserve(length);
+    for (const Segment& segment : compiled->segments)
+    {
+        out += segment.placeholder ? lookup(segment.text) : segment.text;
+    }
+    return out;
+}
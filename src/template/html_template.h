@@ -0,0 +1,71 @@
+﻿/**
+* @file html_template.h
+* @brief HTML 模板：只解析一次，拆成字面量和 {{NAME}} 占位符，渲染时一次分配到位；开发模式下文件修改后自动重新加载
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#ifndef HTML_TEMPLATE_H
+#define HTML_TEMPLATE_H
+
+#include <string>
+#include <string_view>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <chrono>
+#include <filesystem>
+#include <initializer_list>
+#include <utility>
+#include <atomic>
+#include <cstdint>
+
+using TemplateValues = std::initializer_list<std::pair<std::string_view, std::string_view>>;
+
+// 一般作为处理函数里的函数内静态变量，多个线程可以同时渲染。
+// 模板默认取编进程序的资源，只编译一次；配置了 assets_dir（开发模式）时从磁盘读并跟踪修改
+class HtmlTemplate
+{
+public:
+    // name 是相对资源目录的路径，如 "html/index.html"
+    explicit HtmlTemplate(std::string name);
+
+    // 占位符按名字替换，同一个占位符可以出现多次，没给值的替换成空
+    std::string render(TemplateValues values = {});
+
+    // 模板每重新编译一次就变，页面的 ETag 要把它算进去，开发时改了模板浏览器才会重新取
+    uint64_t version();
+
+private:
+    struct Segment
+    {
+        std::string_view text;  // 字面量，或者占位符的名字
+        bool placeholder = false;
+    };
+
+    // 一次编译的结果，segments 指向 source，整体不可变。
+    // 嵌入的模板 source 直接指向只读数据，从磁盘读的放在 storage 里
+    struct Compiled
+    {
+        std::string storage;
+        std::string_view source;
+        std::vector<Segment> segments;
+        std::filesystem::file_time_type mtime;
+        uint64_t version = 0;
+    };
+
+    std::shared_ptr<const Compiled> current();
+    std::shared_ptr<const Compiled> compileEmbedded() const;
+    std::shared_ptr<const Compiled> compileFile(const std::filesystem::path& path) const;
+    void parse(Compiled& compiled) const;
+
+    // 每次渲染都 stat 一下太浪费，最多每隔这么久检查一次文件有没有改
+    static constexpr std::chrono::seconds CHECK_INTERVAL{ 1 };
+
+    std::string m_name;
+    std::mutex m_mutex;
+    std::shared_ptr<const Compiled> m_compiled;
+    std::chrono::steady_clock::time_point m_next_check;
+};
+
+#endif // !HTML_TEMPLATE_H
@@ -0,0 +1,134 @@
+﻿/**
+* @file diary_store_test.cpp
+* @brief 日记名测试：用户标题里的 / \ .. 和控制字符不能让日记和附件写到日记目录外面去
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "diary/diary_store.h"
+#include "diary/diary_upload.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+
+namespace fs = std::filesystem;
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); ++g_failures; } } while (0)
+
+// 每个测试一个空的临时目录，diaries 是日记目录，它旁边的文件算“目录外面”
+static fs::path freshRoot(const char* name)
+{
+    fs::path root = fs::temp_directory_path() / (std::string("footprints-") + name);
+    fs::remove_all(root);
+    fs::create_directories(root / "diaries");
+    return root;
+}
+
+// 除了 diaries 本身，根目录下不该多出任何东西
+static bool nothingOutside(const fs::path& root)
+{
+    for (const auto& entry : fs::directory_iterator(root))
+    {
+        if (entry.path().filename() != "diaries")
+        {
+            std::printf("unexpected %s\n", entry.path().string().c_str());
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testNames()
+{
+    CHECK(sanitizeDiaryTitle("日记") == "日记");
+    CHECK(sanitizeDiaryTitle("a/b\\c") == "a_b_c");
+    CHECK(sanitizeDiaryTitle("../../etc/passwd") == "_.._etc_passwd");
+    CHECK(sanitizeDiaryTitle("...hidden") == "hidden");
+    CHECK(sanitizeDiaryTitle(std::string_view("a\0b\n", 4)) == "a_b_");
+    CHECK(sanitizeDiaryTitle("..") == "");
+
+    CHECK(isValidDiaryName("(2026-10-17)日记"));
+    CHECK(isValidDiaryName("(2026-10-17).."));   // 不以点开头、没有分隔符，只是目录里的一项
+    CHECK(!isValidDiaryName(""));
+    CHECK(!isValidDiaryName(".."));
+    CHECK(!isValidDiaryName(".upload-abc"));
+    CHECK(!isValidDiaryName("(2026-10-17)../../x"));
+    CHECK(!isValidDiaryName("a\\b"));
+    CHECK(!isValidDiaryName(std::string_view("a\0b", 3)));
+
+    // 清理过的标题拼出来的名字总是合法的
+    for (const char* title : { "../x", "/", "\\..\\", "..", "a/../../b", "\x01\x02" })
+    {
+        CHECK(isValidDiaryName("(2026-10-17)" + sanitizeDiaryTitle(title)));
+    }
+}
+
+static void testStoreRejectsUnsafeNames()
+{
+    fs::path root = freshRoot("store");
+    FileDiaryStore store((root / "diaries").string());
+
+    fs::path temp = root / "diaries" / ".upload-test";
+    std::ofstream(temp) << "title\nbody";
+    CHECK(!store.commit("../escape", temp.string()));
+    CHECK(!store.commit("a/b", temp.string()));
+    CHECK(fs::exists(temp));
+    CHECK(nothingOutside(root));
+
+    std::ofstream(root / "outside") << "secret";
+    std::string text;
+    DiaryStat stat;
+    CHECK(!store.read("../outside", text));
+    CHECK(!store.stat("../outside", stat));
+    CHECK(!store.remove("../outside"));
+    CHECK(fs::exists(root / "outside"));
+    fs::remove_all(root);
+}
+
+// 带附件的上传：附件目录用的是日记名，名字不安全时什么都不建
+static void testUploadRejectsUnsafeNames()
+{
+    fs::path root = freshRoot("upload");
+    std::string directory = (root / "diaries").string();
+    FileDiaryStore store(directory);
+
+    const std::string body =
+        "--b\r\nContent-Disposition: form-data; name=\"title\"\r\n\r\n../../x\r\n"
+        "--b\r\nContent-Disposition: form-data; name=\"file\"; filename=\"a.txt\"\r\n\r\nattached\r\n"
+        "--b--\r\n";
+
+    auto upload = DiaryUpload::create(directory, "multipart/form-data; boundary=b");
+    CHECK(upload && upload->write(body) && upload->finish());
+    CHECK(upload && !upload->commit("(2026-10-17)" + upload->title(), store));
+    upload.reset();
+    CHECK(nothingOutside(root));
+    CHECK(!fs::exists(root / "diaries" / "attachments"));
+
+    upload = DiaryUpload::create(directory, "multipart/form-data; boundary=b");
+    CHECK(upload && upload->write(body) && upload->finish());
+    std::string name = "(2026-10-17)" + sanitizeDiaryTitle(upload ? upload->title() : "");
+    CHECK(upload && upload->commit(name, store));
+    CHECK(fs::is_regular_file(root / "diaries" / name));
+    CHECK(fs::is_regular_file(root / "diaries" / "attachments" / name / "a.txt"));
+    CHECK(nothingOutside(root));
+    fs::remove_all(root);
+}
+
+int main()
+{
+    testNames();
+    testStoreRejectsUnsafeNames();
+    testUploadRejectsUnsafeNames();
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all diary store tests passed\n");
+    return 0;
+}
@@ -0,0 +1,154 @@
+﻿/**
+* @file diary_upload_test.cpp
+* @brief 写日记表单接收测试：urlencoded 和 multipart 正文在每个位置切成两段、逐字节写入，存下的日记和附件都要和一次写完一样
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "diary/diary_store.h"
+#include "diary/diary_upload.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); ++g_failures; } } while (0)
+
+static const char* URLENCODED = "application/x-www-form-urlencoded";
+static const std::string NAME = "(2026-10-17)test";
+
+static std::string readFile(const fs::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+// 在 cuts 给出的位置把 body 切开写进去再提交，返回存下的日记和所有附件；哪一步失败就返回失败的地方
+static std::string upload(std::string_view content_type, std::string_view body, const std::vector<size_t>& cuts)
+{
+    fs::path root = fs::temp_directory_path() / "footprints-upload";
+    fs::remove_all(root);
+    fs::create_directories(root);
+    FileDiaryStore store(root.string());
+
+    auto upload = DiaryUpload::create(root.string(), content_type);
+    if (!upload)
+    {
+        return "<create failed>";
+    }
+    size_t begin = 0;
+    for (size_t cut : cuts)
+    {
+        if (!upload->write(body.substr(begin, cut - begin)))
+        {
+            return "<write failed>";
+        }
+        begin = cut;
+    }
+    if (!upload->write(body.substr(begin)))
+    {
+        return "<write failed>";
+    }
+    if (!upload->finish())
+    {
+        return "<finish failed>";
+    }
+    if (!upload->commit(NAME, store))
+    {
+        return "<commit failed>";
+    }
+
+    std::string result;
+    CHECK(store.read(NAME, result));
+    std::error_code ec;
+    for (const auto& entry : fs::directory_iterator(root / "attachments" / NAME, ec))
+    {
+        result += "|" + entry.path().filename().string() + "=" + readFile(entry.path());
+    }
+    return result;
+}
+
+// 一次写完、每个位置切一刀、逐字节写，结果必须一样；返回一次写完的结果
+static std::string uploadEverySplit(std::string_view content_type, std::string_view body)
+{
+    std::string whole = upload(content_type, body, {});
+    for (size_t cut = 0; cut <= body.size(); ++cut)
+    {
+        std::string split = upload(content_type, body, { cut });
+        if (split != whole)
+        {
+            std::printf("split at %zu differs: %s\n", cut, split.c_str());
+            ++g_failures;
+        }
+    }
+    std::vector<size_t> bytes;
+    for (size_t i = 1; i < body.size(); ++i)
+    {
+        bytes.push_back(i);
+    }
+    CHECK(upload(content_type, body, bytes) == whole);
+    return whole;
+}
+
+static void testUrlEncoded()
+{
+    // "%E6%97%A5" 是“日”；%0D%0A 是 CRLF；+ 是空格，%2B 才是加号
+    CHECK(uploadEverySplit(URLENCODED,
+        "title=%E6%97%A5%e8%ae%b0+1&content=line1%0D%0Aline2+%2B+%25&submit=%E4%BF%9D%E5%AD%98")
+        == "日记 1\nline1\r\nline2 + %\n");
+
+    // 正文在前标题在后，中间有没用的字段和空字段
+    CHECK(uploadEverySplit(URLENCODED, "content=a%26b%3Dc&&x=1&flag&title=t%2Ft")
+        == "t/t\na&b=c\n");
+
+    // 不合法的转义原样保留，包括切在 '%' 和两位之间的，以及正文末尾没写完的
+    CHECK(uploadEverySplit(URLENCODED, "title=100%&content=%zz%4g%a&x=%") == "100%\n%zz%4g%a\n");
+    CHECK(uploadEverySplit(URLENCODED, "title=t&content=%4") == "t\n%4\n");
+    CHECK(uploadEverySplit(URLENCODED, "title=t&content=50%") == "t\n50%\n");
+
+    // 没有正文字段也能存，只有标题
+    CHECK(uploadEverySplit(URLENCODED, "title=only") == "only\n");
+}
+
+static void testMultipart()
+{
+    const std::string body =
+        "--XyZ\r\nContent-Disposition: form-data; name=\"title\"\r\n\r\n日记\r\n"
+        "--XyZ\r\nContent-Disposition: form-data; name=\"content\"\r\n\r\nline1\r\n--Xy\r\nline2\r\n"
+        "--XyZ\r\nContent-Disposition: form-data; name=\"file\"; filename=\"a.txt\"\r\n"
+        "Content-Type: text/plain\r\n\r\n%41\r\n\r\n"
+        "--XyZ--\r\n";
+    CHECK(uploadEverySplit("multipart/form-data; boundary=XyZ", body)
+        == "日记\nline1\r\n--Xy\r\nline2\n|a.txt=%41\r\n");
+
+    // 分隔符后面跟了别的字符
+    CHECK(uploadEverySplit("multipart/form-data; boundary=b",
+        "--b\r\nContent-Disposition: form-data; name=\"title\"\r\n\r\nx\r\n--bb\r\n")
+        == "<write failed>");
+    // 没有结束标记
+    CHECK(uploadEverySplit("multipart/form-data; boundary=b",
+        "--b\r\nContent-Disposition: form-data; name=\"title\"\r\n\r\nx")
+        == "<finish failed>");
+}
+
+int main()
+{
+    CHECK(!DiaryUpload::create(".", "text/plain"));
+    testUrlEncoded();
+    testMultipart();
+    fs::remove_all(fs::temp_directory_path() / "footprints-upload");
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all diary upload tests passed\n");
+    return 0;
+}
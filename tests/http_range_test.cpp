@@ -0,0 +1,298 @@
+﻿/**
+* @file http_range_test.cpp
+* @brief Range 测试：格式不对、多段、后缀段的解析，以及 206 / 416 / If-Range 响应；多段响应用 multipart 解析器在每个位置切开读回来
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "http/http_range.h"
+#include "http/multipart_parser.h"
+#include "comm/http_date.h"
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <initializer_list>
+#include <memory>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); ++g_failures; } } while (0)
+
+using Ranges = std::vector<std::pair<uint64_t, uint64_t>>;
+
+static bool parsesTo(std::string_view value, uint64_t size, RangeParse expected, const Ranges& ranges = {})
+{
+    // Ignore 时调用方不看 ranges，解析到一半的段不用清掉
+    RangeSet set;
+    RangeParse result = parseRange(value, size, set);
+    if (result != expected || (expected != RangeParse::Ignore && set.count != ranges.size()))
+    {
+        std::printf("parseRange(\"%.*s\", %llu) gave %d with %zu range(s)\n", static_cast<int>(value.size()), value.data(),
+            static_cast<unsigned long long>(size), static_cast<int>(result), set.count);
+        return false;
+    }
+    for (size_t i = 0; i < ranges.size(); ++i)
+    {
+        if (set.items[i].first != ranges[i].first || set.items[i].last != ranges[i].second)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+static void testSingle()
+{
+    CHECK(parsesTo("bytes=0-99", 1000, RangeParse::Satisfiable, { { 0, 99 } }));
+    CHECK(parsesTo("bytes=999-999", 1000, RangeParse::Satisfiable, { { 999, 999 } }));
+    CHECK(parsesTo("bytes=900-", 1000, RangeParse::Satisfiable, { { 900, 999 } }));
+    CHECK(parsesTo("bytes=990-5000", 1000, RangeParse::Satisfiable, { { 990, 999 } }));
+    CHECK(parsesTo("  BYTES=0-0\t", 1000, RangeParse::Satisfiable, { { 0, 0 } }));
+}
+
+static void testSuffix()
+{
+    CHECK(parsesTo("bytes=-100", 1000, RangeParse::Satisfiable, { { 900, 999 } }));
+    CHECK(parsesTo("bytes=-1000", 1000, RangeParse::Satisfiable, { { 0, 999 } }));
+    CHECK(parsesTo("bytes=-5000", 1000, RangeParse::Satisfiable, { { 0, 999 } }));
+    // 最后 0 个字节、空文件的后缀，都落不到文件里
+    CHECK(parsesTo("bytes=-0", 1000, RangeParse::Unsatisfiable));
+    CHECK(parsesTo("bytes=-5", 0, RangeParse::Unsatisfiable));
+}
+
+static void testMulti()
+{
+    CHECK(parsesTo("bytes=0-0,-1", 1000, RangeParse::Satisfiable, { { 0, 0 }, { 999, 999 } }));
+    CHECK(parsesTo("bytes=500-599, 0-99 ,900-", 1000, RangeParse::Satisfiable, { { 500, 599 }, { 0, 99 }, { 900, 999 } }));
+    // 多余的逗号跳过，落在文件外的段丢掉
+    CHECK(parsesTo("bytes=,0-1,, ,2000-3000,-2,", 1000, RangeParse::Satisfiable, { { 0, 1 }, { 998, 999 } }));
+    CHECK(parsesTo("bytes=1000-,2000-3000", 1000, RangeParse::Unsatisfiable));
+    CHECK(parsesTo("bytes=0-", 0, RangeParse::Unsatisfiable));
+
+    // 段数上限以内照常，超过了当作普通请求
+    std::string value = "bytes=0-0";
+    for (size_t i = 1; i < RangeSet::MAX_RANGES; ++i)
+    {
+        value += "," + std::to_string(i * 10) + "-" + std::to_string(i * 10);
+    }
+    RangeSet set;
+    CHECK(parseRange(value, 1000, set) == RangeParse::Satisfiable && set.count == RangeSet::MAX_RANGES);
+    CHECK(parsesTo(value + ",500-500", 1000, RangeParse::Ignore));
+
+    // 重叠的段加起来超过文件两倍，不放大响应
+    CHECK(parsesTo("bytes=0-,0-,0-", 1000, RangeParse::Ignore));
+    CHECK(parsesTo("bytes=0-,0-", 1000, RangeParse::Satisfiable, { { 0, 999 }, { 0, 999 } }));
+}
+
+static void testMalformed()
+{
+    for (const char* value : { "", "bytes", "bytes=", "bytes=,", "items=0-1", "bytes 0-1", "bytes=abc", "bytes=1",
+        "bytes=5-4", "bytes=-", "bytes=--1", "bytes=0-1,x", "bytes=1-2-3", "bytes=+1-2", "bytes=0x10-20",
+        "bytes=0 - 1", "bytes=-1.5", "bytes=99999999999999999999-", "bytes=0-99999999999999999999" })
+    {
+        CHECK(parsesTo(value, 1000, RangeParse::Ignore));
+    }
+}
+
+// 响应正文不管是单段、多段、内存还是文件，都拼成一个字符串
+static std::string bodyOf(const HttpResponse& res)
+{
+    std::string out;
+    auto appendChunk = [&out](const std::shared_ptr<FileRegion>& file, std::string_view memory)
+        {
+            std::string data;
+            if (file)
+            {
+                CHECK(file->readAll(data));
+                memory = data;
+            }
+            out.append(memory);
+        };
+    if (res.parts)
+    {
+        for (const OutputChunk& chunk : res.parts->chunks())
+        {
+            appendChunk(chunk.file, chunk.memory());
+        }
+    }
+    else
+    {
+        appendChunk(res.file, res.shared.owner ? res.shared.bytes : std::string_view(res.body));
+    }
+    return out;
+}
+
+static const std::string& content()
+{
+    static const std::string text = []()
+        {
+            std::string s;
+            for (int i = 0; s.size() < 1000; ++i)
+            {
+                s += std::to_string(i) + ",";
+            }
+            s.resize(1000);
+            return s;
+        }();
+    return text;
+}
+
+static void sharedResponse(HttpResponse& res)
+{
+    auto owner = std::make_shared<std::string>(content());
+    res.setShared(SharedBuffer{ owner, *owner }, "text/plain");
+    res.setHeader(HttpHeader::ETag, "\"v1\"");
+    res.setHeader(HttpHeader::LastModified, formatHttpDate(1700000000));
+}
+
+static void request(HttpRequest& req, std::string_view range, std::string_view if_range = {})
+{
+    req.method = "GET";
+    req.headers.set(HttpHeader::Range, range);
+    if (!if_range.empty())
+    {
+        req.headers.set(HttpHeader::IfRange, if_range);
+    }
+}
+
+static void testSingleResponse()
+{
+    HttpRequest req;
+    request(req, "bytes=-10");
+    HttpResponse res;
+    sharedResponse(res);
+    applyRange(req, res);
+    CHECK(res.status == HttpStatus::PartialContent);
+    CHECK(res.headers.get(HttpHeader::AcceptRanges) == "bytes");
+    CHECK(res.headers.get(HttpHeader::ContentRange) == "bytes 990-999/1000");
+    CHECK(res.headers.get(HttpHeader::ContentLength) == "10");
+    CHECK(bodyOf(res) == content().substr(990));
+
+    // 文件正文切的是文件区间
+    fs::path path = fs::temp_directory_path() / "footprints-range";
+    std::ofstream(path, std::ios::binary) << content();
+    HttpResponse file_res;
+    file_res.setFile(FileRegion::open(path.string()), "text/plain");
+    HttpRequest file_req;
+    request(file_req, "bytes=100-199");
+    applyRange(file_req, file_res);
+    CHECK(file_res.status == HttpStatus::PartialContent);
+    CHECK(file_res.headers.get(HttpHeader::ContentRange) == "bytes 100-199/1000");
+    CHECK(bodyOf(file_res) == content().substr(100, 100));
+    fs::remove(path);
+}
+
+// 多段响应按 multipart 读回来，正文在每个位置切成两段喂，结果都要是请求的那几段
+static void testMultiResponse()
+{
+    HttpRequest req;
+    request(req, "bytes=0-9, 500-509, -5");
+    HttpResponse res;
+    sharedResponse(res);
+    applyRange(req, res);
+    CHECK(res.status == HttpStatus::PartialContent);
+    CHECK(!res.headers.has(HttpHeader::ContentRange));
+
+    std::string_view type = res.headers.get(HttpHeader::ContentType);
+    const std::string_view prefix = "multipart/byteranges; boundary=";
+    CHECK(type.starts_with(prefix));
+    std::string boundary(type.substr(prefix.size()));
+    std::string body = bodyOf(res);
+    CHECK(res.headers.get(HttpHeader::ContentLength) == std::to_string(body.size()));
+    CHECK(body.find("Content-Range: bytes 0-9/1000\r\n") != std::string::npos);
+    CHECK(body.find("Content-Range: bytes 500-509/1000\r\n") != std::string::npos);
+    CHECK(body.find("Content-Range: bytes 995-999/1000\r\n") != std::string::npos);
+
+    const std::string expected = "[text/plain]" + content().substr(0, 10) + "<end>" +
+        "[text/plain]" + content().substr(500, 10) + "<end>" +
+        "[text/plain]" + content().substr(995) + "<end>";
+    for (size_t cut = 0; cut <= body.size(); ++cut)
+    {
+        MultipartParser parser(boundary);
+        std::string events;
+        parser.onPartBegin = [&](const MultipartParser::Part& part) { events += "[" + part.content_type + "]"; return true; };
+        parser.onPartData = [&](std::string_view data) { events.append(data); return true; };
+        parser.onPartEnd = [&]() { events += "<end>"; return true; };
+        bool ok = parser.feed(std::string_view(body).substr(0, cut)) && parser.feed(std::string_view(body).substr(cut));
+        if (!ok || !parser.finish() || events != expected)
+        {
+            std::printf("byteranges split at %zu: %s\n", cut, events.c_str());
+            ++g_failures;
+        }
+    }
+}
+
+static void testUnsatisfiable()
+{
+    HttpRequest req;
+    request(req, "bytes=1000-");
+    HttpResponse res;
+    sharedResponse(res);
+    applyRange(req, res);
+    CHECK(res.status == HttpStatus::RangeNotSatisfiable);
+    CHECK(res.headers.get(HttpHeader::ContentRange) == "bytes */1000");
+    CHECK(res.headers.get(HttpHeader::ContentLength) == "0");
+    CHECK(!res.headers.has(HttpHeader::ContentType));
+    CHECK(bodyOf(res).empty());
+}
+
+// 格式不对、If-Range 对不上、不是 GET：都回完整的 200
+static void testFullResponse()
+{
+    struct Case
+    {
+        const char* method;
+        const char* range;
+        std::string if_range;
+        bool partial;
+    };
+    const Case cases[] = {
+        { "GET", "bytes=0-9", "\"v1\"", true },
+        { "GET", "bytes=0-9", formatHttpDate(1700000000), true },
+        { "GET", "bytes=0-9", "\"v2\"", false },
+        { "GET", "bytes=0-9", "W/\"v1\"", false },
+        { "GET", "bytes=0-9", formatHttpDate(1700000001), false },
+        { "GET", "bytes=0-9", "yesterday", false },
+        { "GET", "bytes=9-0", "", false },
+        { "GET", "lines=0-9", "", false },
+        { "HEAD", "bytes=0-9", "", false },
+    };
+    for (const Case& c : cases)
+    {
+        HttpRequest req;
+        request(req, c.range, c.if_range);
+        req.method = c.method;
+        HttpResponse res;
+        sharedResponse(res);
+        applyRange(req, res);
+        CHECK(res.headers.get(HttpHeader::AcceptRanges) == "bytes");
+        CHECK((res.status == HttpStatus::PartialContent) == c.partial);
+        CHECK(bodyOf(res) == (c.partial ? content().substr(0, 10) : content()));
+    }
+}
+
+int main()
+{
+    testSingle();
+    testSuffix();
+    testMulti();
+    testMalformed();
+    testSingleResponse();
+    testMultiResponse();
+    testUnsatisfiable();
+    testFullResponse();
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all range tests passed\n");
+    return 0;
+}
@@ -0,0 +1,157 @@
+﻿/**
+* @file json_writer_test.cpp
+* @brief JSON 字符串转义测试：转义、多字节字符原样输出、不合法的 UTF-8 换成替换字符，向量扫描和逐字节的写法结果一致
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "comm/json_writer.h"
+#include <cstdio>
+#include <random>
+#include <string>
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); ++g_failures; } } while (0)
+
+static std::string quoted(std::string_view text)
+{
+    std::string out;
+    appendJsonString(out, text);
+    return out;
+}
+
+// 逐字节解码的参照实现，和被测的写法无关：按码点判断合法性，而不是按首字节查表
+static std::string reference(std::string_view text)
+{
+    static constexpr char HEX[] = "0123456789abcdef";
+    std::string out = "\"";
+    size_t i = 0;
+    while (i < text.size())
+    {
+        unsigned char c = static_cast<unsigned char>(text[i]);
+        if (c < 0x80)
+        {
+            if (c == '"') out += "\\\"";
+            else if (c == '\\') out += "\\\\";
+            else if (c == '\n') out += "\\n";
+            else if (c == '\r') out += "\\r";
+            else if (c == '\t') out += "\\t";
+            else if (c == '\b') out += "\\b";
+            else if (c == '\f') out += "\\f";
+            else if (c < 0x20) { out += "\\u00"; out += HEX[c >> 4]; out += HEX[c & 15]; }
+            else out += static_cast<char>(c);
+            ++i;
+            continue;
+        }
+
+        size_t n = c >= 0xf0 ? 4 : c >= 0xe0 ? 3 : c >= 0xc0 ? 2 : 0;
+        unsigned code = n == 4 ? c & 0x07 : n == 3 ? c & 0x0f : c & 0x1f;
+        bool ok = n != 0 && i + n <= text.size();
+        for (size_t k = 1; ok && k < n; ++k)
+        {
+            unsigned char next = static_cast<unsigned char>(text[i + k]);
+            ok = (next & 0xc0) == 0x80;
+            code = (code << 6) | (next & 0x3f);
+        }
+        unsigned min = n == 4 ? 0x10000 : n == 3 ? 0x800 : 0x80;
+        ok = ok && code >= min && code <= 0x10ffff && !(code >= 0xd800 && code <= 0xdfff);
+        if (ok)
+        {
+            out.append(text.substr(i, n));
+            i += n;
+        }
+        else
+        {
+            out += "\\ufffd";
+            ++i;
+        }
+    }
+    return out + "\"";
+}
+
+static void testEscapes()
+{
+    CHECK(quoted("") == "\"\"");
+    CHECK(quoted("plain") == "\"plain\"");
+    CHECK(quoted("a\"b\\c") == "\"a\\\"b\\\\c\"");
+    CHECK(quoted("line\nnext\r\t") == "\"line\\nnext\\r\\t\"");
+    CHECK(quoted(std::string_view("\x01\x1f\0", 3)) == "\"\\u0001\\u001f\\u0000\"");
+    CHECK(quoted("\x7f") == "\"\x7f\"");
+}
+
+static void testUtf8()
+{
+    // 合法的多字节字符原样输出，前后的 ASCII 不受影响
+    CHECK(quoted("日记") == "\"日记\"");
+    CHECK(quoted("a日b记c") == "\"a日b记c\"");
+    CHECK(quoted("é€😀") == "\"é€😀\"");
+    CHECK(quoted("\xef\xbf\xbf\xf4\x8f\xbf\xbf") == "\"\xef\xbf\xbf\xf4\x8f\xbf\xbf\"");
+
+    // 不合法的字节一个换一个
+    CHECK(quoted("\x80") == "\"\\ufffd\"");
+    CHECK(quoted("a\xff" "b") == "\"a\\ufffdb\"");
+    CHECK(quoted("\xc0\x80") == "\"\\ufffd\\ufffd\"");             // 过长编码
+    CHECK(quoted("\xe0\x80\x80") == "\"\\ufffd\\ufffd\\ufffd\"");   // 过长编码
+    CHECK(quoted("\xed\xa0\x80") == "\"\\ufffd\\ufffd\\ufffd\"");   // 代理区
+    CHECK(quoted("\xf4\x90\x80\x80") == "\"\\ufffd\\ufffd\\ufffd\\ufffd\"");   // 超过 U+10FFFF
+    CHECK(quoted("\xf5\x80") == "\"\\ufffd\\ufffd\"");
+    CHECK(quoted("日\xe6\x97") == "\"日\\ufffd\\ufffd\"");          // 截断在字符中间
+    CHECK(quoted("\xe6\x97" "a") == "\"\\ufffd\\ufffda\"");
+}
+
+// 向量扫描一次 16/32 字节，特殊字节落在块的各个位置、跨过块边界都要和参照实现一样
+static void testAgainstReference()
+{
+    static const char* PIECES[] = { "a", "\"", "\\", "\n", "\x01", "日", "é", "😀", "\x80", "\xe6\x97", "\xc0", "\xed\xa0\x80", "\xf4\x90" };
+
+    for (size_t pad = 0; pad < 40; ++pad)
+    {
+        for (const char* piece : PIECES)
+        {
+            std::string text = std::string(pad, 'x') + piece + std::string(40 - pad, 'y');
+            CHECK(quoted(text) == reference(text));
+        }
+    }
+
+    std::mt19937 rng(12345);
+    for (int round = 0; round < 2000; ++round)
+    {
+        std::string text;
+        size_t length = rng() % 100;
+        while (text.size() < length)
+        {
+            if (rng() % 4 == 0)
+            {
+                text += static_cast<char>(rng() % 256);
+            }
+            else
+            {
+                text += PIECES[rng() % (sizeof(PIECES) / sizeof(PIECES[0]))];
+            }
+        }
+        std::string got = quoted(text);
+        std::string want = reference(text);
+        CHECK(got == want);
+        if (got != want)
+        {
+            break;
+        }
+    }
+}
+
+int main()
+{
+    testEscapes();
+    testUtf8();
+    testAgainstReference();
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all json writer tests passed\n");
+    return 0;
+}
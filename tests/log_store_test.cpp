@@ -0,0 +1,273 @@
+﻿/**
+* @file log_store_test.cpp
+* @brief 日志存储测试：索引之后追加的记录重放、末尾写了一半的记录、CRC 不对、删除标记、压缩之后重新打开
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "diary/log_store.h"
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <thread>
+
+namespace fs = std::filesystem;
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); ++g_failures; } } while (0)
+
+// 和 log_store.cpp 里的记录头一致，测试自己拼坏记录用
+struct RawHeader
+{
+    uint32_t magic = 0x43525046;
+    uint32_t crc = 0;
+    uint32_t type = 1;
+    uint32_t name_size = 0;
+    uint64_t body_size = 0;
+    int64_t mtime = 0;
+};
+static_assert(sizeof(RawHeader) == 32, "record header layout");
+
+static fs::path freshRoot(const char* name)
+{
+    fs::path root = fs::temp_directory_path() / (std::string("footprints-log-") + name);
+    fs::remove_all(root);
+    fs::create_directories(root);
+    return root;
+}
+
+static fs::path segmentPath(const fs::path& root, int id)
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "%06d.seg", id);
+    return root / ".store" / name;
+}
+
+static bool putDiary(LogDiaryStore& store, const fs::path& root, const std::string& name, const std::string& text)
+{
+    fs::path temp = root / ".upload-test";
+    std::ofstream(temp, std::ios::binary) << text;
+    return store.commit(name, temp.string());
+}
+
+static std::string readDiary(const LogDiaryStore& store, const std::string& name)
+{
+    std::string text;
+    return store.read(name, text) ? text : "<missing>";
+}
+
+static std::string readFile(const fs::path& path)
+{
+    std::ifstream in(path, std::ios::binary);
+    return std::string(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+}
+
+static void writeFile(const fs::path& path, const std::string& data)
+{
+    std::ofstream(path, std::ios::binary | std::ios::trunc) << data;
+}
+
+// 索引文件是打开时存的，之后的提交只在段文件里，重新打开要靠重放找回来
+static void testReplayAfterIndex()
+{
+    fs::path root = freshRoot("replay");
+    std::string saved_index;
+    {
+        LogDiaryStore store;
+        CHECK(store.open(root.string()));
+        CHECK(putDiary(store, root, "a", "first"));
+        saved_index = readFile(root / ".store" / "index");
+        CHECK(putDiary(store, root, "b", "second"));
+        CHECK(putDiary(store, root, "a", "first, edited"));
+        CHECK(store.remove("b"));
+        CHECK(putDiary(store, root, "c", "third"));
+    }
+    // 回到只覆盖了 a 的旧索引，好像之后没来得及存索引就断电了
+    writeFile(root / ".store" / "index", saved_index);
+
+    LogDiaryStore store;
+    CHECK(store.open(root.string()));
+    CHECK(store.list().size() == 2);
+    CHECK(readDiary(store, "a") == "first, edited");
+    CHECK(readDiary(store, "b") == "<missing>");
+    CHECK(readDiary(store, "c") == "third");
+    store.close();
+    fs::remove_all(root);
+}
+
+// 最后一个段末尾写了一半的记录要截掉，之前的都还在，之后还能接着写
+static void testTornTail()
+{
+    fs::path root = freshRoot("torn");
+    {
+        LogDiaryStore store;
+        CHECK(store.open(root.string()));
+        CHECK(putDiary(store, root, "a", "kept"));
+    }
+    fs::path segment = segmentPath(root, 1);
+    uintmax_t good_size = fs::file_size(segment);
+
+    // 头部说名字有 100 字节、正文大得离谱，段里却只剩头部本身
+    RawHeader header;
+    header.name_size = 100;
+    header.body_size = uint64_t(1) << 40;
+    std::string torn(reinterpret_cast<const char*>(&header), sizeof(header));
+    for (bool with_index : { true, false })
+    {
+        std::ofstream(segment, std::ios::binary | std::ios::app) << torn << "partial";
+        if (!with_index)
+        {
+            fs::remove(root / ".store" / "index");
+        }
+        LogDiaryStore store;
+        CHECK(store.open(root.string()));
+        CHECK(fs::file_size(segment) == good_size);
+        CHECK(store.list().size() == 1);
+        CHECK(readDiary(store, "a") == "kept");
+    }
+
+    {
+        LogDiaryStore store;
+        CHECK(store.open(root.string()));
+        CHECK(putDiary(store, root, "b", "after"));
+    }
+    LogDiaryStore store;
+    CHECK(store.open(root.string()));
+    CHECK(readDiary(store, "a") == "kept");
+    CHECK(readDiary(store, "b") == "after");
+    store.close();
+    fs::remove_all(root);
+}
+
+// 正文改了一个字节：有索引时读那一篇失败，没有索引时扫描停在那里，坏记录及其之后都不认
+static void testCrcMismatch()
+{
+    fs::path root = freshRoot("crc");
+    {
+        LogDiaryStore store;
+        CHECK(store.open(root.string()));
+        CHECK(putDiary(store, root, "a", "good body"));
+        CHECK(putDiary(store, root, "b", "bad body"));
+    }
+    fs::path segment = segmentPath(root, 1);
+    std::string data = readFile(segment);
+    size_t at = data.find("bad body");
+    CHECK(at != std::string::npos);
+    data[at] = 'B';
+    writeFile(segment, data);
+
+    {
+        LogDiaryStore store;
+        CHECK(store.open(root.string()));
+        CHECK(readDiary(store, "a") == "good body");
+        CHECK(readDiary(store, "b") == "<missing>");
+    }
+
+    fs::remove(root / ".store" / "index");
+    LogDiaryStore store;
+    CHECK(store.open(root.string()));
+    CHECK(store.list().size() == 1);
+    CHECK(readDiary(store, "a") == "good body");
+    CHECK(fs::file_size(segment) == at - sizeof(RawHeader) - 1);
+    store.close();
+    fs::remove_all(root);
+}
+
+// 删除标记：没有索引文件从头扫描时，删掉的日记不能复活
+static void testTombstones()
+{
+    fs::path root = freshRoot("tombstone");
+    {
+        LogDiaryStore store;
+        CHECK(store.open(root.string()));
+        CHECK(putDiary(store, root, "a", "deleted"));
+        CHECK(putDiary(store, root, "b", "kept"));
+        CHECK(store.remove("a"));
+        CHECK(!store.remove("a"));
+        CHECK(!store.remove("never"));
+        DiaryStat stat;
+        CHECK(!store.stat("a", stat));
+    }
+
+    for (bool with_index : { true, false })
+    {
+        if (!with_index)
+        {
+            fs::remove(root / ".store" / "index");
+        }
+        LogDiaryStore store;
+        CHECK(store.open(root.string()));
+        CHECK(store.list().size() == 1);
+        CHECK(readDiary(store, "a") == "<missing>");
+        CHECK(readDiary(store, "b") == "kept");
+    }
+    fs::remove_all(root);
+}
+
+// 段 1 写满后大半是垃圾，后台把活着的记录搬到段 2 再删掉段 1；重新打开（有没有索引都一样）结果不变
+static void testCompactionThenReopen()
+{
+    fs::path root = freshRoot("compact");
+    {
+        LogDiaryStore store;
+        CHECK(store.open(root.string()));
+        CHECK(putDiary(store, root, "a", std::string(10000, 'x')));
+        CHECK(putDiary(store, root, "b", "kept"));
+        CHECK(putDiary(store, root, "c", "old version"));
+        CHECK(putDiary(store, root, "c", "new version"));
+        CHECK(store.remove("a"));
+    }
+    // 段 1 之后放一个空的段 2，段 1 就不再是正在写的段。删掉索引，重放时发现垃圾会请求压缩
+    writeFile(segmentPath(root, 2), "");
+    fs::remove(root / ".store" / "index");
+    {
+        LogDiaryStore store;
+        CHECK(store.open(root.string()));
+        auto deadline = std::chrono::steady_clock::now() + std::chrono::seconds(10);
+        while (fs::exists(segmentPath(root, 1)) && std::chrono::steady_clock::now() < deadline)
+        {
+            std::this_thread::sleep_for(std::chrono::milliseconds(10));
+        }
+        CHECK(!fs::exists(segmentPath(root, 1)));
+        CHECK(fs::file_size(segmentPath(root, 2)) < 10000);
+        CHECK(readDiary(store, "b") == "kept");
+        CHECK(readDiary(store, "c") == "new version");
+    }
+
+    for (bool with_index : { true, false })
+    {
+        if (!with_index)
+        {
+            fs::remove(root / ".store" / "index");
+        }
+        LogDiaryStore store;
+        CHECK(store.open(root.string()));
+        CHECK(store.list().size() == 2);
+        CHECK(readDiary(store, "a") == "<missing>");
+        CHECK(readDiary(store, "b") == "kept");
+        CHECK(readDiary(store, "c") == "new version");
+    }
+    fs::remove_all(root);
+}
+
+int main()
+{
+    testReplayAfterIndex();
+    testTornTail();
+    testCrcMismatch();
+    testTombstones();
+    testCompactionThenReopen();
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all log store tests passed\n");
+    return 0;
+}
@@ -0,0 +1,196 @@
+﻿/**
+* @file multipart_parser_test.cpp
+* @brief multipart/form-data 解析测试：同一份正文在每个位置切成两段、逐字节喂，结果都要和一次喂完一样
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "http/multipart_parser.h"
+#include <cstdio>
+#include <string>
+#include <vector>
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); ++g_failures; } } while (0)
+
+struct ParseResult
+{
+    bool fed = true;        // 每次 feed 都返回 true
+    bool finished = false;
+    std::string events;     // 回调按顺序记下来，字段内容拼在一起，和分几次交出无关
+
+    bool operator==(const ParseResult&) const = default;
+};
+
+// 在 cuts 给出的位置把 body 切开依次喂给解析器
+static ParseResult parse(std::string_view boundary, std::string_view body, const std::vector<size_t>& cuts)
+{
+    ParseResult result;
+    MultipartParser parser(boundary);
+    parser.onPartBegin = [&](const MultipartParser::Part& part)
+        {
+            result.events += "[" + part.name + "|" + part.filename + "|" + part.content_type + "]";
+            return true;
+        };
+    parser.onPartData = [&](std::string_view data)
+        {
+            result.events.append(data);
+            return true;
+        };
+    parser.onPartEnd = [&]()
+        {
+            result.events += "<end>";
+            return true;
+        };
+
+    size_t begin = 0;
+    for (size_t cut : cuts)
+    {
+        result.fed = parser.feed(body.substr(begin, cut - begin)) && result.fed;
+        begin = cut;
+    }
+    result.fed = parser.feed(body.substr(begin)) && result.fed;
+    result.finished = parser.finish();
+    return result;
+}
+
+// 一次喂完、每个位置切一刀、逐字节喂，三种结果必须一样；返回一次喂完的结果
+static ParseResult parseEverySplit(std::string_view boundary, std::string_view body)
+{
+    ParseResult whole = parse(boundary, body, {});
+    for (size_t cut = 0; cut <= body.size(); ++cut)
+    {
+        ParseResult split = parse(boundary, body, { cut });
+        if (!(split == whole))
+        {
+            std::printf("split at %zu differs: %s\n", cut, split.events.c_str());
+            ++g_failures;
+        }
+    }
+    std::vector<size_t> bytes;
+    for (size_t i = 1; i < body.size(); ++i)
+    {
+        bytes.push_back(i);
+    }
+    CHECK(parse(boundary, body, bytes) == whole);
+    return whole;
+}
+
+static void testForm()
+{
+    // 前言和结尾后面的内容都要丢掉；正文里有 CRLF、"--" 和分隔符的前缀，都不能当成分隔符
+    const std::string body =
+        "preamble\r\n"
+        "--XyZ\r\n"
+        "Content-Disposition: form-data; name=\"title\"\r\n"
+        "\r\n"
+        "日记\r\n"
+        "--XyZ  \r\n"
+        "Content-Disposition: form-data; name=\"content\"\r\n"
+        "\r\n"
+        "line1\r\nline2\r\n--XyY\r\n--Xy\r\n-\r\n"
+        "--XyZ\r\n"
+        "content-disposition: form-data; name=file; filename=\"a b.txt\"\r\n"
+        "Content-Type: text/plain\r\n"
+        "\r\n"
+        "\r\n\r\nattached\r\n"
+        "--XyZ\r\n"
+        "\r\n"
+        "no headers\r\n"
+        "--XyZ--\r\n"
+        "epilogue --XyZ\r\n";
+
+    ParseResult result = parseEverySplit("XyZ", body);
+    CHECK(result.fed);
+    CHECK(result.finished);
+    CHECK(result.events ==
+        "[title||]日记<end>"
+        "[content||]line1\r\nline2\r\n--XyY\r\n--Xy\r\n-<end>"
+        "[file|a b.txt|text/plain]\r\n\r\nattached<end>"
+        "[||]no headers<end>");
+}
+
+// 字段内容为空、紧挨着下一个分隔符
+static void testEmptyParts()
+{
+    const std::string body =
+        "--b\r\nContent-Disposition: form-data; name=\"a\"\r\n\r\n"
+        "\r\n--b\r\nContent-Disposition: form-data; name=\"b\"\r\n\r\n"
+        "\r\n--b--";
+    ParseResult result = parseEverySplit("b", body);
+    CHECK(result.fed);
+    CHECK(result.finished);
+    CHECK(result.events == "[a||]<end>[b||]<end>");
+}
+
+static void testMalformed()
+{
+    // 分隔符后面跟了别的字符
+    ParseResult result = parseEverySplit("b", "--b\r\nContent-Disposition: form-data; name=\"a\"\r\n\r\nx\r\n--bx\r\n\r\ny\r\n--b--\r\n");
+    CHECK(!result.fed);
+    CHECK(!result.finished);
+
+    // 字段头没有冒号
+    result = parseEverySplit("b", "--b\r\nContent-Disposition form-data\r\n\r\nx\r\n--b--\r\n");
+    CHECK(!result.fed);
+    CHECK(!result.finished);
+    CHECK(result.events.empty());
+
+    // 没有结束标记：每段都喂成功了，但 finish 不认
+    result = parseEverySplit("b", "--b\r\nContent-Disposition: form-data; name=\"a\"\r\n\r\ntruncated");
+    CHECK(result.fed);
+    CHECK(!result.finished);
+
+    // 字段头太长
+    std::string long_header = "--b\r\nX-Long: " + std::string(MultipartParser::MAX_PART_HEADER_BYTES, 'h') + "\r\n\r\nx\r\n--b--\r\n";
+    CHECK(!parse("b", long_header, {}).fed);
+    CHECK(!parse("b", long_header, { 100, 5000 }).fed);
+
+    // 分隔符为空或超长，解析器一开始就是失败状态
+    CHECK(!parse("", "--\r\n\r\n--", {}).fed);
+    CHECK(!parse(std::string(MultipartParser::MAX_BOUNDARY_BYTES + 1, 'b'), "", {}).fed);
+}
+
+// 回调返回 false 时停下，之后的 feed 都失败
+static void testCallbackStops()
+{
+    MultipartParser parser("b");
+    int parts = 0;
+    parser.onPartBegin = [&](const MultipartParser::Part&) { return ++parts < 2; };
+    parser.onPartData = [](std::string_view) { return true; };
+    parser.onPartEnd = []() { return true; };
+    CHECK(parser.feed("--b\r\n\r\none\r\n"));
+    CHECK(!parser.feed("--b\r\n\r\ntwo\r\n"));
+    CHECK(!parser.feed("--b--\r\n"));
+    CHECK(!parser.finish());
+    CHECK(parts == 2);
+}
+
+static void testBoundaryOf()
+{
+    CHECK(MultipartParser::boundaryOf("multipart/form-data; boundary=abc") == "abc");
+    CHECK(MultipartParser::boundaryOf("Multipart/Form-Data ; charset=utf-8; Boundary=\"a b;c\"") == "a b;c");
+    CHECK(MultipartParser::boundaryOf("multipart/form-data;boundary=abc; charset=utf-8") == "abc");
+    CHECK(MultipartParser::boundaryOf("multipart/form-data").empty());
+    CHECK(MultipartParser::boundaryOf("multipart/mixed; boundary=abc").empty());
+    CHECK(MultipartParser::boundaryOf("application/x-www-form-urlencoded").empty());
+}
+
+int main()
+{
+    testForm();
+    testEmptyParts();
+    testMalformed();
+    testCallbackStops();
+    testBoundaryOf();
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all multipart parser tests passed\n");
+    return 0;
+}
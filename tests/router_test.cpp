@@ -0,0 +1,166 @@
+﻿/**
+* @file router_test.cpp
+* @brief 路由测试：有公共前缀的路由按不同顺序注册，边被拆开之后各自还能匹配到，流式接收正文的工厂也不丢
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "router/router.h"
+#include <cstdio>
+#include <string>
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); ++g_failures; } } while (0)
+
+// 每个处理函数把自己的名字写进响应正文，用来判断匹配到了谁
+static Handler named(const char* name)
+{
+    return [name](const HttpRequest&, HttpResponse& res) { res.body = name; };
+}
+
+// 接收器什么都不做，创建时把名字记下来，用来判断拿到的是哪条路由的工厂
+static std::string g_stream_created;
+
+class NullSink : public BodySink
+{
+public:
+    bool write(std::string_view) override { return true; }
+    bool finish() override { return true; }
+};
+
+static BodyStreamFactory streamTo(const char* name)
+{
+    return [name](const HttpRequest&)
+    {
+        g_stream_created = name;
+        return std::make_unique<NullSink>();
+    };
+}
+
+// 匹配 method path，返回处理函数的名字，没匹配到返回空
+static std::string routeTo(const char* method, const char* path, HttpRequest& req)
+{
+    req.method = method;
+    req.path = path;
+    HttpResponse res;
+    return Router::getInstance().route(req, res) ? res.body : std::string();
+}
+
+static std::string routeTo(const char* method, const char* path)
+{
+    HttpRequest req;
+    return routeTo(method, path, req);
+}
+
+// Router 是单例，注册完才能冻结，所以每组用例用自己的方法名占一棵树，互不影响
+static void registerRoutes()
+{
+    Router& router = Router::getInstance();
+
+    // 短的先注册，后来的长路由接在它下面
+    router.registerRoute("SHORT", "/diary", named("diary"));
+    router.registerRoute("SHORT", "/diaries", named("diaries"));
+    router.registerRoute("SHORT", "/diary/:name", named("view"));
+
+    // 长的先注册，后来的短路由把边从中间拆开
+    router.registerRoute("LONG", "/diaries", named("diaries"));
+    router.registerRoute("LONG", "/diary/:name", named("view"));
+    router.registerRoute("LONG", "/diary", named("diary"));
+    router.registerRoute("LONG", "/", named("home"));
+    router.registerRoute("LONG", "/delete/:name", named("delete"));
+
+    // 静态、参数、通配挂在同一个节点下
+    router.registerRoute("MIXED", "/api/diaries", named("list"));
+    router.registerRoute("MIXED", "/api/diaries/:name", named("get"));
+    router.registerRoute("MIXED", "/api/diaries/export", named("export"));
+    router.registerRoute("MIXED", "/api/*rest", named("fallback"));
+
+    // 两个写日记的入口都流式接收正文，注册顺序和 main.cpp 里包含处理函数头文件的顺序一样
+    router.registerRoute("POST", "/post_write", named("post_write"), streamTo("post_write"));
+    router.registerRoute("POST", "/api/diaries", named("api_create"), streamTo("api_create"));
+
+    router.freeze();
+}
+
+static void testShortFirst()
+{
+    CHECK(routeTo("SHORT", "/diary") == "diary");
+    CHECK(routeTo("SHORT", "/diaries") == "diaries");
+    CHECK(routeTo("SHORT", "/diary/a") == "view");
+    CHECK(routeTo("SHORT", "/diar").empty());
+    CHECK(routeTo("SHORT", "/diaryx").empty());
+    CHECK(routeTo("SHORT", "/diary/").empty());
+}
+
+static void testLongFirst()
+{
+    CHECK(routeTo("LONG", "/") == "home");
+    CHECK(routeTo("LONG", "/diary") == "diary");
+    CHECK(routeTo("LONG", "/diaries") == "diaries");
+    CHECK(routeTo("LONG", "/delete/a") == "delete");
+    CHECK(routeTo("LONG", "/d").empty());
+    CHECK(routeTo("LONG", "/dia").empty());
+
+    HttpRequest req;
+    CHECK(routeTo("LONG", "/diary/(2026-10-17)a", req) == "view");
+    CHECK(req.param("name") == "(2026-10-17)a");
+}
+
+static void testPriority()
+{
+    CHECK(routeTo("MIXED", "/api/diaries") == "list");
+    CHECK(routeTo("MIXED", "/api/diaries/export") == "export");
+    CHECK(routeTo("MIXED", "/api/diaries/exported") == "get");
+
+    HttpRequest req;
+    CHECK(routeTo("MIXED", "/api/diaries/a/b", req) == "fallback");
+    CHECK(req.param("rest") == "diaries/a/b");
+    CHECK(routeTo("MIXED", "/api/") == "fallback");
+    CHECK(routeTo("MIXED", "/ap").empty());
+    CHECK(routeTo("GET", "/api/diaries").empty());
+}
+
+// 后注册的 /api/diaries 把 /post_write 的边拆成 "/" 和 "post_write"，工厂要跟着处理函数走
+static void testBodyStreams()
+{
+    const char* const routes[][2] = { { "/post_write", "post_write" }, { "/api/diaries", "api_create" } };
+    for (const auto& [path, name] : routes)
+    {
+        HttpRequest req;
+        req.method = "POST";
+        req.path = path;
+        const BodyStreamFactory* factory = Router::getInstance().bodyStream(req);
+        CHECK(factory != nullptr);
+        if (factory)
+        {
+            g_stream_created.clear();
+            CHECK((*factory)(req) != nullptr);
+            CHECK(g_stream_created == name);
+        }
+        CHECK(routeTo("POST", path) == name);
+    }
+
+    HttpRequest req;
+    req.method = "POST";
+    req.path = "/";
+    CHECK(Router::getInstance().bodyStream(req) == nullptr);
+}
+
+int main()
+{
+    registerRoutes();
+    testShortFirst();
+    testLongFirst();
+    testPriority();
+    testBodyStreams();
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all router tests passed\n");
+    return 0;
+}
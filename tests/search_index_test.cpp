@@ -0,0 +1,172 @@
+﻿/**
+* @file search_index_test.cpp
+* @brief 检索索引文件测试：文档号越界、差值溢出、条数和字节数对不上的索引文件要整个丢掉重建，不能带着坏倒排表去检索
+* @author liushisheng
+* @date 2026-10-17
+*/
+
+#include "search/search_index.h"
+#include <cstdint>
+#include <cstdio>
+#include <filesystem>
+#include <fstream>
+#include <string>
+#include <vector>
+
+namespace fs = std::filesystem;
+
+static int g_failures = 0;
+
+#define CHECK(cond) \
+    do { if (!(cond)) { std::printf("%s:%d: CHECK(%s) failed\n", __FILE__, __LINE__, #cond); ++g_failures; } } while (0)
+
+// 索引文件的格式，和 search_index.cpp 的 serialize 一致
+static void putVarint(std::string& out, uint64_t value)
+{
+    while (value >= 0x80)
+    {
+        out += static_cast<char>((value & 0x7f) | 0x80);
+        value >>= 7;
+    }
+    out += static_cast<char>(value);
+}
+
+static void putString(std::string& out, std::string_view s)
+{
+    putVarint(out, s.size());
+    out.append(s);
+}
+
+struct Term
+{
+    std::string text;
+    uint64_t count;
+    uint64_t last;
+    std::vector<uint64_t> varints;  // 倒排表原样的 varint 序列：差值、词频、差值、词频……
+};
+
+static const char* DIARIES[] = { "(2026-10-17)a", "(2026-10-17)b" };
+
+// 文档和目录里的日记修改时间、大小一致，读进来之后就不再重新切分，文件里有什么检索就用什么
+static std::string indexFile(const FileDiaryStore& store, const std::vector<Term>& terms, uint64_t doc_count = 2,
+    const char* first_name = DIARIES[0])
+{
+    std::string out = "FPSEARCH";
+    putVarint(out, 1);
+    putVarint(out, doc_count);
+    for (uint64_t id = 0; id < std::min<uint64_t>(doc_count, 2); ++id)
+    {
+        DiaryStat stat;
+        store.stat(DIARIES[id], stat);
+        putString(out, id == 0 ? first_name : DIARIES[id]);
+        putString(out, "title");
+        putVarint(out, static_cast<uint64_t>(stat.mtime));
+        putVarint(out, stat.size);
+        putVarint(out, 3);
+    }
+    putVarint(out, terms.size());
+    for (const Term& term : terms)
+    {
+        std::string bytes;
+        for (uint64_t v : term.varints)
+        {
+            putVarint(bytes, v);
+        }
+        putString(out, term.text);
+        putVarint(out, term.count);
+        putVarint(out, term.last);
+        putString(out, bytes);
+    }
+    return out;
+}
+
+static size_t hits(std::string_view query)
+{
+    size_t total = 0;
+    SearchIndex::getInstance().search(query, 10, total);
+    return total;
+}
+
+// ghost 只在预先写好的索引文件里有，日记里没有：搜得到说明文件被采用了，搜不到说明丢掉重建了
+static const Term GHOST = { "ghost", 2, 1, { 0, 1, 1, 1 } };
+
+static bool loads(const fs::path& directory, const FileDiaryStore& store, const std::string& data)
+{
+    std::ofstream(directory / ".search-index", std::ios::binary | std::ios::trunc) << data;
+    SearchIndex& index = SearchIndex::getInstance();
+    index.start(directory.string(), store);
+    bool accepted = hits("ghost") == 2;
+    if (!accepted)
+    {
+        // 重建出来的要和日记一致
+        CHECK(hits("ghost") == 0);
+        CHECK(hits("apple") == 2);
+        CHECK(hits("banana") == 1);
+    }
+    index.stop();
+    return accepted;
+}
+
+int main()
+{
+    fs::path directory = fs::temp_directory_path() / "footprints-search";
+    fs::remove_all(directory);
+    fs::create_directories(directory);
+    std::ofstream(directory / DIARIES[0]) << "title\napple banana\n";
+    std::ofstream(directory / DIARIES[1]) << "title\napple cherry\n";
+    FileDiaryStore store(directory.string());
+
+    // 对照：格式正确的文件原样采用
+    CHECK(loads(directory, store, indexFile(store, { GHOST })));
+
+    struct Case
+    {
+        const char* what;
+        std::string data;
+    };
+    const Case cases[] = {
+        { "first id past doc_count", indexFile(store, { GHOST, { "bad", 1, 5, { 5, 1 } } }) },
+        { "later id past doc_count", indexFile(store, { GHOST, { "bad", 2, 3, { 0, 1, 3, 1 } } }) },
+        // 0 + 1 + (2^64 - 1) 回绕成 0，只查 last 查不出来
+        { "delta overflows", indexFile(store, { GHOST, { "bad", 3, 0, { 0, 1, 1, 1, UINT64_MAX, 1 } } }) },
+        { "ids not increasing", indexFile(store, { GHOST, { "bad", 2, 0, { 0, 1, 0, 1 } } }) },
+        { "count larger than the bytes", indexFile(store, { GHOST, { "bad", 1000000, 1, { 1, 1 } } }) },
+        { "count larger than doc_count", indexFile(store, { GHOST, { "bad", 3, 1, { 0, 1, 1, 1, 1, 1 } } }) },
+        { "bytes left over", indexFile(store, { GHOST, { "bad", 1, 0, { 0, 1, 1, 1 } } }) },
+        { "postings cut short", indexFile(store, { GHOST, { "bad", 2, 1, { 0, 1, 1 } } }) },
+        { "last does not match", indexFile(store, { GHOST, { "bad", 2, 0, { 0, 1, 1, 1 } } }) },
+        { "zero count", indexFile(store, { GHOST, { "bad", 0, 0, {} } }) },
+        { "zero tf", indexFile(store, { GHOST, { "bad", 1, 0, { 0, 0 } } }) },
+        { "empty term", indexFile(store, { GHOST, { "", 1, 0, { 0, 1 } } }) },
+        { "duplicate term", indexFile(store, { GHOST, GHOST }) },
+        { "doc_count past the file", indexFile(store, { GHOST }, uint64_t(1) << 40) },
+        { "duplicate filename", indexFile(store, { GHOST }, 2, DIARIES[1]) },
+        { "unsafe filename", indexFile(store, { GHOST }, 2, "../a") },
+        { "truncated", indexFile(store, { GHOST }).substr(0, 30) },
+        { "trailing bytes", indexFile(store, { GHOST }) + "x" },
+    };
+    for (const Case& c : cases)
+    {
+        if (loads(directory, store, c.data))
+        {
+            std::printf("accepted an index with %s\n", c.what);
+            ++g_failures;
+        }
+    }
+
+    // 重建之后存下的文件又能直接用
+    SearchIndex::getInstance().start(directory.string(), store);
+    SearchIndex::getInstance().stop();
+    std::ifstream in(directory / ".search-index", std::ios::binary);
+    std::string saved((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+    CHECK(saved.starts_with("FPSEARCH"));
+    fs::remove_all(directory);
+
+    if (g_failures)
+    {
+        std::printf("%d check(s) failed\n", g_failures);
+        return 1;
+    }
+    std::printf("all search index tests passed\n");
+    return 0;
+}